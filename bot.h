@@ -0,0 +1,70 @@
+/*
+ * Endless Dodge - bot plugin ABI.
+ *
+ * A bot is a shared object exporting DODGE_BOT_ENTRY, a function returning a
+ * static DodgeBot. The game loads bots with dlopen() for `--tournament` and
+ * calls them once per environment step (16 ms of sim time) with the live
+ * obstacles as structure-of-arrays. Only this header is needed to build one:
+ *
+ *     gcc -O2 -shared -fPIC my_bot.c -o my_bot.so
+ *
+ * The ABI is plain C with fixed-width types. Incompatible changes bump
+ * DODGE_BOT_ABI_VERSION; compatible additions only append struct fields, and
+ * bots can check DodgeBotObservation.size before reading new ones.
+ */
+
+#ifndef ENDLESS_DODGE_BOT_H
+#define ENDLESS_DODGE_BOT_H
+
+#include <stdint.h>
+
+#define DODGE_BOT_ABI_VERSION  1
+#define DODGE_BOT_ENTRY        "dodge_bot_entry"
+
+#if defined(__GNUC__)
+#define DODGE_BOT_EXPORT  __attribute__((visibility("default")))
+#else
+#define DODGE_BOT_EXPORT
+#endif
+
+/* What a bot sees each step; pointers are valid for the call only */
+typedef struct {
+    uint32_t     size;            /* sizeof(DodgeBotObservation) in the game */
+    uint32_t     obstacleCount;   /* active obstacles, in the arrays below */
+
+    float        fieldWidth;
+    float        fieldHeight;
+    float        elapsed;         /* seconds since the run started */
+
+    float        playerX;         /* left edge */
+    float        playerY;         /* top edge */
+    float        playerW;
+    float        playerH;
+    float        playerSpeed;     /* pixels per second while moving */
+
+    const float *obstacleX;       /* left edges */
+    const float *obstacleY;       /* top edges; negative above the screen */
+    const float *obstacleW;
+    const float *obstacleH;
+    const float *obstacleSpeed;   /* fall speed, pixels per second */
+} DodgeBotObservation;
+
+typedef struct {
+    uint32_t    abiVersion;       /* DODGE_BOT_ABI_VERSION */
+    const char *name;
+
+    /*
+     * Per-run state, created at the start of every run and destroyed at its
+     * end. Either may be NULL for a stateless bot. Runs execute in parallel,
+     * so anything shared between states must be thread-safe.
+     */
+    void *(*create)(uint32_t seed);
+    void  (*destroy)(void *state);
+
+    /* Move for the next step: -1 left, 0 stay, 1 right */
+    int   (*move)(void *state, const DodgeBotObservation *obs);
+} DodgeBot;
+
+typedef const DodgeBot *(*DodgeBotEntry)(void);
+
+#endif /* ENDLESS_DODGE_BOT_H */
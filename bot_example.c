@@ -0,0 +1,71 @@
+/*
+ * Endless Dodge - example bot for `--tournament`.
+ *
+ * Finds the obstacle that will reach the player's row first among those
+ * close enough to matter, and steps out from under it towards the side with
+ * more room. With nothing threatening it drifts back to the middle.
+ *
+ * Build: gcc -O2 -shared -fPIC bot_example.c -o bot_example.so
+ */
+
+#include <stddef.h>
+
+#include "bot.h"
+
+#define LOOKAHEAD_S     0.6f   /* ignore obstacles further away than this */
+#define SIDE_MARGIN     8.0f   /* extra clearance around the player */
+#define CENTER_DEADZONE 40.0f
+
+static int example_move(void *state, const DodgeBotObservation *obs) {
+    (void)state;
+
+    float left  = obs->playerX - SIDE_MARGIN;
+    float right = obs->playerX + obs->playerW + SIDE_MARGIN;
+    float soonest = LOOKAHEAD_S;
+    int   threat = -1;
+
+    for (uint32_t i = 0; i < obs->obstacleCount; ++i) {
+        float bottom = obs->obstacleY[i] + obs->obstacleH[i];
+        if (obs->obstacleY[i] > obs->playerY + obs->playerH) {
+            continue;  /* already past */
+        }
+        if (obs->obstacleX[i] + obs->obstacleW[i] < left ||
+            obs->obstacleX[i] > right) {
+            continue;
+        }
+        float t = (obs->playerY - bottom) / obs->obstacleSpeed[i];
+        if (t < soonest) {
+            soonest = t;
+            threat = (int)i;
+        }
+    }
+
+    float center = obs->playerX + 0.5f * obs->playerW;
+    if (threat < 0) {
+        float mid = 0.5f * obs->fieldWidth;
+        if (center < mid - CENTER_DEADZONE) return 1;
+        if (center > mid + CENTER_DEADZONE) return -1;
+        return 0;
+    }
+
+    float x = obs->obstacleX[threat];
+    float w = obs->obstacleW[threat];
+    int fitsLeft  = x >= obs->playerW + SIDE_MARGIN;
+    int fitsRight = obs->fieldWidth - (x + w) >= obs->playerW + SIDE_MARGIN;
+    if (fitsLeft && (!fitsRight || center < x + 0.5f * w)) {
+        return -1;
+    }
+    return 1;
+}
+
+static const DodgeBot EXAMPLE_BOT = {
+    DODGE_BOT_ABI_VERSION,
+    "example",
+    NULL,
+    NULL,
+    example_move
+};
+
+DODGE_BOT_EXPORT const DodgeBot *dodge_bot_entry(void) {
+    return &EXAMPLE_BOT;
+}
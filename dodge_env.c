@@ -0,0 +1,605 @@
+/*
+ * Endless Dodge - CPython extension for batched headless sims.
+ *
+ *   env = dodge_env.BatchEnv(256)
+ *   obs, rewards, dones = env.reset(range(1, 257))
+ *   obs, rewards, dones = env.step(actions)   # one int8 per game
+ *
+ * Outputs are memoryviews straight onto the batch's arrays (no copies), and
+ * are updated in place by later calls. Stepping releases the GIL and splits
+ * the batch across native threads. Build instructions are in README.MD.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#define ENV_MAX_THREADS  64
+#define ENV_MAX_GAMES    (1 << 20)
+
+/* ------------------------------- Types ----------------------------------- */
+
+typedef struct BatchEnv BatchEnv;
+
+typedef struct {
+    BatchEnv *env;
+    pthread_t thread;
+    int       part;
+} EnvWorker;
+
+/* The session thread takes part 0; workers 1..threadCount-1 the rest */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  start;
+    pthread_cond_t  finished;
+    unsigned long   generation;
+    int             pending;
+    int             quit;
+    int             threadCount;
+    EnvWorker       workers[ENV_MAX_THREADS];
+} EnvPool;
+
+struct BatchEnv {
+    PyObject_HEAD
+    SimBatch  batch;
+    int8_t   *actions;
+    uint32_t *seeds;
+    int       busy;     /* a step or reset is running without the GIL */
+    int       poolUp;
+    EnvPool   pool;
+};
+
+typedef enum {
+    ENV_OUTPUT_OBS = 0,
+    ENV_OUTPUT_REWARDS,
+    ENV_OUTPUT_DONES
+} EnvOutput;
+
+/* Buffer exporter for one output array; keeps its env alive */
+typedef struct {
+    PyObject_HEAD
+    BatchEnv  *env;
+    EnvOutput  kind;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+} EnvBuffer;
+
+static PyTypeObject BatchEnvType;
+static PyTypeObject EnvBufferType;
+
+/* ----------------------------- Worker Pool ------------------------------- */
+
+static void env_step_part(BatchEnv *env, int part) {
+    int parts = env->pool.threadCount;
+    int first = (int)((long)env->batch.count * part / parts);
+    int last  = (int)((long)env->batch.count * (part + 1) / parts);
+    sim_batch_step_range(&env->batch, env->actions, first, last);
+}
+
+static void *env_worker(void *data) {
+    EnvWorker *w = (EnvWorker *)data;
+    EnvPool   *pool = &w->env->pool;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->generation == seen && !pool->quit) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->quit) {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        env_step_part(w->env, w->part);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->finished);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static int env_pool_start(BatchEnv *env, int wanted) {
+    EnvPool *pool = &env->pool;
+
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        return 0;
+    }
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->finished, NULL);
+    pool->threadCount = 1;
+    env->poolUp = 1;
+
+    for (int i = 1; i < wanted; ++i) {
+        EnvWorker *w = &pool->workers[i];
+        w->env  = env;
+        w->part = i;
+        if (pthread_create(&w->thread, NULL, env_worker, w) != 0) {
+            break;  /* run with the threads we got */
+        }
+        pool->threadCount = i + 1;
+    }
+    return 1;
+}
+
+static void env_pool_stop(BatchEnv *env) {
+    EnvPool *pool = &env->pool;
+
+    if (!env->poolUp) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->threadCount; ++i) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->finished);
+    pthread_mutex_destroy(&pool->lock);
+    env->poolUp = 0;
+}
+
+/* Step every game on all pool threads; called without the GIL */
+static void env_pool_step(BatchEnv *env) {
+    EnvPool *pool = &env->pool;
+
+    if (pool->threadCount > 1) {
+        pthread_mutex_lock(&pool->lock);
+        ++pool->generation;
+        pool->pending = pool->threadCount - 1;
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    env_step_part(env, 0);
+
+    if (pool->threadCount > 1) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending > 0) {
+            pthread_cond_wait(&pool->finished, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+/* ------------------------------ Arguments -------------------------------- */
+
+/* Store one converted integer the way the sequence path does */
+static void env_store_int(void *out, Py_ssize_t itemSize, Py_ssize_t i,
+                          long long v) {
+    if (itemSize == 1) {
+        ((int8_t *)out)[i] = (int8_t)(v < 0 ? -1 : (v > 0 ? 1 : 0));
+    } else {
+        ((uint32_t *)out)[i] = (uint32_t)(unsigned long long)v;
+    }
+}
+
+/*
+ * Signedness of struct format integer `code`: 1 signed, 0 unsigned, -1 for
+ * anything that is not an integer.
+ */
+static int env_int_signed(char code) {
+    switch (code) {
+    case 'b': case 'h': case 'i': case 'l': case 'q': case 'n':
+        return 1;
+    case 'B': case '?': case 'H': case 'I': case 'L': case 'Q': case 'N':
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+/*
+ * Split a struct format into its integer code, or '\0' if it is not a single
+ * integer in host byte order. '@' and no prefix mean native sizes, '=' and
+ * '<'/'>'/'!' standard ones; either way the item size says how wide it is.
+ */
+static char env_int_code(const char *format) {
+    static const uint16_t one = 1;
+    const char hostOrder = *(const uint8_t *)&one ? '<' : '>';
+    char order = format[0];
+    if (order == '@' || order == '=' || order == '<' || order == '>' ||
+        order == '!') {
+        if ((order == '<' || order == '>' || order == '!') &&
+            (order == '<' ? '<' : '>') != hostOrder) {
+            return '\0';
+        }
+        ++format;
+    }
+    if (format[0] == '\0' || format[1] != '\0' || env_int_signed(format[0]) < 0) {
+        return '\0';
+    }
+    return format[0];
+}
+
+/* Read element `i` of an integer buffer whose item size is 1, 2, 4 or 8 */
+static long long env_buffer_int(const Py_buffer *view, int isSigned,
+                                Py_ssize_t i) {
+    const char *p = (const char *)view->buf + i * view->itemsize;
+    switch (view->itemsize) {
+    case 1: { uint8_t x;  memcpy(&x, p, sizeof(x)); return isSigned ? (long long)(int8_t)x : (long long)x; }
+    case 2: { uint16_t x; memcpy(&x, p, sizeof(x)); return isSigned ? (long long)(int16_t)x : (long long)x; }
+    case 4: { uint32_t x; memcpy(&x, p, sizeof(x)); return isSigned ? (long long)(int32_t)x : (long long)x; }
+    default: { uint64_t x; memcpy(&x, p, sizeof(x)); return (long long)x; }
+    }
+}
+
+/*
+ * Copy `count` integers of `itemSize` bytes (1 or 4) from `src` into `out`.
+ * 32-bit integer seed buffers are copied as-is; other integer buffers (int8,
+ * bool or int64 arrays, ...) and plain sequences of ints are converted
+ * element by element.
+ * Float and other non-integer buffers raise TypeError.
+ */
+static int env_read_ints(PyObject *src, Py_ssize_t count, Py_ssize_t itemSize,
+                         void *out, const char *what) {
+    if (PyObject_CheckBuffer(src)) {
+        Py_buffer view;
+        if (PyObject_GetBuffer(src, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0) {
+            return 0;
+        }
+        char code = env_int_code(view.format ? view.format : "B");
+        int ok = 0;
+        if (view.len == 0 && count == 0) {
+            ok = 1;
+        } else if (view.itemsize <= 0 || view.len / view.itemsize != count ||
+                   view.len % view.itemsize != 0) {
+            PyErr_Format(PyExc_ValueError, "%s buffer must hold %zd items",
+                         what, count);
+        } else if (code == '\0' ||
+                   (view.itemsize != 1 && view.itemsize != 2 &&
+                    view.itemsize != 4 && view.itemsize != 8)) {
+            PyErr_Format(PyExc_TypeError,
+                         "%s buffer must hold host-order integers, not format '%s'",
+                         what, view.format ? view.format : "B");
+        } else if (itemSize == 4 && view.itemsize == 4) {
+            /* Any 4-byte integer format is already the seed bit pattern */
+            memcpy(out, view.buf, (size_t)view.len);
+            ok = 1;
+        } else {
+            int isSigned = env_int_signed(code);
+            for (Py_ssize_t i = 0; i < count; ++i) {
+                env_store_int(out, itemSize, i,
+                              env_buffer_int(&view, isSigned, i));
+            }
+            ok = 1;
+        }
+        PyBuffer_Release(&view);
+        return ok;
+    }
+
+    PyObject *seq = PySequence_Fast(src, "expected a buffer or a sequence");
+    if (!seq) {
+        return 0;
+    }
+    if (PySequence_Fast_GET_SIZE(seq) != count) {
+        PyErr_Format(PyExc_ValueError, "%s must have %zd items", what, count);
+        Py_DECREF(seq);
+        return 0;
+    }
+    PyObject **items = PySequence_Fast_ITEMS(seq);
+    for (Py_ssize_t i = 0; i < count; ++i) {
+        if (itemSize == 1) {
+            long v = PyLong_AsLong(items[i]);
+            env_store_int(out, itemSize, i, v);
+        } else {
+            env_store_int(out, itemSize, i,
+                          (long long)PyLong_AsUnsignedLongMask(items[i]));
+        }
+        if (PyErr_Occurred()) {
+            Py_DECREF(seq);
+            return 0;
+        }
+    }
+    Py_DECREF(seq);
+    return 1;
+}
+
+/* ------------------------------ EnvBuffer -------------------------------- */
+
+static PyObject *env_output_view(BatchEnv *env, EnvOutput kind) {
+    EnvBuffer *b = PyObject_New(EnvBuffer, &EnvBufferType);
+    if (!b) {
+        return NULL;
+    }
+    Py_INCREF(env);
+    b->env  = env;
+    b->kind = kind;
+
+    PyObject *view = PyMemoryView_FromObject((PyObject *)b);
+    Py_DECREF(b);
+    return view;
+}
+
+static int EnvBuffer_getbuffer(PyObject *self, Py_buffer *view, int flags) {
+    EnvBuffer *b = (EnvBuffer *)self;
+    SimBatch  *batch = &b->env->batch;
+    int ndim = 1;
+
+    b->shape[0]   = batch->count;
+    b->strides[0] = sizeof(float);
+    switch (b->kind) {
+        case ENV_OUTPUT_OBS:
+            view->buf      = batch->obs;
+            view->itemsize = sizeof(float);
+            view->format   = "f";
+            ndim = 2;
+            b->shape[1]   = SIM_OBS_FLOATS;
+            b->strides[0] = SIM_OBS_FLOATS * sizeof(float);
+            b->strides[1] = sizeof(float);
+            break;
+        case ENV_OUTPUT_REWARDS:
+            view->buf      = batch->rewards;
+            view->itemsize = sizeof(float);
+            view->format   = "f";
+            break;
+        default:
+            view->buf      = batch->dones;
+            view->itemsize = 1;
+            view->format   = "B";
+            b->strides[0]  = 1;
+            break;
+    }
+
+    view->obj        = self;
+    view->len        = b->shape[0] * b->strides[0];
+    view->readonly   = 1;
+    view->ndim       = ndim;
+    view->shape      = b->shape;
+    view->strides    = b->strides;
+    view->suboffsets = NULL;
+    view->internal   = NULL;
+    if (!(flags & PyBUF_FORMAT)) {
+        view->format = NULL;
+    }
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "environment outputs are read-only");
+        view->obj = NULL;
+        return -1;
+    }
+    Py_INCREF(self);
+    return 0;
+}
+
+static void EnvBuffer_dealloc(PyObject *self) {
+    Py_XDECREF(((EnvBuffer *)self)->env);
+    PyObject_Free(self);
+}
+
+static PyBufferProcs EnvBuffer_as_buffer = {
+    EnvBuffer_getbuffer,
+    NULL
+};
+
+static PyTypeObject EnvBufferType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "dodge_env._Output",
+    .tp_basicsize = sizeof(EnvBuffer),
+    .tp_dealloc   = EnvBuffer_dealloc,
+    .tp_as_buffer = &EnvBuffer_as_buffer,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = "Buffer exporter for one BatchEnv output array",
+};
+
+/* ------------------------------- BatchEnv -------------------------------- */
+
+static int BatchEnv_init(PyObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = { "count", "threads", NULL };
+    BatchEnv *env = (BatchEnv *)self;
+    int count = 0;
+    int threads = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "i|i", kwlist,
+                                     &count, &threads)) {
+        return -1;
+    }
+    if (env->batch.count) {
+        PyErr_SetString(PyExc_RuntimeError, "BatchEnv is already initialized");
+        return -1;
+    }
+    if (count <= 0 || count > ENV_MAX_GAMES) {
+        PyErr_Format(PyExc_ValueError, "count must be in 1..%d", ENV_MAX_GAMES);
+        return -1;
+    }
+    if (threads <= 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads > ENV_MAX_THREADS) threads = ENV_MAX_THREADS;
+    if (threads > count) threads = count;
+    if (threads < 1) threads = 1;
+
+    env->actions = (int8_t *)PyMem_Calloc((size_t)count, sizeof(int8_t));
+    env->seeds   = (uint32_t *)PyMem_Calloc((size_t)count, sizeof(uint32_t));
+    if (!env->actions || !env->seeds || !sim_batch_init(&env->batch, count)) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    for (int i = 0; i < count; ++i) {
+        env->seeds[i] = (uint32_t)i + 1;
+    }
+    sim_batch_reset(&env->batch, env->seeds);
+
+    if (!env_pool_start(env, threads)) {
+        PyErr_SetString(PyExc_RuntimeError, "cannot start worker threads");
+        return -1;
+    }
+    return 0;
+}
+
+static void BatchEnv_dealloc(PyObject *self) {
+    BatchEnv *env = (BatchEnv *)self;
+    env_pool_stop(env);
+    sim_batch_free(&env->batch);
+    PyMem_Free(env->actions);
+    PyMem_Free(env->seeds);
+    Py_TYPE(self)->tp_free(self);
+}
+
+/* The (obs, rewards, dones) views returned by reset() and step() */
+static PyObject *env_outputs(BatchEnv *env) {
+    PyObject *obs     = env_output_view(env, ENV_OUTPUT_OBS);
+    PyObject *rewards = env_output_view(env, ENV_OUTPUT_REWARDS);
+    PyObject *dones   = env_output_view(env, ENV_OUTPUT_DONES);
+    PyObject *result  = NULL;
+
+    if (obs && rewards && dones) {
+        result = PyTuple_Pack(3, obs, rewards, dones);
+    }
+    Py_XDECREF(obs);
+    Py_XDECREF(rewards);
+    Py_XDECREF(dones);
+    return result;
+}
+
+static int env_check_ready(BatchEnv *env) {
+    if (!env->batch.count) {
+        PyErr_SetString(PyExc_RuntimeError, "BatchEnv is not initialized");
+        return 0;
+    }
+    if (env->busy) {
+        PyErr_SetString(PyExc_RuntimeError, "BatchEnv is in use by another thread");
+        return 0;
+    }
+    return 1;
+}
+
+static PyObject *BatchEnv_reset(PyObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = { "seeds", "done_only", NULL };
+    BatchEnv *env = (BatchEnv *)self;
+    PyObject *seeds = NULL;
+    int doneOnly = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|p", kwlist,
+                                     &seeds, &doneOnly)) {
+        return NULL;
+    }
+    if (!env_check_ready(env) ||
+        !env_read_ints(seeds, env->batch.count, 4, env->seeds, "seeds")) {
+        return NULL;
+    }
+
+    if (doneOnly) {
+        for (int i = 0; i < env->batch.count; ++i) {
+            if (env->batch.dones[i]) {
+                sim_batch_reset_range(&env->batch, env->seeds, i, i + 1);
+            }
+        }
+    } else {
+        sim_batch_reset(&env->batch, env->seeds);
+    }
+    return env_outputs(env);
+}
+
+static PyObject *BatchEnv_step(PyObject *self, PyObject *actions) {
+    BatchEnv *env = (BatchEnv *)self;
+
+    if (!env_check_ready(env) ||
+        !env_read_ints(actions, env->batch.count, 1, env->actions, "actions")) {
+        return NULL;
+    }
+
+    env->busy = 1;
+    Py_BEGIN_ALLOW_THREADS
+    env_pool_step(env);
+    Py_END_ALLOW_THREADS
+    env->busy = 0;
+
+    return env_outputs(env);
+}
+
+static PyObject *BatchEnv_get_count(PyObject *self, void *closure) {
+    (void)closure;
+    return PyLong_FromLong(((BatchEnv *)self)->batch.count);
+}
+
+static PyObject *BatchEnv_get_threads(PyObject *self, void *closure) {
+    (void)closure;
+    return PyLong_FromLong(((BatchEnv *)self)->pool.threadCount);
+}
+
+static PyObject *BatchEnv_get_scores(PyObject *self, void *closure) {
+    BatchEnv *env = (BatchEnv *)self;
+    (void)closure;
+
+    PyObject *list = PyList_New(env->batch.count);
+    for (int i = 0; list && i < env->batch.count; ++i) {
+        PyList_SET_ITEM(list, i, PyLong_FromLong(env->batch.sims[i].score));
+    }
+    return list;
+}
+
+static PyMethodDef BatchEnv_methods[] = {
+    { "reset", (PyCFunction)(void (*)(void))BatchEnv_reset,
+      METH_VARARGS | METH_KEYWORDS,
+      "reset(seeds, done_only=False) -> (obs, rewards, dones)\n\n"
+      "Restart every game (or only finished ones) with one uint32 seed each." },
+    { "step", (PyCFunction)BatchEnv_step, METH_O,
+      "step(actions) -> (obs, rewards, dones)\n\n"
+      "Advance every game by STEP_US; one int8 action (-1, 0, 1) per game." },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef BatchEnv_getset[] = {
+    { "count",   BatchEnv_get_count,   NULL, "number of games", NULL },
+    { "threads", BatchEnv_get_threads, NULL, "native threads used by step()", NULL },
+    { "scores",  BatchEnv_get_scores,  NULL, "current score of every game", NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+static PyTypeObject BatchEnvType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name      = "dodge_env.BatchEnv",
+    .tp_basicsize = sizeof(BatchEnv),
+    .tp_dealloc   = BatchEnv_dealloc,
+    .tp_flags     = Py_TPFLAGS_DEFAULT,
+    .tp_doc       = "BatchEnv(count, threads=0)\n\n"
+                    "A batch of headless Endless Dodge games stepped together. "
+                    "Outputs are zero-copy memoryviews updated in place.",
+    .tp_methods   = BatchEnv_methods,
+    .tp_getset    = BatchEnv_getset,
+    .tp_init      = BatchEnv_init,
+    .tp_new       = PyType_GenericNew,
+};
+
+/* -------------------------------- Module --------------------------------- */
+
+static struct PyModuleDef dodge_env_module = {
+    PyModuleDef_HEAD_INIT,
+    "dodge_env",
+    "Batched headless Endless Dodge sims for Python agents.",
+    -1,
+    NULL, NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_dodge_env(void) {
+    if (PyType_Ready(&BatchEnvType) < 0 || PyType_Ready(&EnvBufferType) < 0) {
+        return NULL;
+    }
+
+    PyObject *m = PyModule_Create(&dodge_env_module);
+    if (!m) {
+        return NULL;
+    }
+
+    Py_INCREF(&BatchEnvType);
+    if (PyModule_AddObject(m, "BatchEnv", (PyObject *)&BatchEnvType) < 0 ||
+        PyModule_AddIntConstant(m, "OBS_FLOATS", SIM_OBS_FLOATS) < 0 ||
+        PyModule_AddIntConstant(m, "STEP_US", SIM_ENV_STEP_US) < 0 ||
+        PyModule_AddIntConstant(m, "MAX_OBSTACLES", MAX_OBSTACLES) < 0) {
+        Py_DECREF(&BatchEnvType);
+        Py_DECREF(m);
+        return NULL;
+    }
+    return m;
+}
@@ -1,609 +1,6016 @@
-/*
- * Endless Dodge - A small, production-ready 2D arcade game in C using SDL2.
- *
- * Features:
- *  - Simple and addictive dodge gameplay (endless, increasing difficulty).
- *  - Game states: MENU, PLAYING, PAUSED, GAME_OVER.
- *  - High score persistence to a local file (highscore.dat).
- *  - Error-checked SDL initialization and resource management.
- *  - Window title shows score, high score, and state.
- *
- * Controls:
- *  - Move Left:  A or Left Arrow
- *  - Move Right: D or Right Arrow
- *  - Start / Restart: Enter
- *  - Pause / Resume: P
- *  - Quit: Esc or close window
- */
-
-#include <SDL.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
-#include <math.h>
-#include <string.h>
-
-/* ----------------------------- Configuration ----------------------------- */
-
-#define WINDOW_WIDTH   800
-#define WINDOW_HEIGHT  600
-
-#define TARGET_FPS     60
-#define FRAME_TIME_MS  (1000 / TARGET_FPS)
-
-/* Player configuration */
-#define PLAYER_WIDTH       80.0f
-#define PLAYER_HEIGHT      20.0f
-#define PLAYER_SPEED       500.0f  /* pixels per second */
-
-/* Obstacle configuration */
-#define MAX_OBSTACLES             64
-#define OBSTACLE_MIN_WIDTH        40.0f
-#define OBSTACLE_MAX_WIDTH        140.0f
-#define OBSTACLE_HEIGHT           20.0f
-#define OBSTACLE_BASE_SPEED       200.0f
-#define OBSTACLE_SPEED_INCREMENT  0.03f   /* added per second elapsed */
-#define OBSTACLE_BASE_INTERVAL    700.0f  /* ms between spawns at start */
-#define OBSTACLE_MIN_INTERVAL     140.0f
-#define OBSTACLE_INTERVAL_DECAY   0.985f  /* multiply interval after each spawn */
-
-#define BACKGROUND_COLOR_R 15
-#define BACKGROUND_COLOR_G 15
-#define BACKGROUND_COLOR_B 25
-
-#define PLAYER_COLOR_R 60
-#define PLAYER_COLOR_G 220
-#define PLAYER_COLOR_B 120
-
-#define OBSTACLE_COLOR_R 230
-#define OBSTACLE_COLOR_G 60
-#define OBSTACLE_COLOR_B 80
-
-#define MENU_TINT_ALPHA      120
-#define PAUSE_TINT_ALPHA     120
-#define GAME_OVER_TINT_ALPHA 160
-
-static const char *HIGHSCORE_FILE = "highscore.dat";
-
-/* ------------------------------ Logging ---------------------------------- */
-
-#define LOG_ERROR(fmt, ...) \
-    fprintf(stderr, "[ERROR] " fmt "\n", ##__VA_ARGS__)
-#define LOG_INFO(fmt, ...) \
-    fprintf(stdout, "[INFO] " fmt "\n", ##__VA_ARGS__)
-
-/* ------------------------------- Types ----------------------------------- */
-
-typedef enum {
-    GAME_STATE_MENU = 0,
-    GAME_STATE_PLAYING,
-    GAME_STATE_PAUSED,
-    GAME_STATE_GAME_OVER
-} GameState;
-
-typedef struct {
-    float x;
-    float y;
-    float w;
-    float h;
-    float speed;
-    int   active;
-} Obstacle;
-
-typedef struct {
-    float x;
-    float y;
-    float w;
-    float h;
-    float speed;
-} Player;
-
-typedef struct {
-    SDL_Window   *window;
-    SDL_Renderer *renderer;
-    int           running;
-
-    GameState state;
-
-    Player    player;
-    Obstacle  obstacles[MAX_OBSTACLES];
-
-    int    score;
-    int    highScore;
-    float  elapsedTime;      /* seconds since game start (for difficulty) */
-    Uint32 lastSpawnTicks;   /* ms timestamp of last obstacle spawn */
-    float  spawnIntervalMs;  /* dynamic spawn interval */
-
-    int    leftPressed;
-    int    rightPressed;
-} Game;
-
-/* -------------------------- Utility Functions ---------------------------- */
-
-static float clampf(float v, float min, float max) {
-    if (v < min) return min;
-    if (v > max) return max;
-    return v;
-}
-
-/* Simple AABB collision check */
-static int rects_intersect(float x1, float y1, float w1, float h1,
-                           float x2, float y2, float w2, float h2) {
-    return !(x1 > x2 + w2 ||
-             x1 + w1 < x2 ||
-             y1 > y2 + h2 ||
-             y1 + h1 < y2);
-}
-
-/* Random float in [min, max] */
-static float rand_range(float min, float max) {
-    float t = (float)rand() / (float)RAND_MAX;
-    return min + t * (max - min);
-}
-
-/* -------------------------- High Score Storage --------------------------- */
-
-static int load_high_score(const char *path) {
-    FILE *f = fopen(path, "rb");
-    if (!f) {
-        /* no file yet; high score is zero */
-        LOG_INFO("No high score file found, starting fresh.");
-        return 0;
-    }
-
-    int value = 0;
-    if (fread(&value, sizeof(int), 1, f) != 1) {
-        LOG_ERROR("Failed to read high score file; resetting to zero.");
-        value = 0;
-    }
-
-    fclose(f);
-    return value;
-}
-
-static void save_high_score(const char *path, int score) {
-    FILE *f = fopen(path, "wb");
-    if (!f) {
-        LOG_ERROR("Failed to open high score file for writing.");
-        return;
-    }
-
-    if (fwrite(&score, sizeof(int), 1, f) != 1) {
-        LOG_ERROR("Failed to write high score to file.");
-    }
-
-    fclose(f);
-}
-
-/* ---------------------------- Game Setup --------------------------------- */
-
-static void reset_obstacles(Game *game) {
-    for (int i = 0; i < MAX_OBSTACLES; ++i) {
-        game->obstacles[i].active = 0;
-    }
-}
-
-/* Initialize player in the center-bottom of the screen */
-static void init_player(Game *game) {
-    game->player.w = PLAYER_WIDTH;
-    game->player.h = PLAYER_HEIGHT;
-    game->player.x = (WINDOW_WIDTH - PLAYER_WIDTH) / 2.0f;
-    game->player.y = WINDOW_HEIGHT - PLAYER_HEIGHT - 40.0f;
-    game->player.speed = PLAYER_SPEED;
-}
-
-/* Reset the gameplay values when starting a new run */
-static void reset_gameplay(Game *game) {
-    game->score        = 0;
-    game->elapsedTime  = 0.0f;
-    game->spawnIntervalMs = OBSTACLE_BASE_INTERVAL;
-    game->lastSpawnTicks  = SDL_GetTicks();
-
-    init_player(game);
-    reset_obstacles(game);
-}
-
-/* Initialize SDL, window, renderer, etc. */
-static int init_sdl(Game *game) {
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
-        LOG_ERROR("SDL_Init failed: %s", SDL_GetError());
-        return 0;
-    }
-
-    game->window = SDL_CreateWindow(
-        "Endless Dodge",
-        SDL_WINDOWPOS_CENTERED,
-        SDL_WINDOWPOS_CENTERED,
-        WINDOW_WIDTH,
-        WINDOW_HEIGHT,
-        SDL_WINDOW_SHOWN
-    );
-    if (!game->window) {
-        LOG_ERROR("SDL_CreateWindow failed: %s", SDL_GetError());
-        SDL_Quit();
-        return 0;
-    }
-
-    game->renderer = SDL_CreateRenderer(
-        game->window,
-        -1,
-        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
-    );
-    if (!game->renderer) {
-        LOG_ERROR("SDL_CreateRenderer failed: %s", SDL_GetError());
-        SDL_DestroyWindow(game->window);
-        SDL_Quit();
-        return 0;
-    }
-
-    SDL_SetRenderDrawBlendMode(game->renderer, SDL_BLENDMODE_BLEND);
-
-    return 1;
-}
-
-static void shutdown_sdl(Game *game) {
-    if (game->renderer) {
-        SDL_DestroyRenderer(game->renderer);
-    }
-    if (game->window) {
-        SDL_DestroyWindow(game->window);
-    }
-    SDL_Quit();
-}
-
-/* Initialize entire game structure */
-static int init_game(Game *game) {
-    memset(game, 0, sizeof(Game));
-
-    if (!init_sdl(game)) {
-        return 0;
-    }
-
-    /* Seed RNG for obstacle randomization */
-    srand((unsigned int)time(NULL));
-
-    game->running = 1;
-    game->state   = GAME_STATE_MENU;
-    game->leftPressed  = 0;
-    game->rightPressed = 0;
-
-    game->highScore = load_high_score(HIGHSCORE_FILE);
-
-    reset_gameplay(game);
-
-    LOG_INFO("Game initialized. High score: %d", game->highScore);
-    return 1;
-}
-
-/* --------------------------- Obstacle Logic ------------------------------ */
-
-static void spawn_obstacle(Game *game) {
-    /* Find an inactive obstacle slot */
-    int idx = -1;
-    for (int i = 0; i < MAX_OBSTACLES; ++i) {
-        if (!game->obstacles[i].active) {
-            idx = i;
-            break;
-        }
-    }
-    if (idx == -1) {
-        /* No space; skip this spawn */
-        return;
-    }
-
-    Obstacle *o = &game->obstacles[idx];
-    o->w = rand_range(OBSTACLE_MIN_WIDTH, OBSTACLE_MAX_WIDTH);
-    o->h = OBSTACLE_HEIGHT;
-
-    /* Keep the obstacle fully inside the screen horizontally */
-    float maxX = (float)WINDOW_WIDTH - o->w;
-    o->x = rand_range(0.0f, maxX);
-    o->y = -o->h;  /* start above screen */
-
-    float speedBoost = OBSTACLE_SPEED_INCREMENT * game->elapsedTime * OBSTACLE_BASE_SPEED;
-    o->speed = OBSTACLE_BASE_SPEED + speedBoost;
-
-    o->active = 1;
-    game->lastSpawnTicks = SDL_GetTicks();
-
-    /* Gradually reduce spawn interval, down to OBSTACLE_MIN_INTERVAL */
-    game->spawnIntervalMs *= OBSTACLE_INTERVAL_DECAY;
-    if (game->spawnIntervalMs < OBSTACLE_MIN_INTERVAL) {
-        game->spawnIntervalMs = OBSTACLE_MIN_INTERVAL;
-    }
-}
-
-/* Update all active obstacles */
-static void update_obstacles(Game *game, float dt) {
-    for (int i = 0; i < MAX_OBSTACLES; ++i) {
-        Obstacle *o = &game->obstacles[i];
-        if (!o->active) {
-            continue;
-        }
-
-        o->y += o->speed * dt;
-
-        /* Deactivate if off-screen */
-        if (o->y > WINDOW_HEIGHT) {
-            o->active = 0;
-            /* Reward dodging by slightly increasing score */
-            game->score += 10;
-        }
-    }
-}
-
-/* Check if any obstacle hits the player */
-static int check_collisions(Game *game) {
-    const Player *p = &game->player;
-
-    for (int i = 0; i < MAX_OBSTACLES; ++i) {
-        Obstacle *o = &game->obstacles[i];
-        if (!o->active) {
-            continue;
-        }
-
-        if (rects_intersect(p->x, p->y, p->w, p->h,
-                            o->x, o->y, o->w, o->h)) {
-            return 1;
-        }
-    }
-
-    return 0;
-}
-
-/* ---------------------------- Input Handling ----------------------------- */
-
-static void handle_key_down(Game *game, SDL_Keycode key) {
-    switch (key) {
-        case SDLK_a:
-        case SDLK_LEFT:
-            game->leftPressed = 1;
-            break;
-        case SDLK_d:
-        case SDLK_RIGHT:
-            game->rightPressed = 1;
-            break;
-        case SDLK_RETURN:
-        case SDLK_KP_ENTER:
-            if (game->state == GAME_STATE_MENU ||
-                game->state == GAME_STATE_GAME_OVER) {
-                reset_gameplay(game);
-                game->state = GAME_STATE_PLAYING;
-            }
-            break;
-        case SDLK_p:
-            if (game->state == GAME_STATE_PLAYING) {
-                game->state = GAME_STATE_PAUSED;
-            } else if (game->state == GAME_STATE_PAUSED) {
-                game->state = GAME_STATE_PLAYING;
-            }
-            break;
-        case SDLK_ESCAPE:
-            game->running = 0;
-            break;
-        default:
-            break;
-    }
-}
-
-static void handle_key_up(Game *game, SDL_Keycode key) {
-    switch (key) {
-        case SDLK_a:
-        case SDLK_LEFT:
-            game->leftPressed = 0;
-            break;
-        case SDLK_d:
-        case SDLK_RIGHT:
-            game->rightPressed = 0;
-            break;
-        default:
-            break;
-    }
-}
-
-static void process_events(Game *game) {
-    SDL_Event e;
-    while (SDL_PollEvent(&e)) {
-        switch (e.type) {
-            case SDL_QUIT:
-                game->running = 0;
-                break;
-            case SDL_KEYDOWN:
-                if (!e.key.repeat) {
-                    handle_key_down(game, e.key.keysym.sym);
-                }
-                break;
-            case SDL_KEYUP:
-                handle_key_up(game, e.key.keysym.sym);
-                break;
-            default:
-                break;
-        }
-    }
-}
-
-/* ----------------------------- Game Update ------------------------------- */
-
-static void update_player(Game *game, float dt) {
-    float dir = 0.0f;
-    if (game->leftPressed) {
-        dir -= 1.0f;
-    }
-    if (game->rightPressed) {
-        dir += 1.0f;
-    }
-
-    game->player.x += dir * game->player.speed * dt;
-
-    /* Clamp inside screen */
-    game->player.x = clampf(
-        game->player.x,
-        0.0f,
-        (float)WINDOW_WIDTH - game->player.w
-    );
-}
-
-static void update_window_title(Game *game) {
-    const char *stateStr = NULL;
-    switch (game->state) {
-        case GAME_STATE_MENU:
-            stateStr = "MENU";
-            break;
-        case GAME_STATE_PLAYING:
-            stateStr = "PLAYING";
-            break;
-        case GAME_STATE_PAUSED:
-            stateStr = "PAUSED";
-            break;
-        case GAME_STATE_GAME_OVER:
-            stateStr = "GAME OVER";
-            break;
-        default:
-            stateStr = "UNKNOWN";
-            break;
-    }
-
-    char title[128];
-    snprintf(
-        title,
-        sizeof(title),
-        "Endless Dodge - Score: %d  High: %d  [%s]",
-        game->score,
-        game->highScore,
-        stateStr
-    );
-    SDL_SetWindowTitle(game->window, title);
-}
-
-static void update_game(Game *game, float dt) {
-    if (game->state != GAME_STATE_PLAYING) {
-        return;
-    }
-
-    game->elapsedTime += dt;
-
-    /* Score increases gradually over time */
-    game->score += (int)(dt * 20.0f); /* 20 points per second */
-
-    update_player(game, dt);
-    update_obstacles(game, dt);
-
-    /* Spawn new obstacles based on dynamic interval */
-    Uint32 now = SDL_GetTicks();
-    if ((float)(now - game->lastSpawnTicks) >= game->spawnIntervalMs) {
-        spawn_obstacle(game);
-    }
-
-    /* Check for game over */
-    if (check_collisions(game)) {
-        game->state = GAME_STATE_GAME_OVER;
-        if (game->score > game->highScore) {
-            game->highScore = game->score;
-            save_high_score(HIGHSCORE_FILE, game->highScore);
-            LOG_INFO("New high score: %d", game->highScore);
-        }
-    }
-}
-
-/* ---------------------------- Rendering ---------------------------------- */
-
-static void draw_filled_rect(SDL_Renderer *renderer,
-                             float x, float y, float w, float h,
-                             Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
-    SDL_Rect rect;
-    rect.x = (int)roundf(x);
-    rect.y = (int)roundf(y);
-    rect.w = (int)roundf(w);
-    rect.h = (int)roundf(h);
-
-    SDL_SetRenderDrawColor(renderer, r, g, b, a);
-    SDL_RenderFillRect(renderer, &rect);
-}
-
-static void render_game(const Game *game) {
-    SDL_Renderer *renderer = game->renderer;
-
-    /* Background */
-    SDL_SetRenderDrawColor(renderer,
-                           BACKGROUND_COLOR_R,
-                           BACKGROUND_COLOR_G,
-                           BACKGROUND_COLOR_B,
-                           255);
-    SDL_RenderClear(renderer);
-
-    /* Player */
-    draw_filled_rect(renderer,
-                     game->player.x,
-                     game->player.y,
-                     game->player.w,
-                     game->player.h,
-                     PLAYER_COLOR_R,
-                     PLAYER_COLOR_G,
-                     PLAYER_COLOR_B,
-                     255);
-
-    /* Obstacles */
-    for (int i = 0; i < MAX_OBSTACLES; ++i) {
-        const Obstacle *o = &game->obstacles[i];
-        if (!o->active) continue;
-
-        draw_filled_rect(renderer,
-                         o->x,
-                         o->y,
-                         o->w,
-                         o->h,
-                         OBSTACLE_COLOR_R,
-                         OBSTACLE_COLOR_G,
-                         OBSTACLE_COLOR_B,
-                         255);
-    }
-
-    /* State overlays (semi-transparent tint) */
-    if (game->state == GAME_STATE_MENU) {
-        draw_filled_rect(renderer,
-                         0, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
-                         0, 0, 0, MENU_TINT_ALPHA);
-    } else if (game->state == GAME_STATE_PAUSED) {
-        draw_filled_rect(renderer,
-                         0, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
-                         0, 0, 0, PAUSE_TINT_ALPHA);
-    } else if (game->state == GAME_STATE_GAME_OVER) {
-        draw_filled_rect(renderer,
-                         0, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
-                         120, 0, 0, GAME_OVER_TINT_ALPHA);
-    }
-
-    SDL_RenderPresent(renderer);
-}
-
-/* ------------------------------ Main Loop -------------------------------- */
-
-int main(int argc, char *argv[]) {
-    (void)argc;
-    (void)argv;
-
-    Game game;
-    if (!init_game(&game)) {
-        return EXIT_FAILURE;
-    }
-
-    Uint32 lastTicks = SDL_GetTicks();
-
-    while (game.running) {
-    Uint32 currentTicks = SDL_GetTicks();
-    Uint32 deltaMs = currentTicks - lastTicks;
-    lastTicks = currentTicks;
-    float dt = deltaMs / 1000.0f;
-
-    if (dt > 0.1f) dt = 0.1f;
-
-    process_events(&game);
-    update_game(&game, dt);
-    update_window_title(&game);
-    render_game(&game);
-}
-
-
-    shutdown_sdl(&game);
-    return EXIT_SUCCESS;
-}
+/*
+ * Endless Dodge - A small, production-ready 2D arcade game in C using SDL2.
+ *
+ * Features:
+ *  - Simple and addictive dodge gameplay (endless, increasing difficulty).
+ *  - Game states: MENU, PLAYING, PAUSED, GAME_OVER.
+ *  - High score persistence to a local file (highscore.dat).
+ *  - Error-checked SDL initialization and resource management.
+ *  - Window title shows score, high score, and state.
+ *  - 1 kHz input sampling and adaptive sim ticks, decoupled from rendering.
+ *  - `--agent` mode: batches of headless sims driven by another process.
+ *  - `--profile[=file]` mode: built-in sampling profiler writing folded stacks.
+ *  - `--tournament` mode: ranks dlopen()ed bots (see bot.h) on shared seeds.
+ *  - `--train` mode: evolves MLP policies for the tournament.
+ *
+ * Controls:
+ *  - Move Left:  A or Left Arrow
+ *  - Move Right: D or Right Arrow
+ *  - Start / Restart: Enter
+ *  - Pause / Resume: P
+ *  - Killcam replay: R (on the game over screen)
+ *  - Quit: Esc or close window
+ */
+
+#define _GNU_SOURCE  /* frame registers, pthread_getattr_np, dladdr */
+
+#include <SDL.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+#include <string.h>
+#include <float.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <pthread.h>
+#include <ucontext.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+
+#include "sim.h"
+#include "bot.h"
+#include "mlp.h"
+#include "jobs.h"
+
+/* ----------------------------- Configuration ----------------------------- */
+
+#define TARGET_FPS     60
+#define FRAME_TIME_MS  (1000 / TARGET_FPS)
+
+/*
+ * With vsync, each frame starts as late as it can and still make the next
+ * vblank: predicted render cost plus a safety margin before it. The margin
+ * doubles on a missed vblank and decays back while frames make it.
+ */
+#define FRAME_MARGIN_MIN_US   1000
+#define FRAME_MARGIN_INIT_US  2000
+
+/*
+ * The sim itself lives in sim.c; the main loop samples input every
+ * INPUT_SAMPLE_MS and catches up on sim ticks between samples.
+ */
+#define SIM_MAX_CATCHUP_MS   100     /* drop sim time beyond this after a stall */
+#define INPUT_SAMPLE_MS      1
+#define INPUT_QUEUE_SIZE     256     /* power of two */
+
+/* Late latching (`--late-latch`): longest extrapolation past a snapshot */
+#define LATE_LATCH_MAX_US    50000
+
+/*
+ * Spectating (`--spectate`): a bot plays at up to SPECTATE_MAX_SPEED times
+ * real time. Each loop iteration steps for at most SPECTATE_SLICE_US of wall
+ * time before input is sampled and a snapshot published again.
+ */
+#define SPECTATE_DEFAULT_SPEED  10
+#define SPECTATE_MAX_SPEED      1024
+#define SPECTATE_SLICE_US       4000
+#define SPECTATE_TITLE_MS       250
+
+#define BACKGROUND_COLOR_R 15
+#define BACKGROUND_COLOR_G 15
+#define BACKGROUND_COLOR_B 25
+
+#define PLAYER_COLOR_R 60
+#define PLAYER_COLOR_G 220
+#define PLAYER_COLOR_B 120
+
+#define OBSTACLE_COLOR_R 230
+#define OBSTACLE_COLOR_G 60
+#define OBSTACLE_COLOR_B 80
+
+#define MENU_TINT_ALPHA      120
+#define PAUSE_TINT_ALPHA     120
+#define GAME_OVER_TINT_ALPHA 160
+
+static const char *HIGHSCORE_FILE = "highscore.dat";
+
+/* Crash resume: the run in progress is checkpointed into a mapped file */
+static const char *RESUME_FILE = "resume.dat";
+#define RESUME_INTERVAL_MS  2000
+#define RESUME_MAGIC        0x53524445u  /* "EDRS" */
+#define RESUME_VERSION      3
+#define RESUME_SLOT_BYTES   4096         /* one page per slot */
+
+/* Telemetry: one record per finished run, appended to a local log */
+static const char *TELEMETRY_FILE = "telemetry.bin";
+#define TELEMETRY_MAGIC        0x4C544445u  /* "EDTL" */
+#define TELEMETRY_VERSION      1
+#define TELEMETRY_SAMPLE_US    1000000      /* score curve: one point a second */
+#define TELEMETRY_MAX_SAMPLES  3600
+#define TELEMETRY_RING_SIZE    4            /* power of two; runs awaiting the writer */
+#define GAME_TIMER_TELEMETRY   SIM_TIMER_OWNER
+
+/* Leaderboard client */
+#define LEADERBOARD_DEFAULT_HOST    "127.0.0.1"
+#define LEADERBOARD_DEFAULT_PORT    7777
+#define LEADERBOARD_RING_SIZE       16     /* power of two */
+#define LEADERBOARD_MAX_PENDING     256
+#define LEADERBOARD_BATCH_SIZE      32
+#define LEADERBOARD_IO_TIMEOUT_MS   2000
+#define LEADERBOARD_IDLE_MS         1000
+#define LEADERBOARD_BACKOFF_MIN_MS  1000
+#define LEADERBOARD_BACKOFF_MAX_MS  60000
+#define LEADERBOARD_QUEUE_MAGIC     0x51444C45u  /* "ELDQ" */
+
+static const char *LEADERBOARD_QUEUE_FILE = "leaderboard_queue.dat";
+
+/* ------------------------------ Logging ---------------------------------- */
+
+/*
+ * Deferred-formatting logger. A call site costs a level check, a rate-limit
+ * check and a copy of its raw arguments into the calling thread's lock-free
+ * ring; a background thread merges the rings in time order, formats and
+ * writes. Each call site owns a static LogSite holding its format string and
+ * the argument kinds parsed from it on first use. Each site is limited to
+ * LOG_RATE_LIMIT records a second, except errors and LOG_REPORT lines, the
+ * one-shot tables tools print in a loop. Formats the parser cannot
+ * capture (too many arguments, %n, ...) fall back to formatting in place, as
+ * does any logging before log_init() or after log_shutdown().
+ */
+
+#define LOG_RING_SLOTS     512    /* records per thread; power of two */
+#define LOG_MAX_RINGS      32
+#define LOG_MAX_ARGS       8
+#define LOG_STRING_BYTES   168    /* copied %s text per record */
+#define LOG_RATE_LIMIT     20     /* records per call site per second, below ERROR */
+#define LOG_FLUSH_MS       5
+#define LOG_LINE_BYTES     1024
+
+typedef enum {
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR
+} LogLevel;
+
+typedef enum {
+    LOG_ARG_INT = 0,
+    LOG_ARG_UINT,
+    LOG_ARG_LONG,
+    LOG_ARG_ULONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_ULLONG,
+    LOG_ARG_SIZE,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_PTR,
+    LOG_ARG_STR
+} LogArgKind;
+
+enum {
+    LOG_SITE_UNPARSED = 0,
+    LOG_SITE_PARSING,
+    LOG_SITE_READY,
+    LOG_SITE_SYNC       /* format not capturable; always format in place */
+};
+
+typedef struct LogSite {
+    LogLevel        level;
+    int             report;      /* LOG_REPORT: never limited or dropped */
+    const char     *format;
+    SDL_atomic_t    state;
+    SDL_atomic_t    window;      /* second of the current rate-limit window */
+    SDL_atomic_t    count;       /* records in that window */
+    SDL_atomic_t    suppressed;  /* dropped by the limit, not yet reported */
+    int             argCount;
+    Uint8           kinds[LOG_MAX_ARGS];
+    struct LogSite *next;        /* parsed sites, for suppression reports */
+} LogSite;
+
+typedef union {
+    long long          i;
+    unsigned long long u;
+    double             d;
+    const void        *p;
+} LogArg;
+
+typedef struct {
+    const LogSite *site;
+    Uint64         time;        /* performance counter */
+    LogArg         args[LOG_MAX_ARGS];
+    char           strings[LOG_STRING_BYTES];
+} LogRecord;
+
+enum {
+    LOG_RING_OWNED = 1,
+    LOG_RING_ORPHANED,  /* owner exited; drain, then reuse */
+    LOG_RING_FREE
+};
+
+/* Single producer (the owning thread), single consumer (the log thread) */
+typedef struct {
+    SDL_atomic_t head;
+    SDL_atomic_t tail;
+    SDL_atomic_t dropped;
+    SDL_atomic_t state;
+    LogRecord    records[LOG_RING_SLOTS];
+} LogRing;
+
+typedef struct {
+    SDL_atomic_t  running;
+    SDL_atomic_t  quit;
+    SDL_atomic_t  ringCount;
+    void         *rings[LOG_MAX_RINGS];  /* LogRing *, published atomically */
+    void         *sites;                 /* LogSite list head */
+    SDL_TLSID     tls;
+    SDL_Thread   *thread;
+    SDL_sem      *wake;
+    Uint64        perfFreq;
+    int           threshold;
+} Logger;
+
+static Logger logger = { .threshold = LOG_LEVEL_INFO };
+
+static const char *LOG_LEVEL_NAMES[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+/*
+ * Find the next conversion in `fmt`. Sets its span and the kinds of the
+ * arguments it consumes ('*' widths first); returns the number of those, 0
+ * at the end of the string, or -1 for a conversion that cannot be captured.
+ */
+static int log_scan(const char **fmt, const char **start, const char **end,
+                    LogArgKind *kinds) {
+    const char *p = *fmt;
+    int n = 0;
+
+    for (;;) {
+        while (*p && *p != '%') ++p;
+        if (!*p) {
+            *fmt = p;
+            return 0;
+        }
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+        break;
+    }
+
+    *start = p++;
+    while (*p && strchr("-+ #0", *p)) ++p;
+    if (*p == '*') { kinds[n++] = LOG_ARG_INT; ++p; }
+    while (*p >= '0' && *p <= '9') ++p;
+    if (*p == '.') {
+        ++p;
+        if (*p == '*') { kinds[n++] = LOG_ARG_INT; ++p; }
+        while (*p >= '0' && *p <= '9') ++p;
+    }
+
+    int longs = 0;
+    int size = 0;
+    while (*p == 'l' || *p == 'h' || *p == 'z') {
+        longs += *p == 'l';
+        size  |= *p == 'z';
+        ++p;
+    }
+
+    LogArgKind kind;
+    switch (*p) {
+        case 'd': case 'i': case 'c':
+            kind = size ? LOG_ARG_SIZE : longs == 0 ? LOG_ARG_INT :
+                   longs == 1 ? LOG_ARG_LONG : LOG_ARG_LLONG;
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            kind = size ? LOG_ARG_SIZE : longs == 0 ? LOG_ARG_UINT :
+                   longs == 1 ? LOG_ARG_ULONG : LOG_ARG_ULLONG;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+            kind = LOG_ARG_DOUBLE;
+            break;
+        case 'p':
+            kind = LOG_ARG_PTR;
+            break;
+        case 's':
+            kind = LOG_ARG_STR;
+            break;
+        default:
+            return -1;
+    }
+    kinds[n++] = kind;
+    *end = ++p;
+    *fmt = p;
+    return n;
+}
+
+/* Parse a site's argument kinds once; racing threads format in place */
+static int log_site_ready(LogSite *site) {
+    int state = SDL_AtomicGet(&site->state);
+    if (state == LOG_SITE_READY || state == LOG_SITE_SYNC) {
+        return state == LOG_SITE_READY;
+    }
+    if (!SDL_AtomicCAS(&site->state, LOG_SITE_UNPARSED, LOG_SITE_PARSING)) {
+        return 0;
+    }
+
+    const char *fmt = site->format;
+    const char *start;
+    const char *end;
+    LogArgKind kinds[3];
+    int n;
+    int count = 0;
+    while ((n = log_scan(&fmt, &start, &end, kinds)) > 0 &&
+           count + n <= LOG_MAX_ARGS) {
+        for (int i = 0; i < n; ++i) {
+            site->kinds[count++] = (Uint8)kinds[i];
+        }
+    }
+    site->argCount = count;
+    if (n == 0) {
+        do {
+            site->next = (LogSite *)SDL_AtomicGetPtr(&logger.sites);
+        } while (!SDL_AtomicCASPtr(&logger.sites, site->next, site));
+    }
+    SDL_AtomicSet(&site->state, n == 0 ? LOG_SITE_READY : LOG_SITE_SYNC);
+    return n == 0;
+}
+
+/* Format in place, for uncapturable formats and when no logger is running */
+static void log_write_sync(const LogSite *site, va_list ap) {
+    FILE *out = site->level >= LOG_LEVEL_WARN ? stderr : stdout;
+    fprintf(out, "[%s] ", LOG_LEVEL_NAMES[site->level]);
+    vfprintf(out, site->format, ap);
+    fputc('\n', out);
+}
+
+static void log_release_ring(void *data) {
+    SDL_AtomicSet(&((LogRing *)data)->state, LOG_RING_ORPHANED);
+}
+
+/* The calling thread's ring; claimed on its first record */
+static LogRing *log_thread_ring(void) {
+    LogRing *ring = (LogRing *)SDL_TLSGet(logger.tls);
+    if (ring) {
+        return ring;
+    }
+
+    int count = SDL_AtomicGet(&logger.ringCount);
+    for (int i = 0; i < count && !ring; ++i) {
+        LogRing *r = (LogRing *)SDL_AtomicGetPtr(&logger.rings[i]);
+        if (r && SDL_AtomicCAS(&r->state, LOG_RING_FREE, LOG_RING_OWNED)) {
+            ring = r;
+        }
+    }
+    if (!ring) {
+        int index = SDL_AtomicAdd(&logger.ringCount, 1);
+        if (index >= LOG_MAX_RINGS) {
+            SDL_AtomicAdd(&logger.ringCount, -1);
+            return NULL;
+        }
+        ring = (LogRing *)calloc(1, sizeof(LogRing));
+        if (!ring) {
+            return NULL;
+        }
+        SDL_AtomicSet(&ring->state, LOG_RING_OWNED);
+        SDL_AtomicSetPtr(&logger.rings[index], ring);
+    }
+
+    SDL_TLSSet(logger.tls, ring, log_release_ring);
+    return ring;
+}
+
+/* Nonzero if the site is over its rate; counts what it drops */
+static int log_rate_limited(LogSite *site, Uint64 now) {
+    int second = (int)(now / logger.perfFreq);
+    int window = SDL_AtomicGet(&site->window);
+
+    if (window != second && SDL_AtomicCAS(&site->window, window, second)) {
+        SDL_AtomicSet(&site->count, 0);
+    }
+    if (SDL_AtomicAdd(&site->count, 1) >= LOG_RATE_LIMIT) {
+        SDL_AtomicIncRef(&site->suppressed);
+        return 1;
+    }
+    return 0;
+}
+
+static void log_write(LogSite *site, ...) {
+    va_list ap;
+    va_start(ap, site);
+
+    LogRing *ring = NULL;
+    if (!SDL_AtomicGet(&logger.running) || !log_site_ready(site) ||
+        !(ring = log_thread_ring())) {
+        log_write_sync(site, ap);
+        va_end(ap);
+        return;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (site->level < LOG_LEVEL_ERROR && !site->report &&
+        log_rate_limited(site, now)) {
+        va_end(ap);
+        return;
+    }
+
+    int head = SDL_AtomicGet(&ring->head);
+    while (head - SDL_AtomicGet(&ring->tail) == LOG_RING_SLOTS) {
+        if (!site->report) {
+            SDL_AtomicIncRef(&ring->dropped);
+            va_end(ap);
+            return;
+        }
+        /* A report line waits for the log thread rather than go missing */
+        SDL_SemPost(logger.wake);
+        SDL_Delay(1);
+    }
+
+    LogRecord *rec = &ring->records[head & (LOG_RING_SLOTS - 1)];
+    size_t used = 0;
+    rec->site = site;
+    rec->time = now;
+    for (int i = 0; i < site->argCount; ++i) {
+        LogArg *a = &rec->args[i];
+        switch ((LogArgKind)site->kinds[i]) {
+            case LOG_ARG_INT:    a->i = va_arg(ap, int);                break;
+            case LOG_ARG_UINT:   a->u = va_arg(ap, unsigned);           break;
+            case LOG_ARG_LONG:   a->i = va_arg(ap, long);               break;
+            case LOG_ARG_ULONG:  a->u = va_arg(ap, unsigned long);      break;
+            case LOG_ARG_LLONG:  a->i = va_arg(ap, long long);          break;
+            case LOG_ARG_ULLONG: a->u = va_arg(ap, unsigned long long); break;
+            case LOG_ARG_SIZE:   a->u = va_arg(ap, size_t);             break;
+            case LOG_ARG_DOUBLE: a->d = va_arg(ap, double);             break;
+            case LOG_ARG_PTR:    a->p = va_arg(ap, void *);             break;
+            case LOG_ARG_STR: {
+                /* Copy the text; the caller's pointer may not outlive the call */
+                const char *s = va_arg(ap, const char *);
+                size_t len = s ? strlen(s) : 0;
+                if (len > LOG_STRING_BYTES - 1 - used) {
+                    len = LOG_STRING_BYTES - 1 - used;  /* truncate */
+                }
+                if (len) {
+                    memcpy(rec->strings + used, s, len);
+                }
+                rec->strings[used + len] = '\0';
+                a->u = s ? used + 1 : 0;  /* offset + 1; 0 for NULL */
+                used += len + (used + len + 1 < LOG_STRING_BYTES);
+                break;
+            }
+        }
+    }
+    va_end(ap);
+
+    SDL_AtomicSet(&ring->head, head + 1);
+    if (site->level >= LOG_LEVEL_ERROR) {
+        SDL_SemPost(logger.wake);  /* errors are written promptly */
+    }
+}
+
+/* Append one conversion of a record to `line`, with '*' widths expanded */
+static size_t log_format_arg(char *line, size_t size, const char *start,
+                             const char *end, LogArgKind kind,
+                             const LogRecord *rec, int *arg) {
+    char spec[64];
+    size_t n = 0;
+
+    for (const char *p = start; p < end && n < sizeof(spec) - 24; ++p) {
+        if (*p == '*') {
+            n += (size_t)snprintf(spec + n, sizeof(spec) - n, "%d",
+                                  (int)rec->args[(*arg)++].i);
+        } else {
+            spec[n++] = *p;
+        }
+    }
+    spec[n] = '\0';
+
+    const LogArg *a = &rec->args[(*arg)++];
+    int written = 0;
+    switch (kind) {
+        case LOG_ARG_INT:    written = snprintf(line, size, spec, (int)a->i);                break;
+        case LOG_ARG_UINT:   written = snprintf(line, size, spec, (unsigned)a->u);           break;
+        case LOG_ARG_LONG:   written = snprintf(line, size, spec, (long)a->i);               break;
+        case LOG_ARG_ULONG:  written = snprintf(line, size, spec, (unsigned long)a->u);      break;
+        case LOG_ARG_LLONG:  written = snprintf(line, size, spec, (long long)a->i);          break;
+        case LOG_ARG_ULLONG: written = snprintf(line, size, spec, (unsigned long long)a->u); break;
+        case LOG_ARG_SIZE:   written = snprintf(line, size, spec, (size_t)a->u);             break;
+        case LOG_ARG_DOUBLE: written = snprintf(line, size, spec, a->d);                     break;
+        case LOG_ARG_PTR:    written = snprintf(line, size, spec, a->p);                     break;
+        case LOG_ARG_STR:
+            written = snprintf(line, size, spec,
+                               a->u ? rec->strings + (a->u - 1) : "(null)");
+            break;
+    }
+    return written < 0 ? 0 : (size_t)written;
+}
+
+static void log_emit(const LogRecord *rec) {
+    const LogSite *site = rec->site;
+    char line[LOG_LINE_BYTES];
+    size_t len = (size_t)snprintf(line, sizeof(line), "[%s] ",
+                                  LOG_LEVEL_NAMES[site->level]);
+
+    const char *fmt = site->format;
+    const char *start;
+    const char *end;
+    LogArgKind kinds[3];
+    int arg = 0;
+    int n;
+    for (;;) {
+        const char *literal = fmt;
+        n = log_scan(&fmt, &start, &end, kinds);
+        const char *stop = n > 0 ? start : fmt;
+        for (const char *p = literal; p < stop && len < sizeof(line) - 1; ++p) {
+            line[len++] = *p;
+            if (p[0] == '%' && p[1] == '%') ++p;
+        }
+        if (n <= 0 || len >= sizeof(line) - 1) {
+            break;
+        }
+        len += log_format_arg(line + len, sizeof(line) - len, start, end,
+                              kinds[n - 1], rec, &arg);
+        if (len > sizeof(line) - 1) len = sizeof(line) - 1;
+    }
+    line[len] = '\0';
+
+    FILE *out = site->level >= LOG_LEVEL_WARN ? stderr : stdout;
+    fputs(line, out);
+    fputc('\n', out);
+}
+
+/* Report sites whose rate-limit window has closed with records dropped */
+static void log_report_suppressed(int final) {
+    int second = (int)(SDL_GetPerformanceCounter() / logger.perfFreq);
+
+    for (LogSite *site = (LogSite *)SDL_AtomicGetPtr(&logger.sites); site;
+         site = site->next) {
+        if (!final && SDL_AtomicGet(&site->window) == second) {
+            continue;
+        }
+        int n = SDL_AtomicSet(&site->suppressed, 0);
+        if (n > 0) {
+            fprintf(site->level >= LOG_LEVEL_WARN ? stderr : stdout,
+                    "[%s] (%d more \"%s\" suppressed)\n",
+                    LOG_LEVEL_NAMES[site->level], n, site->format);
+        }
+    }
+}
+
+/* Write every pending record, oldest first across all rings */
+static void log_drain(int final) {
+    int count = SDL_AtomicGet(&logger.ringCount);
+    if (count > LOG_MAX_RINGS) count = LOG_MAX_RINGS;
+
+    for (;;) {
+        LogRing *oldest = NULL;
+        Uint64 oldestTime = 0;
+        for (int i = 0; i < count; ++i) {
+            LogRing *r = (LogRing *)SDL_AtomicGetPtr(&logger.rings[i]);
+            if (!r) continue;
+            int tail = SDL_AtomicGet(&r->tail);
+            if (tail == SDL_AtomicGet(&r->head)) continue;
+            const LogRecord *rec = &r->records[tail & (LOG_RING_SLOTS - 1)];
+            if (!oldest || rec->time < oldestTime) {
+                oldest = r;
+                oldestTime = rec->time;
+            }
+        }
+        if (!oldest) {
+            break;
+        }
+        int tail = SDL_AtomicGet(&oldest->tail);
+        log_emit(&oldest->records[tail & (LOG_RING_SLOTS - 1)]);
+        SDL_AtomicSet(&oldest->tail, tail + 1);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        LogRing *r = (LogRing *)SDL_AtomicGetPtr(&logger.rings[i]);
+        if (!r) continue;
+        int dropped = SDL_AtomicSet(&r->dropped, 0);
+        if (dropped > 0) {
+            fprintf(stderr, "[WARN] %d log records dropped (ring full)\n", dropped);
+        }
+        if (SDL_AtomicGet(&r->tail) == SDL_AtomicGet(&r->head)) {
+            SDL_AtomicCAS(&r->state, LOG_RING_ORPHANED, LOG_RING_FREE);
+        }
+    }
+    log_report_suppressed(final);
+
+    fflush(stdout);
+    fflush(stderr);
+}
+
+static int log_thread_main(void *data) {
+    (void)data;
+    while (!SDL_AtomicGet(&logger.quit)) {
+        SDL_SemWaitTimeout(logger.wake, LOG_FLUSH_MS);
+        log_drain(0);
+    }
+    log_drain(1);
+    return 0;
+}
+
+static LogLevel log_level_from_env(void) {
+    const char *env = getenv("ENDLESS_DODGE_LOG_LEVEL");
+    for (int i = LOG_LEVEL_DEBUG; env && i <= LOG_LEVEL_ERROR; ++i) {
+        if (SDL_strcasecmp(env, LOG_LEVEL_NAMES[i]) == 0) {
+            return (LogLevel)i;
+        }
+    }
+    return LOG_LEVEL_INFO;
+}
+
+/* Start the log thread; without it every record is formatted in place */
+static void log_init(void) {
+    logger.threshold = log_level_from_env();
+    logger.perfFreq  = SDL_GetPerformanceFrequency();
+    logger.tls       = SDL_TLSCreate();
+    logger.wake      = SDL_CreateSemaphore(0);
+    if (!logger.tls || !logger.wake) {
+        return;
+    }
+    logger.thread = SDL_CreateThread(log_thread_main, "log", NULL);
+    if (logger.thread) {
+        SDL_AtomicSet(&logger.running, 1);
+    }
+}
+
+/* Flush and stop the log thread; later records are formatted in place */
+static void log_shutdown(void) {
+    if (!SDL_AtomicSet(&logger.running, 0)) {
+        return;
+    }
+    SDL_AtomicSet(&logger.quit, 1);
+    SDL_SemPost(logger.wake);
+    SDL_WaitThread(logger.thread, NULL);
+    SDL_DestroySemaphore(logger.wake);
+    logger.thread = NULL;
+    logger.wake = NULL;
+}
+
+/*
+ * `fmt` must be a string literal. The dead printf keeps compile-time format
+ * checking for the deferred arguments.
+ */
+#define LOG_SITE(lvl, report, fmt, ...) do {                         \
+        static LogSite logSite_ = { lvl, report, fmt, { 0 }, { 0 },  \
+                                    { 0 }, { 0 }, 0, { 0 }, NULL };  \
+        if ((int)(lvl) >= logger.threshold) {                        \
+            log_write(&logSite_, ##__VA_ARGS__);                     \
+        }                                                            \
+        if (0) printf(fmt, ##__VA_ARGS__);                           \
+    } while (0)
+
+#define LOG_AT(lvl, fmt, ...) LOG_SITE(lvl, 0, fmt, ##__VA_ARGS__)
+
+#define LOG_DEBUG(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...)  LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...)  LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOG_ERROR(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+
+/* An INFO line of a tool's report table: printed in full, never limited */
+#define LOG_REPORT(fmt, ...) LOG_SITE(LOG_LEVEL_INFO, 1, fmt, ##__VA_ARGS__)
+
+/* ------------------------------- Types ----------------------------------- */
+
+typedef enum {
+    GAME_STATE_MENU = 0,
+    GAME_STATE_PLAYING,
+    GAME_STATE_PAUSED,
+    GAME_STATE_GAME_OVER,
+    GAME_STATE_REPLAY
+} GameState;
+
+/* Key transition captured by the input sampler, applied at its sim tick */
+typedef struct {
+    Uint32      timestamp;  /* SDL event time, ms */
+    Uint32      type;       /* SDL_KEYDOWN or SDL_KEYUP */
+    SDL_Keycode key;
+} InputEvent;
+
+typedef struct {
+    InputEvent events[INPUT_QUEUE_SIZE];
+    int        head;
+    int        tail;
+} InputQueue;
+
+/* Everything the render thread needs to draw one frame */
+typedef struct {
+    GameState state;
+    Player    player;
+    Obstacle  obstacles[MAX_OBSTACLES];
+    Uint64    simCounter;  /* performance counter time the sim state is at */
+} RenderState;
+
+/* Player quad first, then one quad per obstacle, drawn in a single call */
+#define RENDER_MAX_QUADS  (1 + MAX_OBSTACLES)
+
+/*
+ * One frame's draw commands, as built from a RenderState and submitted to
+ * the renderer. `--record-render` writes these to disk, so a replay submits
+ * exactly what the game did.
+ */
+typedef struct {
+    SDL_Color  clear;
+    int        quads;        /* `vertices` holds four per quad */
+    int        overlay;      /* OverlayLayer on top, or -1 */
+    SDL_Vertex vertices[4 * RENDER_MAX_QUADS];
+} RenderFrame;
+
+#define RENDER_SLOT_FRESH 4  /* flag on `latest`: slot not yet drawn */
+
+typedef enum {
+    OVERLAY_MENU = 0,
+    OVERLAY_PAUSED,
+    OVERLAY_GAME_OVER,
+    OVERLAY_COUNT
+} OverlayLayer;
+
+/*
+ * Static full-screen UI layers, drawn once into target textures and then
+ * composited with a single copy per frame. A layer is rebuilt only when
+ * invalidated: on content change or when the driver loses its targets.
+ */
+typedef struct {
+    SDL_Texture *textures[OVERLAY_COUNT];
+    int          valid[OVERLAY_COUNT];
+    int          unsupported;  /* no render targets; draw layers directly */
+} OverlayCache;
+
+/* Just-in-time frame start; times are performance counter values */
+typedef struct {
+    Uint64 freq;
+    Uint64 refresh;     /* one display refresh */
+    Uint64 vblank;      /* last present's return, 0 until the first */
+    Uint64 cost;        /* predicted render cost: a slowly decaying peak */
+    Uint64 margin;
+    Uint64 marginMin;
+    Uint32 frames;
+    Uint32 missed;
+} FrameScheduler;
+
+/*
+ * `--mirror`: a second window for spectators showing the player's frames.
+ * Its own thread and renderer submit each RenderFrame the render thread
+ * built, taken from a second triple buffer, and present at the mirror
+ * display's rate. The render thread never waits for it, so a slow display
+ * only drops mirror frames. SDL renderers cannot share textures, so it
+ * caches its own overlays.
+ */
+typedef struct {
+    SDL_Thread   *thread;
+    SDL_sem      *ready;
+    SDL_atomic_t  quit;
+    SDL_atomic_t  ok;
+    SDL_atomic_t  targetsLost;
+
+    SDL_Window   *window;     /* NULL without --mirror */
+    SDL_Renderer *renderer;   /* created and used on the mirror thread */
+    OverlayCache  overlays;
+    int           refreshHz;
+    FrameScheduler frames;
+    int           readSlot;   /* mirror thread only */
+    Uint32        shown;      /* distinct frames presented */
+} MirrorOutput;
+
+/*
+ * The render thread owns the renderer and presents at display rate, so vsync
+ * never blocks input sampling or the sim. Snapshots are handed over through a
+ * lock-free triple buffer.
+ */
+typedef struct {
+    SDL_Thread   *thread;
+    SDL_sem      *ready;      /* posted once the renderer exists (or failed) */
+    SDL_atomic_t  quit;
+    SDL_atomic_t  ok;
+    SDL_atomic_t  latest;     /* last published slot | RENDER_SLOT_FRESH */
+    int           writeSlot;  /* main thread only */
+    int           readSlot;   /* render thread only */
+    RenderState   slots[3];
+    SDL_atomic_t  targetsLost;  /* 1: target contents lost, 2: textures lost */
+
+    SDL_Window   *window;
+    SDL_Renderer *renderer;   /* created and used on the render thread */
+    OverlayCache  overlays;
+    int           refreshHz;  /* of the window's display, 0 if unknown */
+    FrameScheduler frames;
+
+    int           lateLatch;    /* re-extrapolate the player before present */
+    SDL_Scancode  latchLeft[2];
+    SDL_Scancode  latchRight[2];
+    RenderFrame   built[3];     /* frames built in place; the mirror reads them */
+    int           buildSlot;    /* being built, render thread only */
+    SDL_atomic_t  builtLatest;  /* last built slot | RENDER_SLOT_FRESH */
+    int           indices[6 * RENDER_MAX_QUADS];  /* read-only once started */
+    MirrorOutput  mirror;
+
+    FILE         *record;       /* `--record-render` output, or NULL */
+    Uint64        recordStart;  /* performance counter at the first frame */
+} RenderThread;
+
+/* One crash-resume checkpoint; a zero magic marks the slot empty */
+typedef struct {
+    Uint32      magic;
+    Uint32      version;
+    Uint64      sequence;     /* the newest valid slot wins */
+    Uint64      checksum;     /* FNV-1a of the slot with this field zero */
+    Uint32      savedAt;      /* unix time */
+    Uint32      bytes;        /* sizeof(SimSnapshot) */
+    SimSnapshot sim;
+} ResumeSlot;
+
+typedef char resume_slot_fits_a_page[
+    sizeof(ResumeSlot) <= RESUME_SLOT_BYTES ? 1 : -1];
+
+/*
+ * Crash-resume checkpoints: two page-sized slots in a shared mapping of
+ * RESUME_FILE, written alternately, so one of them is always whole. The game
+ * thread fills `staged` and hands the newest over through `latest`, triple
+ * buffered like RenderState; the writer thread owns the mapping.
+ */
+typedef struct {
+    int           fd;
+    Uint8        *map;          /* NULL when resume is off or unavailable */
+    Uint64        sequence;     /* of the newest slot written */
+    Uint32        lastSaveMs;
+    int           offered;      /* a saved run waits at the menu for Y or N */
+
+    SDL_Thread   *thread;       /* NULL: saves write the mapping directly */
+    SDL_sem      *wake;
+    SDL_atomic_t  quit;
+    SDL_atomic_t  latest;       /* last staged slot | RENDER_SLOT_FRESH */
+    int           stageSlot;    /* game thread */
+    int           writeSlot;    /* writer thread */
+    ResumeSlot    staged[3];
+} ResumeFile;
+
+/* One telemetry log record, as stored in the file after its header */
+typedef struct {
+    Uint32 bytes;        /* this header and the curve after it */
+    Uint32 score;
+    Uint32 durationMs;   /* sim time at death */
+    float  deathX;       /* player x at the collision */
+    Uint16 obstacles;    /* active at death */
+    Uint16 curveStart;   /* second of the first curve point */
+    Uint16 curveCount;
+    Uint16 reserved;
+} TelemetryRecord;
+
+/* A finished run waiting for the telemetry writer */
+typedef struct {
+    TelemetryRecord record;
+    Uint32          curve[TELEMETRY_MAX_SAMPLES];
+} TelemetryRun;
+
+typedef char telemetry_run_is_contiguous[
+    offsetof(TelemetryRun, curve) == sizeof(TelemetryRecord) ? 1 : -1];
+
+/*
+ * The score curve of the run in progress, written out when it ends. The game
+ * thread pushes finished runs into `ring` and posts `wake`; the writer thread
+ * does all the file I/O.
+ */
+typedef struct {
+    const char   *path;         /* NULL when telemetry is off */
+    int           curveStart;   /* second of curve[0] */
+    int           curveCount;
+    Uint32        curve[TELEMETRY_MAX_SAMPLES];
+
+    SDL_Thread   *thread;       /* NULL: runs are appended directly */
+    SDL_sem      *wake;
+    SDL_atomic_t  quit;
+    SDL_atomic_t  head;         /* next ring slot to fill (game thread) */
+    SDL_atomic_t  tail;         /* next ring slot to append (writer) */
+    TelemetryRun  ring[TELEMETRY_RING_SIZE];
+} Telemetry;
+
+/* One finished run, as queued for and sent to the leaderboard */
+typedef struct {
+    Sint32 score;
+    Uint32 timestamp;  /* unix time the run ended */
+} ScoreEntry;
+
+/*
+ * Background leaderboard client. The game thread only pushes into `ring` and
+ * posts `wake`; the worker thread owns everything below `ring`, including all
+ * disk and network I/O.
+ */
+typedef struct {
+    SDL_Thread   *thread;
+    SDL_sem      *wake;
+    SDL_atomic_t  quit;
+    SDL_atomic_t  head;           /* next ring slot to write (game thread) */
+    SDL_atomic_t  tail;           /* next ring slot to read (worker) */
+    SDL_atomic_t  highScore;      /* latest high score to persist */
+    ScoreEntry    ring[LEADERBOARD_RING_SIZE];
+
+    char        host[256];
+    char        port[16];
+    int         savedHighScore;
+    int         pendingCount;
+    ScoreEntry  pending[LEADERBOARD_MAX_PENDING];
+} Leaderboard;
+
+typedef struct {
+    const char *leaderboardAddr;  /* "host:port", NULL for the default */
+    int         lateLatch;
+    const char *recordRenderPath; /* render command stream, NULL if off */
+    const char *spectatePath;     /* bot or policy to watch, NULL if off */
+    Uint32      spectateSpeed;
+    Uint32      spectateSeed;
+    const char *telemetryPath;    /* run log, NULL if off */
+    int         fullscreen;       /* exclusive, with its own display mode */
+    int         display;          /* index of the display to open on */
+    int         modeW, modeH;     /* fullscreen size, 0: the desktop's */
+    int         modeHz;           /* refresh, 0: the fastest at that size */
+    int         mirror;           /* open a spectator window */
+    int         mirrorDisplay;    /* its display, -1: the next one */
+} Options;
+
+typedef struct {
+    SDL_Window   *window;
+    int           running;
+
+    GameState state;
+
+    Sim    sim;              /* the current run; records into `killcam` */
+    int    highScore;
+
+    int    leftPressed;
+    int    rightPressed;
+    Uint32 speed;            /* sim time per real time; 0 unless spectating */
+
+    InputQueue   input;
+    RenderThread render;
+    Leaderboard  leaderboard;
+    Killcam      killcam;
+    ResumeFile   resume;
+    Telemetry    telemetry;
+} Game;
+
+/* -------------------------- High Score Storage --------------------------- */
+
+static int load_high_score(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        /* no file yet; high score is zero */
+        LOG_INFO("No high score file found, starting fresh.");
+        return 0;
+    }
+
+    int value = 0;
+    if (fread(&value, sizeof(int), 1, f) != 1) {
+        LOG_ERROR("Failed to read high score file; resetting to zero.");
+        value = 0;
+    }
+
+    fclose(f);
+    return value;
+}
+
+static void save_high_score(const char *path, int score) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        LOG_ERROR("Failed to open high score file for writing.");
+        return;
+    }
+
+    if (fwrite(&score, sizeof(int), 1, f) != 1) {
+        LOG_ERROR("Failed to write high score to file.");
+    }
+
+    fclose(f);
+}
+
+/* ----------------------------- Crash Resume ------------------------------ */
+
+/*
+ * A kiosk losing power mid-run can pick the run up again. Every
+ * RESUME_INTERVAL_MS the main thread snapshots the sim into a private staging
+ * slot, a few microseconds of copying and hashing, and wakes the writer
+ * thread. The writer copies it into the older of two slots of a
+ * preallocated, pre-faulted shared mapping; if the kernel has to fault or
+ * write back a page of it, only the writer waits. Writeback is left to the
+ * kernel, so a power cut can lose the last few seconds or tear the slot being
+ * written; the checksum rejects a torn slot and the other one is used
+ * instead.
+ */
+
+static Uint64 resume_hash(Uint64 h, const void *data, size_t len) {
+    const Uint8 *p = (const Uint8 *)data;
+    for (size_t i = 0; i < len; ++i) {
+        h = (h ^ p[i]) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static Uint64 resume_checksum(const ResumeSlot *slot) {
+    static const Uint64 zero = 0;
+    const Uint8 *bytes = (const Uint8 *)slot;
+    size_t at = offsetof(ResumeSlot, checksum);
+    Uint64 h = resume_hash(0xCBF29CE484222325ULL, bytes, at);
+    h = resume_hash(h, &zero, sizeof(zero));
+    at += sizeof(zero);
+    return resume_hash(h, bytes + at, sizeof(ResumeSlot) - at);
+}
+
+static int resume_slot_valid(const ResumeSlot *slot) {
+    return slot->magic == RESUME_MAGIC && slot->version == RESUME_VERSION &&
+           slot->bytes == sizeof(SimSnapshot) && slot->sequence != 0 &&
+           slot->checksum == resume_checksum(slot);
+}
+
+/* Copy a staged slot into the mapping; an empty one clears both slots */
+static void resume_write_slot(ResumeFile *rf, const ResumeSlot *slot) {
+    if (slot->magic == 0) {
+        for (int i = 0; i < 2; ++i) {
+            ((ResumeSlot *)(rf->map + i * RESUME_SLOT_BYTES))->magic = 0;
+        }
+        return;
+    }
+    memcpy(rf->map + (slot->sequence & 1) * RESUME_SLOT_BYTES, slot,
+           sizeof(*slot));
+}
+
+/* Writer thread: store the newest staged slot until told to quit */
+static int resume_writer(void *data) {
+    ResumeFile *rf = (ResumeFile *)data;
+    for (;;) {
+        SDL_SemWait(rf->wake);
+        if (SDL_AtomicGet(&rf->latest) & RENDER_SLOT_FRESH) {
+            rf->writeSlot = SDL_AtomicSet(&rf->latest, rf->writeSlot) & 3;
+            resume_write_slot(rf, &rf->staged[rf->writeSlot]);
+        }
+        if (SDL_AtomicGet(&rf->quit)) {
+            return 0;
+        }
+    }
+}
+
+/*
+ * Map the checkpoint file, creating it if needed. If it holds a run, the
+ * newest valid slot is restored into `sim` and 1 returned. Failures only
+ * turn resume off.
+ */
+static int resume_open(ResumeFile *rf, const char *path, Sim *sim) {
+    const size_t size = 2 * RESUME_SLOT_BYTES;
+
+    rf->map = NULL;
+    rf->thread = NULL;
+    rf->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (rf->fd < 0) {
+        LOG_WARN("Crash resume off: cannot open %s: %s", path, strerror(errno));
+        return 0;
+    }
+    /* Allocate the blocks now, so writeback can never run out of space */
+    if (posix_fallocate(rf->fd, 0, (off_t)size) != 0 &&
+        ftruncate(rf->fd, (off_t)size) != 0) {
+        LOG_WARN("Crash resume off: cannot size %s: %s", path, strerror(errno));
+        close(rf->fd);
+        return 0;
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, rf->fd, 0);
+    if (map == MAP_FAILED) {
+        LOG_WARN("Crash resume off: cannot map %s: %s", path, strerror(errno));
+        close(rf->fd);
+        return 0;
+    }
+    rf->map = (Uint8 *)map;
+
+    /* Take the write faults now rather than on the first save */
+    for (size_t at = 0; at < size; at += RESUME_SLOT_BYTES) {
+        volatile Uint8 *page = rf->map + at;
+        *page = *page;
+    }
+
+    const ResumeSlot *newest = NULL;
+    for (int i = 0; i < 2; ++i) {
+        const ResumeSlot *slot = (const ResumeSlot *)(rf->map + i * RESUME_SLOT_BYTES);
+        if (resume_slot_valid(slot) &&
+            (!newest || slot->sequence > newest->sequence)) {
+            newest = slot;
+        }
+    }
+    rf->sequence = newest ? newest->sequence : 0;
+    if (newest) {
+        sim_restore(sim, &newest->sim);
+    }
+
+    rf->stageSlot = 0;
+    rf->writeSlot = 1;
+    SDL_AtomicSet(&rf->latest, 2);
+    SDL_AtomicSet(&rf->quit, 0);
+    rf->wake = SDL_CreateSemaphore(0);
+    if (rf->wake) {
+        rf->thread = SDL_CreateThread(resume_writer, "resume", rf);
+    }
+    if (!rf->thread) {
+        LOG_WARN("Crash resume saves on the main thread: %s", SDL_GetError());
+    }
+    return newest != NULL;
+}
+
+/* Main thread: hand the staged slot to the writer, or write it without one */
+static void resume_publish(ResumeFile *rf) {
+    if (!rf->thread) {
+        resume_write_slot(rf, &rf->staged[rf->stageSlot]);
+        return;
+    }
+    rf->stageSlot = SDL_AtomicSet(&rf->latest,
+                                  rf->stageSlot | RENDER_SLOT_FRESH) & 3;
+    SDL_SemPost(rf->wake);
+}
+
+/* Main thread: checkpoint the run in progress */
+static void resume_save(ResumeFile *rf, const Sim *sim) {
+    if (!rf->map) {
+        return;
+    }
+    ResumeSlot *slot = &rf->staged[rf->stageSlot];
+    memset(slot, 0, sizeof(*slot));
+    slot->magic    = RESUME_MAGIC;
+    slot->version  = RESUME_VERSION;
+    slot->sequence = ++rf->sequence;
+    slot->savedAt  = (Uint32)time(NULL);
+    slot->bytes    = (Uint32)sizeof(SimSnapshot);
+    sim_snapshot(sim, &slot->sim);
+    slot->checksum = resume_checksum(slot);
+
+    resume_publish(rf);
+    rf->lastSaveMs = SDL_GetTicks();
+}
+
+/* The run ended or was declined; nothing to resume */
+static void resume_clear(ResumeFile *rf) {
+    if (!rf->map) {
+        return;
+    }
+    rf->staged[rf->stageSlot].magic = 0;
+    resume_publish(rf);
+    rf->offered = 0;
+}
+
+/* Let the writer store the last save, then unmap */
+static void resume_close(ResumeFile *rf) {
+    if (rf->thread) {
+        SDL_AtomicSet(&rf->quit, 1);
+        SDL_SemPost(rf->wake);
+        SDL_WaitThread(rf->thread, NULL);
+        rf->thread = NULL;
+    }
+    if (rf->wake) {
+        SDL_DestroySemaphore(rf->wake);
+        rf->wake = NULL;
+    }
+    if (rf->map) {
+        munmap(rf->map, 2 * RESUME_SLOT_BYTES);
+        close(rf->fd);
+        rf->map = NULL;
+    }
+}
+
+/* ------------------------------- Telemetry ------------------------------ */
+
+/*
+ * Every finished run appends one record to TELEMETRY_FILE: score, length,
+ * where the player died, how many obstacles were on screen, and the score at
+ * each whole second, sampled by a sim timer. Host byte order:
+ *
+ *     u32 magic (TELEMETRY_MAGIC), u32 version     once, at the start
+ *     TelemetryRecord, u32 curve[curveCount]       per run
+ *
+ * When the run ends the game thread only copies the record into a ring; the
+ * telemetry writer thread appends it in one O_APPEND write, so the death path
+ * never waits on disk, the file grows by whole records and a crash loses at
+ * most the runs not yet written.
+ * `--analyze` folds any number of these logs into heatmaps and CSVs.
+ */
+
+/* A new run: clear the curve and sample it from the first second */
+static void telemetry_begin_run(Telemetry *t, Sim *sim) {
+    t->curveStart = 0;
+    t->curveCount = 0;
+    if (t->path) {
+        sim_timer_start(sim, GAME_TIMER_TELEMETRY, TELEMETRY_SAMPLE_US);
+    }
+}
+
+/* The sample timer fired: record the score and aim at the next second */
+static void telemetry_sample(Telemetry *t, Sim *sim) {
+    Uint64 second = sim->simTimeUs / TELEMETRY_SAMPLE_US;
+    if (t->curveCount == 0) {
+        t->curveStart = (int)(second < 0xFFFF ? second : 0xFFFF);
+    }
+    if (t->curveCount < TELEMETRY_MAX_SAMPLES) {
+        t->curve[t->curveCount++] = (Uint32)sim->score;
+    }
+    sim_timer_start(sim, GAME_TIMER_TELEMETRY,
+                    (second + 1) * TELEMETRY_SAMPLE_US - sim->simTimeUs);
+}
+
+/* Writer thread (or the game thread without one): append one run */
+static void telemetry_append(const char *path, const TelemetryRun *run) {
+    static Uint8 buffer[8 + sizeof(TelemetryRun)];
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        LOG_WARN("Cannot open telemetry log %s: %s", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return;
+    }
+    size_t len = 0;
+    if (st.st_size == 0) {
+        const Uint32 header[2] = { TELEMETRY_MAGIC, TELEMETRY_VERSION };
+        memcpy(buffer, header, sizeof(header));
+        len = sizeof(header);
+    }
+    memcpy(buffer + len, run, run->record.bytes);
+    len += run->record.bytes;
+    if (write(fd, buffer, len) != (ssize_t)len) {
+        LOG_WARN("Cannot write telemetry log %s: %s", path, strerror(errno));
+    }
+    close(fd);
+}
+
+static int telemetry_writer(void *data) {
+    Telemetry *t = (Telemetry *)data;
+    for (;;) {
+        SDL_SemWait(t->wake);
+        int tail = SDL_AtomicGet(&t->tail);
+        while (tail != SDL_AtomicGet(&t->head)) {
+            telemetry_append(t->path,
+                             &t->ring[tail & (TELEMETRY_RING_SIZE - 1)]);
+            SDL_AtomicSet(&t->tail, ++tail);
+        }
+        if (SDL_AtomicGet(&t->quit)) {
+            return 0;
+        }
+    }
+}
+
+static void telemetry_start(Telemetry *t) {
+    if (!t->path) {
+        return;
+    }
+    t->wake = SDL_CreateSemaphore(0);
+    if (t->wake) {
+        t->thread = SDL_CreateThread(telemetry_writer, "telemetry", t);
+    }
+    if (!t->thread) {
+        LOG_WARN("Telemetry written on the game thread: %s", SDL_GetError());
+    }
+}
+
+/* Let the writer append the runs still queued, then stop it */
+static void telemetry_stop(Telemetry *t) {
+    if (t->thread) {
+        SDL_AtomicSet(&t->quit, 1);
+        SDL_SemPost(t->wake);
+        SDL_WaitThread(t->thread, NULL);
+        t->thread = NULL;
+    }
+    if (t->wake) {
+        SDL_DestroySemaphore(t->wake);
+        t->wake = NULL;
+    }
+}
+
+/* Game thread: queue the finished run for the writer */
+static void telemetry_write(Telemetry *t, const Sim *sim, float deathX) {
+    if (!t->path) {
+        return;
+    }
+
+    int head = SDL_AtomicGet(&t->head);
+    if (t->thread &&
+        head - SDL_AtomicGet(&t->tail) >= TELEMETRY_RING_SIZE) {
+        LOG_WARN("Telemetry writer behind; run not logged");
+        return;
+    }
+    TelemetryRun *run = &t->ring[head & (TELEMETRY_RING_SIZE - 1)];
+    TelemetryRecord *r = &run->record;
+    memset(r, 0, sizeof(*r));
+    r->bytes      = (Uint32)(sizeof(*r) + (size_t)t->curveCount * sizeof(Uint32));
+    r->score      = (Uint32)sim->score;
+    r->durationMs = (Uint32)(sim->simTimeUs / 1000);
+    r->deathX     = deathX;
+    r->curveStart = (Uint16)t->curveStart;
+    r->curveCount = (Uint16)t->curveCount;
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        r->obstacles += sim->obstacles[i].active ? 1 : 0;
+    }
+    memcpy(run->curve, t->curve, (size_t)t->curveCount * sizeof(Uint32));
+
+    if (!t->thread) {
+        telemetry_append(t->path, run);
+        return;
+    }
+    SDL_AtomicSet(&t->head, head + 1);
+    SDL_SemPost(t->wake);
+}
+
+/* -------------------------- Leaderboard Client --------------------------- */
+
+/*
+ * Wire protocol (text, one connection per batch):
+ *   client: "SUBMIT <n>\n" followed by n lines "<score> <timestamp>\n"
+ *   server: "OK <n>\n" once all n entries are stored
+ */
+
+static int leaderboard_load_queue(Leaderboard *lb) {
+    FILE *f = fopen(LEADERBOARD_QUEUE_FILE, "rb");
+    if (!f) {
+        return 0;
+    }
+
+    Uint32 header[2];
+    if (fread(header, sizeof(header), 1, f) != 1 ||
+        header[0] != LEADERBOARD_QUEUE_MAGIC ||
+        header[1] > LEADERBOARD_MAX_PENDING ||
+        fread(lb->pending, sizeof(ScoreEntry), header[1], f) != header[1]) {
+        LOG_ERROR("Leaderboard queue file is corrupt; discarding it.");
+        fclose(f);
+        return 0;
+    }
+
+    fclose(f);
+    return (int)header[1];
+}
+
+/* Write to a temporary file and rename, so a crash never truncates the queue */
+static void leaderboard_save_queue(const Leaderboard *lb) {
+    char tmpPath[256];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", LEADERBOARD_QUEUE_FILE);
+
+    if (lb->pendingCount == 0) {
+        remove(LEADERBOARD_QUEUE_FILE);
+        return;
+    }
+
+    FILE *f = fopen(tmpPath, "wb");
+    if (!f) {
+        LOG_ERROR("Failed to open leaderboard queue file for writing.");
+        return;
+    }
+
+    Uint32 header[2] = { LEADERBOARD_QUEUE_MAGIC, (Uint32)lb->pendingCount };
+    int ok = fwrite(header, sizeof(header), 1, f) == 1 &&
+             fwrite(lb->pending, sizeof(ScoreEntry),
+                    (size_t)lb->pendingCount, f) == (size_t)lb->pendingCount;
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok || rename(tmpPath, LEADERBOARD_QUEUE_FILE) != 0) {
+        LOG_ERROR("Failed to write leaderboard queue file.");
+        remove(tmpPath);
+    }
+}
+
+/* Wait until `fd` is ready for `events` or the deadline (ticks) passes */
+static int wait_fd(int fd, short events, Uint32 deadline) {
+    for (;;) {
+        Uint32 now = SDL_GetTicks();
+        if (SDL_TICKS_PASSED(now, deadline)) {
+            return 0;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = events;
+        pfd.revents = 0;
+
+        int n = poll(&pfd, 1, (int)(deadline - now));
+        if (n > 0) {
+            return 1;
+        }
+        if (n < 0 && errno != EINTR) {
+            return 0;
+        }
+    }
+}
+
+/* Open a non-blocking TCP connection, or return -1 */
+static int leaderboard_connect(const Leaderboard *lb, Uint32 deadline) {
+    struct addrinfo hints;
+    struct addrinfo *addrs = NULL;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(lb->host, lb->port, &hints, &addrs) != 0) {
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *a = addrs; a && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+
+        int flags = fcntl(fd, F_GETFL, 0);
+        int err = 0;
+        socklen_t errLen = sizeof(err);
+        if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 ||
+            (connect(fd, a->ai_addr, a->ai_addrlen) != 0 &&
+             (errno != EINPROGRESS ||
+              !wait_fd(fd, POLLOUT, deadline) ||
+              getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errLen) != 0 ||
+              err != 0))) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    freeaddrinfo(addrs);
+    return fd;
+}
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* Submit one batch; returns the number of entries accepted, or -1 */
+static int leaderboard_send_batch(const Leaderboard *lb,
+                                  const ScoreEntry *entries, int count) {
+    char buf[32 + LEADERBOARD_BATCH_SIZE * 32];
+    int len = snprintf(buf, sizeof(buf), "SUBMIT %d\n", count);
+    for (int i = 0; i < count; ++i) {
+        len += snprintf(buf + len, sizeof(buf) - (size_t)len, "%ld %lu\n",
+                        (long)entries[i].score,
+                        (unsigned long)entries[i].timestamp);
+    }
+
+    Uint32 deadline = SDL_GetTicks() + LEADERBOARD_IO_TIMEOUT_MS;
+    int fd = leaderboard_connect(lb, deadline);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int sent = 0;
+    while (sent < len) {
+        ssize_t n = send(fd, buf + sent, (size_t)(len - sent), MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += (int)n;
+        } else if ((n < 0 && errno != EAGAIN && errno != EINTR) ||
+                   !wait_fd(fd, POLLOUT, deadline)) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    char reply[64];
+    int got = 0;
+    while (got < (int)sizeof(reply) - 1 && !memchr(reply, '\n', (size_t)got)) {
+        ssize_t n = recv(fd, reply + got, sizeof(reply) - 1 - (size_t)got, 0);
+        if (n > 0) {
+            got += (int)n;
+        } else if (n == 0 ||
+                   (errno != EAGAIN && errno != EINTR) ||
+                   !wait_fd(fd, POLLIN, deadline)) {
+            break;
+        }
+    }
+    close(fd);
+    reply[got] = '\0';
+
+    int accepted = -1;
+    if (sscanf(reply, "OK %d", &accepted) != 1 ||
+        accepted < 0 || accepted > count) {
+        return -1;
+    }
+    return accepted;
+}
+
+/* Move newly finished runs from the ring into the pending queue */
+static int leaderboard_drain(Leaderboard *lb) {
+    int tail = SDL_AtomicGet(&lb->tail);
+    int head = SDL_AtomicGet(&lb->head);
+    if (tail == head) {
+        return 0;
+    }
+
+    for (; tail != head; ++tail) {
+        if (lb->pendingCount == LEADERBOARD_MAX_PENDING) {
+            LOG_ERROR("Leaderboard queue full; dropping oldest entry.");
+            memmove(lb->pending, lb->pending + 1,
+                    sizeof(ScoreEntry) * (LEADERBOARD_MAX_PENDING - 1));
+            --lb->pendingCount;
+        }
+        lb->pending[lb->pendingCount++] =
+            lb->ring[tail & (LEADERBOARD_RING_SIZE - 1)];
+    }
+    SDL_AtomicSet(&lb->tail, tail);
+    return 1;
+}
+
+static void leaderboard_persist(Leaderboard *lb) {
+    int highScore = SDL_AtomicGet(&lb->highScore);
+    if (highScore > lb->savedHighScore) {
+        save_high_score(HIGHSCORE_FILE, highScore);
+        lb->savedHighScore = highScore;
+    }
+
+    if (leaderboard_drain(lb)) {
+        leaderboard_save_queue(lb);
+    }
+}
+
+static int leaderboard_worker(void *data) {
+    Leaderboard *lb = (Leaderboard *)data;
+    Uint32 retryDelay  = LEADERBOARD_BACKOFF_MIN_MS;
+    Uint32 nextAttempt = SDL_GetTicks();
+    Uint32 jitter      = nextAttempt | 1u;
+    int    offline     = 0;
+
+    while (!SDL_AtomicGet(&lb->quit)) {
+        Uint32 now = SDL_GetTicks();
+        Uint32 wait = LEADERBOARD_IDLE_MS;
+        if (lb->pendingCount > 0) {
+            wait = SDL_TICKS_PASSED(now, nextAttempt) ? 0 : nextAttempt - now;
+        }
+        SDL_SemWaitTimeout(lb->wake, wait);
+
+        leaderboard_persist(lb);
+
+        now = SDL_GetTicks();
+        if (lb->pendingCount == 0 || !SDL_TICKS_PASSED(now, nextAttempt) ||
+            SDL_AtomicGet(&lb->quit)) {
+            continue;
+        }
+
+        int batch = lb->pendingCount < LEADERBOARD_BATCH_SIZE
+                        ? lb->pendingCount : LEADERBOARD_BATCH_SIZE;
+        int accepted = leaderboard_send_batch(lb, lb->pending, batch);
+        if (accepted > 0) {
+            if (offline) {
+                LOG_INFO("Leaderboard reachable again.");
+                offline = 0;
+            }
+            lb->pendingCount -= accepted;
+            memmove(lb->pending, lb->pending + accepted,
+                    sizeof(ScoreEntry) * (size_t)lb->pendingCount);
+            leaderboard_save_queue(lb);
+            retryDelay  = LEADERBOARD_BACKOFF_MIN_MS;
+            nextAttempt = SDL_GetTicks();
+        } else {
+            if (!offline) {
+                LOG_INFO("Leaderboard unreachable; %d scores queued.",
+                         lb->pendingCount);
+                offline = 1;
+            }
+            /* Exponential backoff with jitter in [delay/2, delay) */
+            jitter = jitter * 1664525u + 1013904223u;
+            nextAttempt = SDL_GetTicks() + retryDelay / 2 +
+                          (jitter >> 8) % (retryDelay / 2);
+            retryDelay *= 2;
+            if (retryDelay > LEADERBOARD_BACKOFF_MAX_MS) {
+                retryDelay = LEADERBOARD_BACKOFF_MAX_MS;
+            }
+        }
+    }
+
+    leaderboard_persist(lb);
+    return 0;
+}
+
+/* Parse "host:port" (or "host") into the client's address */
+static void leaderboard_set_addr(Leaderboard *lb, const char *addr) {
+    const char *colon = addr ? strrchr(addr, ':') : NULL;
+
+    snprintf(lb->port, sizeof(lb->port), "%d", LEADERBOARD_DEFAULT_PORT);
+    if (!addr) {
+        snprintf(lb->host, sizeof(lb->host), "%s", LEADERBOARD_DEFAULT_HOST);
+    } else if (colon) {
+        snprintf(lb->host, sizeof(lb->host), "%.*s", (int)(colon - addr), addr);
+        snprintf(lb->port, sizeof(lb->port), "%s", colon + 1);
+    } else {
+        snprintf(lb->host, sizeof(lb->host), "%s", addr);
+    }
+}
+
+static void leaderboard_init(Leaderboard *lb, const char *addr, int highScore) {
+    leaderboard_set_addr(lb, addr);
+    lb->savedHighScore = highScore;
+    SDL_AtomicSet(&lb->highScore, highScore);
+    lb->pendingCount = leaderboard_load_queue(lb);
+    if (lb->pendingCount > 0) {
+        LOG_INFO("Loaded %d unsent leaderboard scores.", lb->pendingCount);
+    }
+
+    lb->wake = SDL_CreateSemaphore(0);
+    if (lb->wake) {
+        lb->thread = SDL_CreateThread(leaderboard_worker, "leaderboard", lb);
+    }
+    if (!lb->thread) {
+        LOG_ERROR("Leaderboard thread unavailable: %s", SDL_GetError());
+    }
+}
+
+static void leaderboard_shutdown(Leaderboard *lb) {
+    if (lb->thread) {
+        SDL_AtomicSet(&lb->quit, 1);
+        SDL_SemPost(lb->wake);
+        SDL_WaitThread(lb->thread, NULL);
+        lb->thread = NULL;
+    }
+    if (lb->wake) {
+        SDL_DestroySemaphore(lb->wake);
+        lb->wake = NULL;
+    }
+}
+
+/*
+ * Record a finished run. Called on the game thread: it only touches the ring
+ * and atomics, so it never waits on disk or network.
+ */
+static void leaderboard_submit(Leaderboard *lb, int score, int highScore) {
+    if (!lb->thread) {
+        /* No worker; fall back to the synchronous high score save */
+        if (highScore > lb->savedHighScore) {
+            save_high_score(HIGHSCORE_FILE, highScore);
+            lb->savedHighScore = highScore;
+        }
+        return;
+    }
+
+    SDL_AtomicSet(&lb->highScore, highScore);
+
+    int head = SDL_AtomicGet(&lb->head);
+    if (head - SDL_AtomicGet(&lb->tail) < LEADERBOARD_RING_SIZE) {
+        ScoreEntry *e = &lb->ring[head & (LEADERBOARD_RING_SIZE - 1)];
+        e->score = score;
+        e->timestamp = (Uint32)time(NULL);
+        SDL_AtomicSet(&lb->head, head + 1);
+    }
+
+    SDL_SemPost(lb->wake);
+}
+
+/*
+ * Local stand-in for the leaderboard service (`--leaderboard-server`), for
+ * testing the client offline. Accepts batches on loopback and keeps the best
+ * scores in memory.
+ */
+static int run_leaderboard_server(int port) {
+    ScoreEntry best[10];
+    int bestCount = 0;
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0) {
+        LOG_ERROR("socket failed: %s", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    int yes = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((Uint16)port);
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listener, 16) != 0) {
+        LOG_ERROR("Cannot listen on port %d: %s", port, strerror(errno));
+        close(listener);
+        return EXIT_FAILURE;
+    }
+    LOG_INFO("Leaderboard stand-in listening on 127.0.0.1:%d", port);
+
+    for (;;) {
+        int client = accept(listener, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("accept failed: %s", strerror(errno));
+            break;
+        }
+
+        FILE *in = fdopen(client, "r");
+        if (!in) {
+            close(client);
+            continue;
+        }
+
+        char line[128];
+        int count = 0;
+        int stored = 0;
+        if (fgets(line, sizeof(line), in) &&
+            sscanf(line, "SUBMIT %d", &count) == 1 &&
+            count > 0 && count <= LEADERBOARD_MAX_PENDING) {
+            for (; stored < count && fgets(line, sizeof(line), in); ++stored) {
+                long score;
+                unsigned long timestamp;
+                if (sscanf(line, "%ld %lu", &score, &timestamp) != 2) {
+                    break;
+                }
+                LOG_INFO("Score received: %ld", score);
+
+                /* Insert into the in-memory top list */
+                int pos = bestCount < 10 ? bestCount++ : 10;
+                while (pos > 0 && best[pos - 1].score < score) {
+                    if (pos < 10) best[pos] = best[pos - 1];
+                    --pos;
+                }
+                if (pos < 10) {
+                    best[pos].score = (Sint32)score;
+                    best[pos].timestamp = (Uint32)timestamp;
+                }
+            }
+        }
+
+        char reply[32];
+        int len = stored == count && count > 0
+                      ? snprintf(reply, sizeof(reply), "OK %d\n", stored)
+                      : snprintf(reply, sizeof(reply), "ERR\n");
+        if (write(client, reply, (size_t)len) != len) {
+            LOG_ERROR("Failed to reply to leaderboard client.");
+        }
+        fclose(in);
+
+        if (bestCount > 0) {
+            LOG_INFO("Leaderboard best: %ld", (long)best[0].score);
+        }
+    }
+
+    close(listener);
+    return EXIT_FAILURE;
+}
+
+/* ------------------------------ Profiler --------------------------------- */
+
+/*
+ * `--profile` sampling profiler. Each registered thread gets a timer on its
+ * own CPU clock that sends it SIGPROF PROFILE_HZ times per CPU second. The
+ * handler walks the frame pointer chain from the interrupted context and
+ * counts the stack in the thread's preallocated hash table, so it never
+ * allocates or locks and memory stays bounded however long the run. At exit
+ * the stacks are symbolized and written as folded stacks ("thread;root;...;
+ * leaf count"), ready for flamegraph.pl or speedscope.
+ *
+ * Frames are only found through code built with frame pointers; the walk
+ * stops at the first frame pointer outside the thread's stack, so libraries
+ * built without them end a stack early rather than crash it.
+ */
+
+#define PROFILE_HZ           997    /* prime, so it never beats with the loop */
+#define PROFILE_MAX_THREADS  16   /* main, render and the first job threads */
+#define PROFILE_MAX_DEPTH    48
+#define PROFILE_MAX_STACKS   8192   /* distinct stacks per thread; power of two */
+#define PROFILE_MAX_PROBES   32
+#define PROFILE_DEFAULT_FILE "profile.folded"
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid   /* glibc before 2.41 */
+#endif
+
+typedef struct {
+    Uint32    count;
+    Uint32    depth;
+    uintptr_t frames[PROFILE_MAX_DEPTH];  /* leaf first */
+} ProfileStack;
+
+typedef struct {
+    const char   *name;
+    timer_t       timer;
+    int           armed;
+    uintptr_t     stackLow;
+    uintptr_t     stackHigh;
+    ProfileStack *stacks;          /* written only by this thread's handler */
+    volatile Uint32 samples;
+    volatile Uint32 dropped;       /* table full or too many probes */
+} ProfileThread;
+
+typedef struct {
+    uintptr_t   addr;
+    size_t      size;
+    const char *name;
+} ProfileSymbol;
+
+typedef struct {
+    const char      *path;         /* NULL while not profiling */
+    SDL_atomic_t     threadCount;
+    ProfileThread    threads[PROFILE_MAX_THREADS];
+    struct sigaction oldAction;
+
+    /* Sim throughput: sim time advanced while profiling, main thread only */
+    Uint64           simUs;
+    Uint64           startCounter;
+
+    /* Executable symbols, loaded at write time */
+    void            *image;
+    ProfileSymbol   *symbols;
+    size_t           symbolCount;
+    uintptr_t        loadBias;
+} Profiler;
+
+static Profiler g_profiler;
+
+static void profiler_signal(int sig, siginfo_t *info, void *context) {
+    (void)sig;
+    int slot = info->si_value.sival_int;
+    if (info->si_code != SI_TIMER || slot < 0 ||
+        slot >= SDL_AtomicGet(&g_profiler.threadCount)) {
+        return;
+    }
+    ProfileThread *pt = &g_profiler.threads[slot];
+    if (!pt->stacks) {
+        return;
+    }
+
+    const ucontext_t *uc = (const ucontext_t *)context;
+    uintptr_t pc, fp;
+#if defined(__x86_64__)
+    pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+    fp = (uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+#elif defined(__i386__)
+    pc = (uintptr_t)uc->uc_mcontext.gregs[REG_EIP];
+    fp = (uintptr_t)uc->uc_mcontext.gregs[REG_EBP];
+#elif defined(__aarch64__)
+    pc = (uintptr_t)uc->uc_mcontext.pc;
+    fp = (uintptr_t)uc->uc_mcontext.regs[29];
+#else
+    (void)uc;
+    pc = 0;
+    fp = 0;
+#endif
+
+    /* Every supported ABI keeps { saved fp, return address } at fp */
+    uintptr_t frames[PROFILE_MAX_DEPTH];
+    Uint32 depth = 0;
+    Uint32 hash = 2166136261u;
+    frames[depth++] = pc;
+    while (depth < PROFILE_MAX_DEPTH &&
+           fp >= pt->stackLow && fp <= pt->stackHigh - 2 * sizeof(uintptr_t) &&
+           (fp & (sizeof(uintptr_t) - 1)) == 0) {
+        const uintptr_t *frame = (const uintptr_t *)fp;
+        if (frame[1] == 0) {
+            break;
+        }
+        frames[depth++] = frame[1];
+        if (frame[0] <= fp) {
+            break;  /* stacks grow down; anything else is not a frame */
+        }
+        fp = frame[0];
+    }
+    for (Uint32 i = 0; i < depth; ++i) {
+        hash = (hash ^ (Uint32)frames[i] ^ (Uint32)((Uint64)frames[i] >> 32)) *
+               16777619u;
+    }
+
+    pt->samples++;
+    for (Uint32 probe = 0; probe < PROFILE_MAX_PROBES; ++probe) {
+        ProfileStack *s = &pt->stacks[(hash + probe) & (PROFILE_MAX_STACKS - 1)];
+        if (s->count == 0) {
+            s->depth = depth;
+            memcpy(s->frames, frames, depth * sizeof(frames[0]));
+            s->count = 1;
+            return;
+        }
+        if (s->depth == depth &&
+            memcmp(s->frames, frames, depth * sizeof(frames[0])) == 0) {
+            s->count++;
+            return;
+        }
+    }
+    pt->dropped++;
+}
+
+/*
+ * Start sampling the calling thread; returns its slot for
+ * profiler_unregister_thread(), or -1 when not profiling.
+ */
+static int profiler_register_thread(const char *name) {
+    if (!g_profiler.path) {
+        return -1;
+    }
+
+    int slot = SDL_AtomicAdd(&g_profiler.threadCount, 1);
+    if (slot >= PROFILE_MAX_THREADS) {
+        SDL_AtomicAdd(&g_profiler.threadCount, -1);
+        LOG_WARN("Profiler: no slot left for thread %s", name);
+        return -1;
+    }
+    ProfileThread *pt = &g_profiler.threads[slot];
+    pt->name = name;
+
+    pthread_attr_t attr;
+    void *stackAddr;
+    size_t stackSize;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+        LOG_WARN("Profiler: cannot find the stack of thread %s", name);
+        return -1;
+    }
+    if (pthread_attr_getstack(&attr, &stackAddr, &stackSize) == 0) {
+        pt->stackLow  = (uintptr_t)stackAddr;
+        pt->stackHigh = (uintptr_t)stackAddr + stackSize;
+    }
+    pthread_attr_destroy(&attr);
+
+    pt->stacks = (ProfileStack *)calloc(PROFILE_MAX_STACKS, sizeof(ProfileStack));
+    if (!pt->stacks) {
+        LOG_WARN("Profiler: out of memory for thread %s", name);
+        return -1;
+    }
+
+    clockid_t clock;
+    struct sigevent sev;
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify          = SIGEV_THREAD_ID;
+    sev.sigev_signo           = SIGPROF;
+    sev.sigev_value.sival_int = slot;
+    sev.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+    if (pthread_getcpuclockid(pthread_self(), &clock) != 0 ||
+        timer_create(clock, &sev, &pt->timer) != 0) {
+        LOG_WARN("Profiler: timer_create failed for thread %s: %s",
+                 name, strerror(errno));
+        return -1;
+    }
+
+    struct itimerspec period;
+    period.it_interval.tv_sec  = 0;
+    period.it_interval.tv_nsec = 1000000000L / PROFILE_HZ;
+    period.it_value = period.it_interval;
+    if (timer_settime(pt->timer, 0, &period, NULL) != 0) {
+        LOG_WARN("Profiler: timer_settime failed for thread %s: %s",
+                 name, strerror(errno));
+        timer_delete(pt->timer);
+        return -1;
+    }
+    pt->armed = 1;
+    return slot;
+}
+
+static void profiler_unregister_thread(int slot) {
+    if (slot < 0) {
+        return;
+    }
+    ProfileThread *pt = &g_profiler.threads[slot];
+    if (pt->armed) {
+        timer_delete(pt->timer);
+        pt->armed = 0;
+    }
+}
+
+/* Install the handler and start sampling the calling (main) thread */
+static int profiler_start(const char *path) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = profiler_signal;
+    action.sa_flags     = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &g_profiler.oldAction) != 0) {
+        LOG_ERROR("Profiler: sigaction failed: %s", strerror(errno));
+        return 0;
+    }
+
+    g_profiler.path = path;
+    g_profiler.simUs = 0;
+    g_profiler.startCounter = SDL_GetPerformanceCounter();
+    if (profiler_register_thread("main") < 0) {
+        g_profiler.path = NULL;
+        sigaction(SIGPROF, &g_profiler.oldAction, NULL);
+        return 0;
+    }
+    LOG_INFO("Profiling at %d Hz into %s", PROFILE_HZ, path);
+    return 1;
+}
+
+/* Main thread: count sim time advanced, for the throughput summary */
+static void profiler_count_sim(Uint64 us) {
+    if (g_profiler.path) {
+        g_profiler.simUs += us;
+    }
+}
+
+/* Job system hooks: sample each pool thread like the rest */
+static char g_jobThreadNames[JOBS_MAX_THREADS][8];
+static int  g_jobThreadSlots[JOBS_MAX_THREADS];
+
+static void profiler_job_thread_started(int index) {
+    g_jobThreadSlots[index] = -1;
+    if (g_profiler.path &&
+        SDL_AtomicGet(&g_profiler.threadCount) < PROFILE_MAX_THREADS) {
+        snprintf(g_jobThreadNames[index], sizeof(g_jobThreadNames[index]),
+                 "job%d", index);
+        g_jobThreadSlots[index] = profiler_register_thread(g_jobThreadNames[index]);
+    }
+}
+
+static void profiler_job_thread_stopped(int index) {
+    profiler_unregister_thread(g_jobThreadSlots[index]);
+}
+
+static int profile_symbol_compare(const void *a, const void *b) {
+    uintptr_t x = ((const ProfileSymbol *)a)->addr;
+    uintptr_t y = ((const ProfileSymbol *)b)->addr;
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * dladdr() only sees exported symbols, which leaves out every static
+ * function in this file, so read the executable's own symbol table.
+ */
+static void profiler_load_symbols(Profiler *p) {
+    FILE *file = fopen("/proc/self/exe", "rb");
+    if (!file) {
+        return;
+    }
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+        rewind(file);
+    }
+    if (size < (long)sizeof(ElfW(Ehdr)) ||
+        !(p->image = malloc((size_t)size)) ||
+        fread(p->image, 1, (size_t)size, file) != (size_t)size) {
+        fclose(file);
+        return;
+    }
+    fclose(file);
+
+    const unsigned char *base = (const unsigned char *)p->image;
+    const ElfW(Ehdr) *eh = (const ElfW(Ehdr) *)base;
+    if (memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 ||
+        eh->e_ident[EI_CLASS] != (sizeof(void *) == 8 ? ELFCLASS64 : ELFCLASS32) ||
+        eh->e_shoff == 0 ||
+        eh->e_shoff + (Uint64)eh->e_shnum * sizeof(ElfW(Shdr)) > (Uint64)size) {
+        return;
+    }
+    const ElfW(Shdr) *sections = (const ElfW(Shdr) *)(base + eh->e_shoff);
+
+    /* Prefer the full table; stripped binaries only keep the dynamic one */
+    const ElfW(Shdr) *table = NULL;
+    for (int pass = 0; pass < 2 && !table; ++pass) {
+        for (int i = 0; i < eh->e_shnum; ++i) {
+            if (sections[i].sh_type == (pass == 0 ? SHT_SYMTAB : SHT_DYNSYM)) {
+                table = &sections[i];
+                break;
+            }
+        }
+    }
+    if (!table || table->sh_link >= eh->e_shnum ||
+        table->sh_offset + table->sh_size > (Uint64)size) {
+        return;
+    }
+    const ElfW(Shdr) *strings = &sections[table->sh_link];
+    if (strings->sh_offset + strings->sh_size > (Uint64)size ||
+        strings->sh_size == 0) {
+        return;
+    }
+
+    size_t count = table->sh_size / sizeof(ElfW(Sym));
+    const ElfW(Sym) *syms = (const ElfW(Sym) *)(base + table->sh_offset);
+    const char *names = (const char *)(base + strings->sh_offset);
+    p->symbols = (ProfileSymbol *)malloc(count * sizeof(ProfileSymbol) + 1);
+    if (!p->symbols) {
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (ELF64_ST_TYPE(syms[i].st_info) != STT_FUNC ||
+            syms[i].st_value == 0 || syms[i].st_name >= strings->sh_size) {
+            continue;
+        }
+        ProfileSymbol *s = &p->symbols[p->symbolCount++];
+        s->addr = (uintptr_t)syms[i].st_value;
+        s->size = (size_t)syms[i].st_size;
+        s->name = names + syms[i].st_name;
+    }
+    qsort(p->symbols, p->symbolCount, sizeof(ProfileSymbol),
+          profile_symbol_compare);
+
+    /* Position-independent executables are linked at 0 and loaded anywhere */
+    Dl_info self;
+    if (eh->e_type == ET_DYN &&
+        dladdr((void *)(uintptr_t)profiler_load_symbols, &self) &&
+        self.dli_fbase) {
+        p->loadBias = (uintptr_t)self.dli_fbase;
+    }
+}
+
+/* Name of the function containing `pc`; returns the length it needs */
+static int profiler_frame_name(const Profiler *p, uintptr_t pc,
+                               char *buf, size_t size) {
+    if (p->symbolCount > 0 && pc >= p->loadBias) {
+        uintptr_t addr = pc - p->loadBias;
+        size_t lo = 0, hi = p->symbolCount;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (p->symbols[mid].addr <= addr) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo > 0) {
+            const ProfileSymbol *s = &p->symbols[lo - 1];
+            if (addr < s->addr + s->size) {
+                return snprintf(buf, size, "%s", s->name);
+            }
+        }
+    }
+
+    Dl_info info;
+    if (dladdr((void *)pc, &info) && info.dli_fname) {
+        if (info.dli_sname) {
+            return snprintf(buf, size, "%s", info.dli_sname);
+        }
+        const char *lib = strrchr(info.dli_fname, '/');
+        return snprintf(buf, size, "%s+0x%lx", lib ? lib + 1 : info.dli_fname,
+                        (unsigned long)(pc - (uintptr_t)info.dli_fbase));
+    }
+    return snprintf(buf, size, "0x%lx", (unsigned long)pc);
+}
+
+typedef struct {
+    char   *text;
+    Uint64  count;
+} ProfileLine;
+
+static int profile_line_compare(const void *a, const void *b) {
+    return strcmp(((const ProfileLine *)a)->text, ((const ProfileLine *)b)->text);
+}
+
+/*
+ * Symbolize every stack of thread `pt` into `lines`. Stacks that differ only
+ * in addresses within the same functions come out identical and are merged
+ * when written.
+ */
+static size_t profiler_fold_thread(const Profiler *p, const ProfileThread *pt,
+                                   ProfileLine *lines, size_t count) {
+    char text[PROFILE_MAX_DEPTH * 64];
+    for (int i = 0; i < PROFILE_MAX_STACKS; ++i) {
+        const ProfileStack *s = &pt->stacks[i];
+        if (s->count == 0) {
+            continue;
+        }
+        size_t len = (size_t)snprintf(text, sizeof(text), "%s", pt->name);
+        for (Uint32 f = s->depth; f-- > 0 && len + 1 < sizeof(text);) {
+            /* Return addresses point past the call; step back into it */
+            text[len++] = ';';
+            len += (size_t)profiler_frame_name(
+                p, f == 0 ? s->frames[f] : s->frames[f] - 1,
+                text + len, sizeof(text) - len);
+        }
+        lines[count].text = strdup(text);
+        if (!lines[count].text) {
+            break;
+        }
+        lines[count].count = s->count;
+        ++count;
+    }
+    return count;
+}
+
+/* Stop every timer and write the folded stacks */
+static void profiler_stop(void) {
+    Profiler *p = &g_profiler;
+    if (!p->path) {
+        return;
+    }
+
+    double wallS = (double)(SDL_GetPerformanceCounter() - p->startCounter) /
+                   (double)SDL_GetPerformanceFrequency();
+    int threadCount = SDL_AtomicGet(&p->threadCount);
+    for (int t = 0; t < threadCount; ++t) {
+        profiler_unregister_thread(t);
+    }
+    /* Discards any signal still queued from a deleted timer */
+    struct sigaction ignore;
+    memset(&ignore, 0, sizeof(ignore));
+    ignore.sa_handler = SIG_IGN;
+    sigaction(SIGPROF, &ignore, NULL);
+    sigaction(SIGPROF, &p->oldAction, NULL);
+
+    profiler_load_symbols(p);
+
+    Uint64 samples = 0, dropped = 0;
+    size_t lineCount = 0;
+    ProfileLine *lines = (ProfileLine *)malloc(
+        (size_t)threadCount * PROFILE_MAX_STACKS * sizeof(ProfileLine) + 1);
+    for (int t = 0; t < threadCount; ++t) {
+        ProfileThread *pt = &p->threads[t];
+        samples += pt->samples;
+        dropped += pt->dropped;
+        if (lines && pt->stacks) {
+            lineCount = profiler_fold_thread(p, pt, lines, lineCount);
+        }
+        free(pt->stacks);
+        pt->stacks = NULL;
+    }
+    if (lineCount > 0) {
+        qsort(lines, lineCount, sizeof(ProfileLine), profile_line_compare);
+    }
+
+    FILE *out = fopen(p->path, "w");
+    if (!out || !lines) {
+        LOG_ERROR("Profiler: cannot write %s: %s", p->path, strerror(errno));
+    }
+    for (size_t i = 0; i < lineCount; ++i) {
+        Uint64 count = lines[i].count;
+        while (i + 1 < lineCount && strcmp(lines[i].text, lines[i + 1].text) == 0) {
+            free(lines[i].text);
+            count += lines[++i].count;
+        }
+        if (out) {
+            fprintf(out, "%s %llu\n", lines[i].text, (unsigned long long)count);
+        }
+        free(lines[i].text);
+    }
+    free(lines);
+
+    if (out) {
+        if (fclose(out) != 0) {
+            LOG_ERROR("Profiler: failed to write %s", p->path);
+        } else {
+            LOG_INFO("Profile: %llu samples (%llu dropped) written to %s",
+                     (unsigned long long)samples, (unsigned long long)dropped,
+                     p->path);
+        }
+    }
+    /* Thread 0 is the main thread, which runs the sim */
+    double simS = (double)p->simUs / 1e6;
+    double mainCpuS = (double)p->threads[0].samples / PROFILE_HZ;
+    if (simS > 0.0 && wallS > 0.0) {
+        LOG_INFO("Sim: %.1f s in %.1f s wall (%.1fx), %.0f sim s per main "
+                 "thread CPU s", simS, wallS, simS / wallS,
+                 mainCpuS > 0.0 ? simS / mainCpuS : 0.0);
+    }
+    JobStats jobs;
+    jobs_stats(&jobs);
+    if (jobs.jobs > 0 && jobs.seconds > 0.0) {
+        LOG_INFO("Jobs: %d threads %.0f%% busy, %llu jobs, %llu stolen",
+                 jobs.threads, 100.0 * jobs.busy / (jobs.seconds * jobs.threads),
+                 (unsigned long long)jobs.jobs, (unsigned long long)jobs.steals);
+    }
+    free(p->symbols);
+    free(p->image);
+    p->symbols = NULL;
+    p->image   = NULL;
+    p->path    = NULL;
+}
+
+/* ---------------------------- Game Setup --------------------------------- */
+
+/* Start a new run, seeded from the clock */
+static void reset_gameplay(Game *game) {
+    sim_reset(&game->sim, (Uint32)SDL_GetPerformanceCounter());
+    telemetry_begin_run(&game->telemetry, &game->sim);
+}
+
+/* Switch state and tell the subscribers */
+static void set_game_state(Game *game, GameState state) {
+    SimEvent *e = sim_emit(&game->sim, SIM_EVENT_STATE_CHANGED);
+    e->from = (Uint8)game->state;
+    e->to   = (Uint8)state;
+    game->state = state;
+}
+
+/*
+ * The fullscreen mode for `options`: the requested size (the desktop's if
+ * none) at the requested refresh rate, or else the fastest that size offers.
+ * Falls back to SDL's closest match when the display has no such mode.
+ */
+static int choose_display_mode(const Options *options, SDL_DisplayMode *out) {
+    SDL_DisplayMode desktop;
+    if (SDL_GetDesktopDisplayMode(options->display, &desktop) != 0) {
+        LOG_ERROR("SDL_GetDesktopDisplayMode failed: %s", SDL_GetError());
+        return 0;
+    }
+    int w = options->modeW ? options->modeW : desktop.w;
+    int h = options->modeH ? options->modeH : desktop.h;
+
+    /* Modes come sorted deepest format first, so ties keep the first */
+    int found = 0;
+    int count = SDL_GetNumDisplayModes(options->display);
+    for (int i = 0; i < count; ++i) {
+        SDL_DisplayMode mode;
+        if (SDL_GetDisplayMode(options->display, i, &mode) != 0 ||
+            mode.w != w || mode.h != h) {
+            continue;
+        }
+        if (options->modeHz ? found || mode.refresh_rate != options->modeHz
+                            : found && mode.refresh_rate <= out->refresh_rate) {
+            continue;
+        }
+        *out = mode;
+        found = 1;
+    }
+    if (found) {
+        return 1;
+    }
+
+    SDL_DisplayMode want;
+    memset(&want, 0, sizeof(want));
+    want.w = w;
+    want.h = h;
+    want.refresh_rate = options->modeHz;
+    if (!SDL_GetClosestDisplayMode(options->display, &want, out)) {
+        LOG_ERROR("Display %d has no mode near %dx%d @ %d Hz (see --list-modes)",
+                  options->display, w, h, options->modeHz);
+        return 0;
+    }
+    LOG_WARN("Display %d has no %dx%d @ %d Hz mode; using %dx%d @ %d Hz",
+             options->display, w, h, options->modeHz, out->w, out->h,
+             out->refresh_rate);
+    return 1;
+}
+
+/*
+ * Log the mode the window ended up in and whether its frames can skip the
+ * desktop compositor. SDL cannot ask the compositor, so this reports what
+ * the video driver and window flags imply.
+ */
+static void report_display(SDL_Window *window, const SDL_DisplayMode *wanted) {
+    int display = SDL_GetWindowDisplayIndex(window);
+    const char *driver = SDL_GetCurrentVideoDriver();
+    Uint32 flags = SDL_GetWindowFlags(window);
+    int exclusive = (flags & SDL_WINDOW_FULLSCREEN_DESKTOP) ==
+                    SDL_WINDOW_FULLSCREEN;
+
+    SDL_DisplayMode mode;
+    memset(&mode, 0, sizeof(mode));
+    SDL_GetCurrentDisplayMode(display, &mode);
+    if (wanted && (mode.w != wanted->w || mode.h != wanted->h ||
+                   mode.refresh_rate != wanted->refresh_rate)) {
+        LOG_WARN("Display %d stayed at %dx%d @ %d Hz instead of %dx%d @ %d Hz",
+                 display, mode.w, mode.h, mode.refresh_rate, wanted->w,
+                 wanted->h, wanted->refresh_rate);
+    }
+
+    const char *bypass;
+    if (!exclusive) {
+        bypass = "no, windowed frames are composited (try --fullscreen)";
+    } else if (!driver) {
+        bypass = "unknown";
+    } else if (strcmp(driver, "KMSDRM") == 0 || strcmp(driver, "kmsdrm") == 0) {
+        bypass = "yes, no compositor under KMS/DRM";
+    } else if (strcmp(driver, "x11") == 0) {
+        bypass = "requested with _NET_WM_BYPASS_COMPOSITOR";
+    } else if (strcmp(driver, "wayland") == 0) {
+        bypass = "up to the compositor (fullscreen surfaces can be scanned out)";
+    } else if (strcmp(driver, "windows") == 0) {
+        bypass = "yes, exclusive fullscreen";
+    } else {
+        bypass = "unknown for this video driver";
+    }
+
+    LOG_INFO("Display %d: %dx%d @ %d Hz, %s (%s); compositor bypass: %s",
+             display, mode.w, mode.h, mode.refresh_rate,
+             exclusive ? "exclusive fullscreen" : "windowed",
+             driver ? driver : "no driver", bypass);
+}
+
+/* `--list-modes`: each display's fullscreen sizes and their refresh rates */
+static int run_list_modes(void) {
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        LOG_ERROR("SDL_Init failed: %s", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    int displays = SDL_GetNumVideoDisplays();
+    for (int d = 0; d < displays; ++d) {
+        SDL_DisplayMode desktop;
+        memset(&desktop, 0, sizeof(desktop));
+        SDL_GetDesktopDisplayMode(d, &desktop);
+        const char *name = SDL_GetDisplayName(d);
+        printf("Display %d: %s, desktop %dx%d @ %d Hz\n", d,
+               name ? name : "unnamed", desktop.w, desktop.h,
+               desktop.refresh_rate);
+
+        /* Sorted by size, so each size's rates are adjacent */
+        int count = SDL_GetNumDisplayModes(d);
+        int lastW = 0, lastH = 0, lastHz = -1;
+        for (int i = 0; i < count; ++i) {
+            SDL_DisplayMode mode;
+            if (SDL_GetDisplayMode(d, i, &mode) != 0) {
+                continue;
+            }
+            if (mode.w != lastW || mode.h != lastH) {
+                printf("%s  %dx%d:", i > 0 ? " Hz\n" : "", mode.w, mode.h);
+                lastW = mode.w;
+                lastH = mode.h;
+                lastHz = -1;
+            }
+            if (mode.refresh_rate != lastHz) {
+                printf(" %d", mode.refresh_rate);
+                lastHz = mode.refresh_rate;
+            }
+        }
+        printf("%s", count > 0 ? " Hz\n" : "");
+    }
+    SDL_Quit();
+    return displays > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * The spectator window: borderless over the whole of its own display, or an
+ * ordinary window when it shares the player's. Without it the game runs on,
+ * so failures only warn.
+ */
+static void open_mirror_window(Game *game, const Options *options) {
+    int displays = SDL_GetNumVideoDisplays();
+    int display = options->mirrorDisplay;
+    if (display < 0) {
+        display = (options->display + 1) % displays;
+    }
+    if (display >= displays) {
+        LOG_WARN("No display %d for the mirror; %d found", display, displays);
+        return;
+    }
+
+    int own = display != options->display;
+    SDL_Window *window = SDL_CreateWindow(
+        "Endless Dodge - spectators",
+        SDL_WINDOWPOS_CENTERED_DISPLAY(display),
+        SDL_WINDOWPOS_CENTERED_DISPLAY(display),
+        WINDOW_WIDTH,
+        WINDOW_HEIGHT,
+        own ? SDL_WINDOW_FULLSCREEN_DESKTOP : SDL_WINDOW_SHOWN
+    );
+    if (!window) {
+        LOG_WARN("Mirror window failed: %s", SDL_GetError());
+        return;
+    }
+
+    SDL_DisplayMode mode;
+    memset(&mode, 0, sizeof(mode));
+    SDL_GetCurrentDisplayMode(display, &mode);
+    LOG_INFO("Mirror on display %d: %dx%d @ %d Hz, %s", display, mode.w,
+             mode.h, mode.refresh_rate, own ? "whole display" : "windowed");
+    game->render.mirror.window = window;
+
+    /* Keep keyboard focus with the player */
+    SDL_RaiseWindow(game->window);
+}
+
+/* Initialize SDL, window, renderer, etc. */
+static int init_sdl(Game *game, const Options *options) {
+    if (options->fullscreen) {
+        SDL_SetHint(SDL_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR, "1");
+    }
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
+        LOG_ERROR("SDL_Init failed: %s", SDL_GetError());
+        return 0;
+    }
+    if (options->display < 0 || options->display >= SDL_GetNumVideoDisplays()) {
+        LOG_ERROR("No display %d; %d found", options->display,
+                  SDL_GetNumVideoDisplays());
+        SDL_Quit();
+        return 0;
+    }
+
+    /* Fullscreen starts hidden, so the mode switches once, at the show */
+    SDL_DisplayMode mode;
+    if (options->fullscreen && !choose_display_mode(options, &mode)) {
+        SDL_Quit();
+        return 0;
+    }
+    game->window = SDL_CreateWindow(
+        "Endless Dodge",
+        SDL_WINDOWPOS_CENTERED_DISPLAY(options->display),
+        SDL_WINDOWPOS_CENTERED_DISPLAY(options->display),
+        WINDOW_WIDTH,
+        WINDOW_HEIGHT,
+        options->fullscreen ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN
+    );
+    if (!game->window) {
+        LOG_ERROR("SDL_CreateWindow failed: %s", SDL_GetError());
+        SDL_Quit();
+        return 0;
+    }
+    if (options->fullscreen) {
+        if (SDL_SetWindowDisplayMode(game->window, &mode) != 0 ||
+            SDL_SetWindowFullscreen(game->window, SDL_WINDOW_FULLSCREEN) != 0) {
+            LOG_WARN("Exclusive fullscreen failed, staying windowed: %s",
+                     SDL_GetError());
+            SDL_SetWindowFullscreen(game->window, 0);
+        }
+        SDL_ShowWindow(game->window);
+    }
+
+    report_display(game->window,
+                   options->fullscreen &&
+                   (SDL_GetWindowFlags(game->window) & SDL_WINDOW_FULLSCREEN)
+                       ? &mode : NULL);
+
+    if (options->mirror) {
+        open_mirror_window(game, options);
+    }
+    return 1;
+}
+
+static void shutdown_sdl(Game *game) {
+    if (game->render.mirror.window) {
+        SDL_DestroyWindow(game->render.mirror.window);
+    }
+    if (game->window) {
+        SDL_DestroyWindow(game->window);
+    }
+    SDL_Quit();
+}
+
+/* Initialize entire game structure */
+static int init_game(Game *game, const Options *options) {
+    memset(game, 0, sizeof(Game));
+
+    if (!init_sdl(game, options)) {
+        return 0;
+    }
+
+    game->running = 1;
+    game->state   = GAME_STATE_MENU;
+    game->leftPressed  = 0;
+    game->rightPressed = 0;
+
+    game->highScore = load_high_score(HIGHSCORE_FILE);
+    leaderboard_init(&game->leaderboard, options->leaderboardAddr,
+                     game->highScore);
+
+    game->sim.killcam = &game->killcam;
+    game->render.lateLatch = options->lateLatch;
+    game->telemetry.path = options->spectatePath ? NULL : options->telemetryPath;
+    telemetry_start(&game->telemetry);
+    reset_gameplay(game);
+
+    /* An unfinished run shows under the menu until Y or N */
+    game->resume.fd = -1;
+    if (!options->spectatePath &&
+        resume_open(&game->resume, RESUME_FILE, &game->sim)) {
+        game->resume.offered = 1;
+        LOG_INFO("Unfinished run found (score %d, %.0f s in): Y to resume, "
+                 "N to discard", game->sim.score,
+                 (double)game->sim.simTimeUs / 1000000.0);
+    }
+
+    LOG_INFO("Game initialized. High score: %d", game->highScore);
+    return 1;
+}
+
+/* ---------------------------- Input Handling ----------------------------- */
+
+/* Drop an offered run and start the menu over with a fresh one */
+static void decline_resume(Game *game) {
+    resume_clear(&game->resume);
+    reset_gameplay(game);
+}
+
+static void handle_key_down(Game *game, SDL_Keycode key) {
+    switch (key) {
+        case SDLK_a:
+        case SDLK_LEFT:
+            game->leftPressed = 1;
+            break;
+        case SDLK_d:
+        case SDLK_RIGHT:
+            game->rightPressed = 1;
+            break;
+        case SDLK_y:
+            if (game->state == GAME_STATE_MENU && game->resume.offered) {
+                /* Paused, so the player can get ready; P continues */
+                game->resume.offered = 0;
+                set_game_state(game, GAME_STATE_PAUSED);
+            }
+            break;
+        case SDLK_n:
+            if (game->state == GAME_STATE_MENU && game->resume.offered) {
+                decline_resume(game);
+            }
+            break;
+        case SDLK_RETURN:
+        case SDLK_KP_ENTER:
+            if (game->resume.offered) {
+                decline_resume(game);
+            }
+            if (game->state == GAME_STATE_MENU ||
+                game->state == GAME_STATE_GAME_OVER ||
+                game->state == GAME_STATE_REPLAY) {
+                reset_gameplay(game);
+                set_game_state(game, GAME_STATE_PLAYING);
+            }
+            break;
+        case SDLK_r:
+            if (game->state == GAME_STATE_GAME_OVER &&
+                killcam_start_playback(&game->killcam, &game->sim)) {
+                set_game_state(game, GAME_STATE_REPLAY);
+            }
+            break;
+        case SDLK_p:
+            if (game->state == GAME_STATE_PLAYING) {
+                set_game_state(game, GAME_STATE_PAUSED);
+            } else if (game->state == GAME_STATE_PAUSED) {
+                set_game_state(game, GAME_STATE_PLAYING);
+            }
+            break;
+        case SDLK_EQUALS:
+        case SDLK_PLUS:
+        case SDLK_KP_PLUS:
+            if (game->speed) {
+                game->speed = game->speed * 2 > SPECTATE_MAX_SPEED
+                                  ? SPECTATE_MAX_SPEED : game->speed * 2;
+            }
+            break;
+        case SDLK_MINUS:
+        case SDLK_KP_MINUS:
+            if (game->speed > 1) {
+                game->speed /= 2;
+            }
+            break;
+        case SDLK_ESCAPE:
+            game->running = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+static void handle_key_up(Game *game, SDL_Keycode key) {
+    switch (key) {
+        case SDLK_a:
+        case SDLK_LEFT:
+            game->leftPressed = 0;
+            break;
+        case SDLK_d:
+        case SDLK_RIGHT:
+            game->rightPressed = 0;
+            break;
+        default:
+            break;
+    }
+}
+
+static void apply_input_event(Game *game, const InputEvent *e) {
+    if (e->type == SDL_KEYDOWN) {
+        handle_key_down(game, e->key);
+    } else {
+        handle_key_up(game, e->key);
+    }
+}
+
+static void queue_input_event(Game *game, const SDL_KeyboardEvent *key) {
+    InputQueue *q = &game->input;
+
+    if (q->head - q->tail == INPUT_QUEUE_SIZE) {
+        /* Sim is far behind; apply the oldest event now rather than drop it */
+        apply_input_event(game, &q->events[q->tail++ & (INPUT_QUEUE_SIZE - 1)]);
+    }
+
+    InputEvent *e = &q->events[q->head++ & (INPUT_QUEUE_SIZE - 1)];
+    e->timestamp = key->timestamp;
+    e->type      = key->type;
+    e->key       = key->keysym.sym;
+}
+
+/*
+ * Drain SDL's event queue into the timestamped input queue. Runs on the main
+ * thread once per sim loop iteration, not once per rendered frame.
+ */
+static void sample_input(Game *game) {
+    SDL_Event events[64];
+    int count;
+
+    SDL_PumpEvents();
+    while ((count = SDL_PeepEvents(events, 64, SDL_GETEVENT,
+                                   SDL_FIRSTEVENT, SDL_LASTEVENT)) > 0) {
+        for (int i = 0; i < count; ++i) {
+            const SDL_Event *e = &events[i];
+            switch (e->type) {
+                case SDL_QUIT:
+                    game->running = 0;
+                    break;
+                case SDL_KEYDOWN:
+                    if (!e->key.repeat) {
+                        queue_input_event(game, &e->key);
+                    }
+                    break;
+                case SDL_KEYUP:
+                    queue_input_event(game, &e->key);
+                    break;
+                case SDL_WINDOWEVENT:
+                    /* With a mirror open, closing one window is no SDL_QUIT */
+                    if (e->window.event == SDL_WINDOWEVENT_CLOSE &&
+                        game->render.mirror.window) {
+                        if (e->window.windowID ==
+                            SDL_GetWindowID(game->render.mirror.window)) {
+                            SDL_HideWindow(game->render.mirror.window);
+                        } else {
+                            game->running = 0;
+                        }
+                    }
+                    break;
+                case SDL_RENDER_TARGETS_RESET:
+                    SDL_AtomicCAS(&game->render.targetsLost, 0, 1);
+                    SDL_AtomicCAS(&game->render.mirror.targetsLost, 0, 1);
+                    break;
+                case SDL_RENDER_DEVICE_RESET:
+                    SDL_AtomicSet(&game->render.targetsLost, 2);
+                    SDL_AtomicSet(&game->render.mirror.targetsLost, 2);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+/* Apply every queued event that happened no later than `tickMs` */
+static void apply_input(Game *game, Uint32 tickMs) {
+    InputQueue *q = &game->input;
+
+    while (q->tail != q->head) {
+        const InputEvent *e = &q->events[q->tail & (INPUT_QUEUE_SIZE - 1)];
+        if (!SDL_TICKS_PASSED(tickMs, e->timestamp)) {
+            break;
+        }
+        apply_input_event(game, e);
+        ++q->tail;
+    }
+}
+
+/* ----------------------------- Game Update ------------------------------- */
+
+static float player_direction(const Game *game) {
+    float dir = 0.0f;
+    if (game->leftPressed) {
+        dir -= 1.0f;
+    }
+    if (game->rightPressed) {
+        dir += 1.0f;
+    }
+    return dir;
+}
+
+static void update_window_title(Game *game) {
+    const char *stateStr = NULL;
+    switch (game->state) {
+        case GAME_STATE_MENU:
+            stateStr = game->resume.offered ? "RESUME RUN? Y/N" : "MENU";
+            break;
+        case GAME_STATE_PLAYING:
+            stateStr = "PLAYING";
+            break;
+        case GAME_STATE_PAUSED:
+            stateStr = "PAUSED";
+            break;
+        case GAME_STATE_GAME_OVER:
+            stateStr = "GAME OVER - R: REPLAY";
+            break;
+        case GAME_STATE_REPLAY:
+            stateStr = "REPLAY";
+            break;
+        default:
+            stateStr = "UNKNOWN";
+            break;
+    }
+
+    static char lastTitle[128];
+    char title[128];
+    snprintf(
+        title,
+        sizeof(title),
+        "Endless Dodge - Score: %d  High: %d  [%s]",
+        game->sim.score,
+        game->highScore,
+        stateStr
+    );
+
+    /* Called every sim tick; only touch the window when the text changes */
+    if (strcmp(title, lastTitle) != 0) {
+        SDL_SetWindowTitle(game->window, title);
+        memcpy(lastTitle, title, sizeof(title));
+    }
+}
+
+/* Tick length for the main loop; idle states tick at the longest length */
+static Uint32 game_tick_us(const Game *game) {
+    if (game->state != GAME_STATE_PLAYING) {
+        return SIM_MAX_TICK_US;
+    }
+    return sim_tick_us(&game->sim);
+}
+
+/* Subscriber: a death ends the run and records its score */
+static void end_run_on_death(Game *game, const SimEvent *events, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (events[i].type != SIM_EVENT_DIED) {
+            continue;
+        }
+        set_game_state(game, GAME_STATE_GAME_OVER);
+        if (game->sim.score > game->highScore) {
+            game->highScore = game->sim.score;
+            LOG_INFO("New high score: %d", game->highScore);
+        }
+        /* Persistence and submission happen on the leaderboard thread, and
+           the telemetry record on the telemetry writer */
+        leaderboard_submit(&game->leaderboard, game->sim.score, game->highScore);
+    }
+}
+
+/* Subscriber: a finished run has nothing to resume; pausing saves at once */
+static void checkpoint_run(Game *game, const SimEvent *events, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (events[i].type == SIM_EVENT_DIED) {
+            resume_clear(&game->resume);
+        } else if (events[i].type == SIM_EVENT_STATE_CHANGED &&
+                   events[i].to == GAME_STATE_PAUSED) {
+            resume_save(&game->resume, &game->sim);
+        }
+    }
+}
+
+/* Subscriber: sample the score curve on its timer; log each finished run */
+static void record_telemetry(Game *game, const SimEvent *events, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (events[i].type == SIM_EVENT_TIMER &&
+            events[i].slot == GAME_TIMER_TELEMETRY) {
+            telemetry_sample(&game->telemetry, &game->sim);
+        } else if (events[i].type == SIM_EVENT_DIED) {
+            telemetry_write(&game->telemetry, &game->sim, events[i].x);
+        }
+    }
+}
+
+/* Subscriber: trace state transitions */
+static void log_state_changes(Game *game, const SimEvent *events, int count) {
+    (void)game;
+    for (int i = 0; i < count; ++i) {
+        if (events[i].type == SIM_EVENT_STATE_CHANGED) {
+            LOG_DEBUG("Game state %d -> %d", events[i].from, events[i].to);
+        }
+    }
+}
+
+/*
+ * Consumers of the per-tick event buffer, each handed the whole batch. Score
+ * and the killcam recorder are applied inside the sim; new features (audio,
+ * effects, stats) register here instead of hooking the sim's inner loops.
+ */
+typedef void (*EventSubscriber)(Game *game, const SimEvent *events, int count);
+
+static const EventSubscriber EVENT_SUBSCRIBERS[] = {
+    end_run_on_death,
+    checkpoint_run,
+    record_telemetry,
+    log_state_changes,
+};
+
+#define EVENT_SUBSCRIBER_COUNT \
+    ((int)(sizeof(EVENT_SUBSCRIBERS) / sizeof(EVENT_SUBSCRIBERS[0])))
+
+static void dispatch_events(Game *game) {
+    Sim *sim = &game->sim;
+    int delivered = 0;
+
+    /* Subscribers may emit more (a death changes state); deliver those too */
+    while (delivered < sim->eventCount) {
+        int count = sim->eventCount;
+        for (int i = 0; i < EVENT_SUBSCRIBER_COUNT; ++i) {
+            EVENT_SUBSCRIBERS[i](game, sim->events + delivered, count - delivered);
+        }
+        delivered = count;
+    }
+    sim_clear_events(sim);
+}
+
+static void update_game(Game *game, Uint32 tickUs) {
+    if (game->state == GAME_STATE_REPLAY) {
+        if (!killcam_advance(&game->killcam, tickUs)) {
+            set_game_state(game, GAME_STATE_GAME_OVER);
+        }
+    } else if (game->state == GAME_STATE_PLAYING) {
+        sim_step(&game->sim, tickUs, player_direction(game));
+        profiler_count_sim(tickUs);
+    }
+
+    dispatch_events(game);
+}
+
+/* ---------------------------- Rendering ---------------------------------- */
+
+static void draw_filled_rect(SDL_Renderer *renderer,
+                             float x, float y, float w, float h,
+                             Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    SDL_Rect rect;
+    rect.x = (int)roundf(x);
+    rect.y = (int)roundf(y);
+    rect.w = (int)roundf(w);
+    rect.h = (int)roundf(h);
+
+    SDL_SetRenderDrawColor(renderer, r, g, b, a);
+    SDL_RenderFillRect(renderer, &rect);
+}
+
+/* The actual content of each overlay layer */
+static void draw_overlay_contents(SDL_Renderer *renderer, OverlayLayer layer) {
+    switch (layer) {
+        case OVERLAY_MENU:
+            draw_filled_rect(renderer,
+                             0, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
+                             0, 0, 0, MENU_TINT_ALPHA);
+            break;
+        case OVERLAY_PAUSED:
+            draw_filled_rect(renderer,
+                             0, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
+                             0, 0, 0, PAUSE_TINT_ALPHA);
+            break;
+        case OVERLAY_GAME_OVER:
+            draw_filled_rect(renderer,
+                             0, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
+                             120, 0, 0, GAME_OVER_TINT_ALPHA);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Mark a layer stale; call whenever its content would render differently */
+static void invalidate_overlay(OverlayCache *cache, OverlayLayer layer) {
+    cache->valid[layer] = 0;
+}
+
+static void invalidate_overlays(OverlayCache *cache) {
+    for (int i = 0; i < OVERLAY_COUNT; ++i) {
+        invalidate_overlay(cache, (OverlayLayer)i);
+    }
+}
+
+static void destroy_overlays(OverlayCache *cache) {
+    for (int i = 0; i < OVERLAY_COUNT; ++i) {
+        if (cache->textures[i]) {
+            SDL_DestroyTexture(cache->textures[i]);
+            cache->textures[i] = NULL;
+        }
+        cache->valid[i] = 0;
+    }
+}
+
+/* Render a layer into its target texture; returns 0 if targets don't work */
+static int build_overlay(OverlayCache *cache, SDL_Renderer *renderer,
+                         OverlayLayer layer) {
+    SDL_Texture *texture = cache->textures[layer];
+    if (!texture) {
+        texture = SDL_CreateTexture(renderer,
+                                    SDL_PIXELFORMAT_RGBA8888,
+                                    SDL_TEXTUREACCESS_TARGET,
+                                    WINDOW_WIDTH,
+                                    WINDOW_HEIGHT);
+        if (!texture) {
+            return 0;
+        }
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        cache->textures[layer] = texture;
+    }
+
+    if (SDL_SetRenderTarget(renderer, texture) != 0) {
+        return 0;
+    }
+
+    /* Write the layer's pixels as-is, alpha included */
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    draw_overlay_contents(renderer, layer);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    SDL_SetRenderTarget(renderer, NULL);
+    cache->valid[layer] = 1;
+    return 1;
+}
+
+static void draw_overlay(OverlayCache *cache, SDL_Renderer *renderer,
+                         OverlayLayer layer) {
+    if (!cache->unsupported && !cache->valid[layer] &&
+        !build_overlay(cache, renderer, layer)) {
+        LOG_ERROR("Render targets unavailable (%s); drawing overlays directly.",
+                  SDL_GetError());
+        destroy_overlays(cache);
+        cache->unsupported = 1;
+    }
+
+    if (cache->unsupported) {
+        draw_overlay_contents(renderer, layer);
+    } else {
+        SDL_RenderCopy(renderer, cache->textures[layer], NULL, NULL);
+    }
+}
+
+/* Two triangles per quad, the same for every frame */
+static void init_quad_indices(int *indices, int quads) {
+    for (int q = 0; q < quads; ++q) {
+        int *i = indices + 6 * q;
+        i[0] = 4 * q;     i[1] = 4 * q + 1; i[2] = 4 * q + 2;
+        i[3] = 4 * q + 2; i[4] = 4 * q + 3; i[5] = 4 * q;
+    }
+}
+
+/* Corners of a solid rect, snapped to whole pixels like draw_filled_rect() */
+static void set_quad(SDL_Vertex *v, float x, float y, float w, float h,
+                     Uint8 r, Uint8 g, Uint8 b) {
+    float x0 = roundf(x), y0 = roundf(y);
+    float x1 = x0 + roundf(w), y1 = y0 + roundf(h);
+
+    v[0].position.x = x0; v[0].position.y = y0;
+    v[1].position.x = x1; v[1].position.y = y0;
+    v[2].position.x = x1; v[2].position.y = y1;
+    v[3].position.x = x0; v[3].position.y = y1;
+    for (int i = 0; i < 4; ++i) {
+        v[i].color.r = r;
+        v[i].color.g = g;
+        v[i].color.b = b;
+        v[i].color.a = 255;
+        v[i].tex_coord.x = 0.0f;
+        v[i].tex_coord.y = 0.0f;
+    }
+}
+
+/*
+ * Late latch: re-read the keyboard and move the player on from its snapshot
+ * by the time since, as the sim will once it catches up. Only the drawn
+ * position changes; the next snapshot replaces it. SDL updates the key array
+ * when the main thread pumps events, so reading it here is at most one input
+ * sample old.
+ */
+static float late_latch_player_x(const RenderThread *rt, const RenderState *rs) {
+    const Uint8 *keys = SDL_GetKeyboardState(NULL);
+    float dir = 0.0f;
+    if (keys[rt->latchLeft[0]] || keys[rt->latchLeft[1]]) {
+        dir -= 1.0f;
+    }
+    if (keys[rt->latchRight[0]] || keys[rt->latchRight[1]]) {
+        dir += 1.0f;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (dir == 0.0f || now <= rs->simCounter) {
+        return rs->player.x;
+    }
+    double seconds = (double)(now - rs->simCounter) /
+                     (double)SDL_GetPerformanceFrequency();
+    if (seconds > LATE_LATCH_MAX_US / 1e6) {
+        seconds = LATE_LATCH_MAX_US / 1e6;
+    }
+
+    float x = rs->player.x + dir * rs->player.speed * (float)seconds;
+    float maxX = (float)WINDOW_WIDTH - rs->player.w;
+    return x < 0.0f ? 0.0f : (x > maxX ? maxX : x);
+}
+
+/* Turn a snapshot into draw commands */
+static void build_frame(const RenderThread *rt, const RenderState *game,
+                        RenderFrame *frame) {
+    /* Background */
+    frame->clear.r = BACKGROUND_COLOR_R;
+    frame->clear.g = BACKGROUND_COLOR_G;
+    frame->clear.b = BACKGROUND_COLOR_B;
+    frame->clear.a = 255;
+
+    /* Obstacles */
+    int quads = 1;
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        const Obstacle *o = &game->obstacles[i];
+        if (!o->active) continue;
+
+        set_quad(frame->vertices + 4 * quads++,
+                 o->x,
+                 o->y,
+                 o->w,
+                 o->h,
+                 OBSTACLE_COLOR_R,
+                 OBSTACLE_COLOR_G,
+                 OBSTACLE_COLOR_B);
+    }
+
+    /* Player, placed as late as possible; drawn first so obstacles cover it */
+    float playerX = game->player.x;
+    if (rt->lateLatch && game->state == GAME_STATE_PLAYING) {
+        playerX = late_latch_player_x(rt, game);
+    }
+    set_quad(frame->vertices,
+             playerX,
+             game->player.y,
+             game->player.w,
+             game->player.h,
+             PLAYER_COLOR_R,
+             PLAYER_COLOR_G,
+             PLAYER_COLOR_B);
+    frame->quads = quads;
+
+    /* State overlays (cached semi-transparent layers) */
+    if (game->state == GAME_STATE_MENU) {
+        frame->overlay = OVERLAY_MENU;
+    } else if (game->state == GAME_STATE_PAUSED) {
+        frame->overlay = OVERLAY_PAUSED;
+    } else if (game->state == GAME_STATE_GAME_OVER) {
+        frame->overlay = OVERLAY_GAME_OVER;
+    } else {
+        frame->overlay = -1;
+    }
+}
+
+/* Issue a frame's commands to one renderer; the caller presents */
+static void submit_frame(SDL_Renderer *renderer, OverlayCache *overlays,
+                         const int *indices, const RenderFrame *frame) {
+    SDL_SetRenderDrawColor(renderer, frame->clear.r, frame->clear.g,
+                           frame->clear.b, frame->clear.a);
+    SDL_RenderClear(renderer);
+
+    SDL_RenderGeometry(renderer, NULL, frame->vertices, 4 * frame->quads,
+                       indices, 6 * frame->quads);
+
+    if (frame->overlay >= 0) {
+        draw_overlay(overlays, renderer, (OverlayLayer)frame->overlay);
+    }
+}
+
+/* ------------------------- Render Command Stream ------------------------- */
+
+/*
+ * `--record-render <file>` writes every frame the render thread submits, as
+ * its RenderFrame, plus each present and each loss of render targets.
+ * `--replay-render <file> [passes]` submits the stream again as fast as the
+ * renderer takes it, with no sim, input or vsync, so renderer changes can be
+ * timed in isolation on identical workloads, on any SDL render driver
+ * (pick one with SDL_RENDER_DRIVER) and on any machine.
+ *
+ * File, host byte order: u32 magic, u32 version, u32 width, u32 height,
+ * then records of u32 type, u32 payload bytes, payload:
+ *
+ *     FRAME         u8 clear r, g, b, a; s32 overlay (-1: none); u32 quads;
+ *                   quads * 4 SDL_Vertex (f32 x, y; u8 r, g, b, a; f32 u, v)
+ *     PRESENT       u64 µs since the first record, as the present returned
+ *     TARGETS_LOST  u32 1: target contents lost, 2: textures lost
+ *
+ * Indices are implied: quad q is triangles (4q, 4q+1, 4q+2) and (4q+2,
+ * 4q+3, 4q). Readers skip record types they do not know.
+ */
+
+#define RCMD_MAGIC         0x43524445u  /* "EDRC" */
+#define RCMD_VERSION       1
+#define RCMD_BUFFER_BYTES  (1 << 20)    /* one write() per MB recorded */
+
+typedef enum {
+    RCMD_FRAME = 1,
+    RCMD_PRESENT,
+    RCMD_TARGETS_LOST
+} RenderCommand;
+
+typedef struct {
+    Uint8  clear[4];
+    Sint32 overlay;
+    Uint32 quads;
+} RenderFrameHeader;
+
+/* Main thread, before the render thread starts */
+static int render_record_open(RenderThread *rt, const char *path) {
+    Uint32 header[4] = { RCMD_MAGIC, RCMD_VERSION, WINDOW_WIDTH, WINDOW_HEIGHT };
+
+    rt->record = fopen(path, "wb");
+    if (!rt->record) {
+        LOG_ERROR("Cannot record render commands to %s: %s", path,
+                  strerror(errno));
+        return 0;
+    }
+    setvbuf(rt->record, NULL, _IOFBF, RCMD_BUFFER_BYTES);
+    if (fwrite(header, sizeof(header), 1, rt->record) != 1) {
+        LOG_ERROR("Failed to write %s", path);
+        fclose(rt->record);
+        rt->record = NULL;
+        return 0;
+    }
+    LOG_INFO("Recording render commands to %s", path);
+    return 1;
+}
+
+/* After the render thread has stopped */
+static void render_record_close(RenderThread *rt) {
+    if (rt->record) {
+        if (fclose(rt->record) != 0) {
+            LOG_ERROR("Failed to finish the render recording");
+        }
+        rt->record = NULL;
+    }
+}
+
+/* Render thread: append one record; a write error ends the recording */
+static void render_record(RenderThread *rt, Uint32 type, const void *a,
+                          size_t aBytes, const void *b, size_t bBytes) {
+    if (!rt->record) {
+        return;
+    }
+    if (rt->recordStart == 0) {
+        rt->recordStart = SDL_GetPerformanceCounter();
+    }
+
+    Uint32 header[2] = { type, (Uint32)(aBytes + bBytes) };
+    if (fwrite(header, sizeof(header), 1, rt->record) != 1 ||
+        fwrite(a, aBytes, 1, rt->record) != 1 ||
+        (bBytes > 0 && fwrite(b, bBytes, 1, rt->record) != 1)) {
+        LOG_ERROR("Render recording failed: %s; recording stopped",
+                  strerror(errno));
+        fclose(rt->record);
+        rt->record = NULL;
+    }
+}
+
+static void render_record_frame(RenderThread *rt, const RenderFrame *frame) {
+    RenderFrameHeader h;
+    h.clear[0] = frame->clear.r;
+    h.clear[1] = frame->clear.g;
+    h.clear[2] = frame->clear.b;
+    h.clear[3] = frame->clear.a;
+    h.overlay  = frame->overlay;
+    h.quads    = (Uint32)frame->quads;
+    render_record(rt, RCMD_FRAME, &h, sizeof(h), frame->vertices,
+                  4 * (size_t)frame->quads * sizeof(SDL_Vertex));
+}
+
+static void render_record_present(RenderThread *rt) {
+    if (rt->record) {
+        Uint64 now = SDL_GetPerformanceCounter();
+        Uint64 us = (now - rt->recordStart) * 1000000 /
+                    SDL_GetPerformanceFrequency();
+        render_record(rt, RCMD_PRESENT, &us, sizeof(us), NULL, 0);
+    }
+}
+
+static void render_record_targets_lost(RenderThread *rt, int lost) {
+    Uint32 kind = (Uint32)lost;
+    render_record(rt, RCMD_TARGETS_LOST, &kind, sizeof(kind), NULL, 0);
+}
+
+/* Build a frame, submit it, then hand it to the mirror as it stands */
+static void render_game(RenderThread *rt, const RenderState *game) {
+    RenderFrame *frame = &rt->built[rt->buildSlot];
+    build_frame(rt, game, frame);
+    if (rt->record) {
+        render_record_frame(rt, frame);
+    }
+    submit_frame(rt->renderer, &rt->overlays, rt->indices, frame);
+    rt->buildSlot = SDL_AtomicSet(&rt->builtLatest,
+                                  rt->buildSlot | RENDER_SLOT_FRESH) & 3;
+}
+
+/* Drop cached overlays after the driver lost render targets (1) or textures (2) */
+static void handle_targets_lost(OverlayCache *overlays, int lost) {
+    if (lost == 2) {
+        destroy_overlays(overlays);
+    } else if (lost == 1) {
+        invalidate_overlays(overlays);
+    }
+}
+
+static int frame_time_compare(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+/* Parse one FRAME payload into `frame`; 0 if malformed */
+static int replay_parse_frame(const Uint8 *p, Uint32 bytes, RenderFrame *frame) {
+    RenderFrameHeader h;
+    if (bytes < sizeof(h)) {
+        return 0;
+    }
+    memcpy(&h, p, sizeof(h));
+    if (h.quads > RENDER_MAX_QUADS ||
+        h.overlay < -1 || h.overlay >= OVERLAY_COUNT ||
+        bytes != sizeof(h) + 4 * (size_t)h.quads * sizeof(SDL_Vertex)) {
+        return 0;
+    }
+    frame->clear.r = h.clear[0];
+    frame->clear.g = h.clear[1];
+    frame->clear.b = h.clear[2];
+    frame->clear.a = h.clear[3];
+    frame->overlay = h.overlay;
+    frame->quads   = (int)h.quads;
+    memcpy(frame->vertices, p + sizeof(h),
+           4 * (size_t)h.quads * sizeof(SDL_Vertex));
+    return 1;
+}
+
+/*
+ * Load a recording whole, so file I/O is not timed, and count its frames.
+ * Returns the data (free() it) or NULL after logging why.
+ */
+static Uint8 *replay_load(const char *path, size_t *size, Uint32 *frames) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        LOG_ERROR("Cannot open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+    Uint8 *data = NULL;
+    long length = fseek(f, 0, SEEK_END) == 0 ? ftell(f) : -1;
+    if (length >= 16 && fseek(f, 0, SEEK_SET) == 0) {
+        data = (Uint8 *)malloc((size_t)length);
+        if (data && fread(data, (size_t)length, 1, f) != 1) {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(f);
+
+    Uint32 header[4];
+    if (data) {
+        memcpy(header, data, sizeof(header));
+    }
+    if (!data || header[0] != RCMD_MAGIC || header[1] != RCMD_VERSION) {
+        LOG_ERROR("%s is not a render recording (version %d)", path,
+                  RCMD_VERSION);
+        free(data);
+        return NULL;
+    }
+
+    *size = (size_t)length;
+    *frames = 0;
+    for (size_t at = sizeof(header); at < *size;) {
+        Uint32 record[2];
+        if (*size - at < sizeof(record)) {
+            LOG_WARN("%s is truncated; replaying what is there", path);
+            *size = at;
+            break;
+        }
+        memcpy(record, data + at, sizeof(record));
+        if (record[1] > *size - at - sizeof(record)) {
+            LOG_WARN("%s is truncated; replaying what is there", path);
+            *size = at;
+            break;
+        }
+        if (record[0] == RCMD_PRESENT) {
+            ++*frames;
+        }
+        at += sizeof(record) + record[1];
+    }
+    return data;
+}
+
+static int run_render_replay(const char *path, int passes) {
+    static RenderThread rt;
+    size_t size = 0;
+    Uint32 frames = 0;
+    int status = EXIT_FAILURE;
+
+    if (passes <= 0) {
+        LOG_ERROR("Usage: --replay-render <file> [passes]");
+        return EXIT_FAILURE;
+    }
+    Uint8 *data = replay_load(path, &size, &frames);
+    if (!data) {
+        return EXIT_FAILURE;
+    }
+    size_t timeCount = (size_t)frames * (size_t)passes;
+    float *times = (float *)malloc((timeCount > 0 ? timeCount : 1) * sizeof(float));
+    if (!times || frames == 0) {
+        if (times) {
+            LOG_ERROR("%s has no frames", path);
+        } else {
+            LOG_ERROR("Out of memory for %s", path);
+        }
+        free(times);
+        free(data);
+        return EXIT_FAILURE;
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        LOG_ERROR("SDL_Init failed: %s", SDL_GetError());
+        free(times);
+        free(data);
+        return EXIT_FAILURE;
+    }
+    SDL_SetHint(SDL_HINT_RENDER_VSYNC, "0");
+    memset(&rt, 0, sizeof(rt));
+    rt.window = SDL_CreateWindow("Endless Dodge - render replay",
+                                 SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                 WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
+    rt.renderer = rt.window ? SDL_CreateRenderer(rt.window, -1, 0) : NULL;
+    if (!rt.renderer) {
+        LOG_ERROR("Cannot create a renderer: %s", SDL_GetError());
+        goto done;
+    }
+    SDL_SetRenderDrawBlendMode(rt.renderer, SDL_BLENDMODE_BLEND);
+    init_quad_indices(rt.indices, RENDER_MAX_QUADS);
+    rt.overlays.unsupported = !SDL_RenderTargetSupported(rt.renderer);
+
+    SDL_RendererInfo info;
+    const char *driver = SDL_GetRendererInfo(rt.renderer, &info) == 0
+                             ? info.name : "unknown";
+    LOG_INFO("Replaying %u frames x %d passes on the %s renderer",
+             (unsigned)frames, passes, driver);
+
+    const double perfFreq = (double)SDL_GetPerformanceFrequency();
+    size_t timed = 0;
+    int quit = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 frameStart = start;
+    for (int pass = 0; pass < passes && !quit; ++pass) {
+        for (size_t at = 4 * sizeof(Uint32);
+             at + 2 * sizeof(Uint32) <= size && !quit;) {
+            Uint32 record[2];
+            memcpy(record, data + at, sizeof(record));
+            const Uint8 *payload = data + at + sizeof(record);
+            at += sizeof(record) + record[1];
+
+            if (record[0] == RCMD_FRAME) {
+                if (!replay_parse_frame(payload, record[1], &rt.built[0])) {
+                    LOG_ERROR("Malformed frame in %s", path);
+                    goto done;
+                }
+                submit_frame(rt.renderer, &rt.overlays, rt.indices,
+                             &rt.built[0]);
+            } else if (record[0] == RCMD_PRESENT) {
+                SDL_RenderPresent(rt.renderer);
+                Uint64 now = SDL_GetPerformanceCounter();
+                times[timed++] = (float)((double)(now - frameStart) * 1000.0 /
+                                         perfFreq);
+                frameStart = now;
+
+                SDL_Event e;
+                SDL_PumpEvents();
+                quit = SDL_PeepEvents(&e, 1, SDL_GETEVENT, SDL_QUIT, SDL_QUIT) > 0;
+            } else if (record[0] == RCMD_TARGETS_LOST && record[1] >= 4) {
+                Uint32 lost;
+                memcpy(&lost, payload, sizeof(lost));
+                handle_targets_lost(&rt.overlays, (int)lost);
+            }
+        }
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / perfFreq;
+
+    qsort(times, timed, sizeof(float), frame_time_compare);
+    double sum = 0.0;
+    for (size_t i = 0; i < timed; ++i) {
+        sum += times[i];
+    }
+    LOG_INFO("%u frames in %.3f s: %.1f frames/s on %s", (unsigned)timed,
+             seconds, seconds > 0.0 ? timed / seconds : 0.0, driver);
+    LOG_INFO("Frame ms: mean %.3f, median %.3f, p99 %.3f, max %.3f",
+             sum / (double)timed, times[timed / 2],
+             times[timed - 1 - timed / 100], times[timed - 1]);
+    status = EXIT_SUCCESS;
+
+done:
+    destroy_overlays(&rt.overlays);
+    if (rt.renderer) {
+        SDL_DestroyRenderer(rt.renderer);
+    }
+    if (rt.window) {
+        SDL_DestroyWindow(rt.window);
+    }
+    SDL_Quit();
+    free(times);
+    free(data);
+    return status;
+}
+
+/* ----------------------------- Render Thread ----------------------------- */
+
+static void frame_scheduler_init(FrameScheduler *fs, int refreshHz) {
+    memset(fs, 0, sizeof(*fs));
+    fs->freq      = SDL_GetPerformanceFrequency();
+    fs->refresh   = fs->freq / (Uint64)(refreshHz > 0 ? refreshHz : TARGET_FPS);
+    fs->margin    = FRAME_MARGIN_INIT_US * fs->freq / 1000000;
+    fs->marginMin = FRAME_MARGIN_MIN_US * fs->freq / 1000000;
+}
+
+/* Sleep until the latest frame start that still makes the next vblank */
+static void frame_scheduler_wait(const FrameScheduler *fs) {
+    Uint64 lead = fs->cost + fs->margin;
+    if (fs->vblank == 0 || lead >= fs->refresh) {
+        return;
+    }
+
+    Uint64 start = fs->vblank + fs->refresh - lead;
+    Uint64 oneMs = fs->freq / 1000;
+    for (;;) {
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now >= start) {
+            break;
+        }
+        /* Sleeps overshoot; wake a millisecond early and spin the rest */
+        Uint64 ms = (start - now) / oneMs;
+        if (ms >= 2) {
+            SDL_Delay((Uint32)(ms - 1));
+        }
+    }
+}
+
+/* Learn from a frame that started at `start` and was presented */
+static void frame_scheduler_presented(FrameScheduler *fs, Uint64 start,
+                                      Uint64 submitted, Uint64 returned) {
+    Uint64 cost = submitted - start;
+    fs->cost = cost > fs->cost ? cost : fs->cost - (fs->cost - cost) / 16;
+
+    if (fs->vblank != 0 &&
+        returned > fs->vblank + fs->refresh + fs->refresh / 2) {
+        /* Landed a vblank late: start earlier from now on */
+        fs->missed++;
+        fs->margin *= 2;
+        if (fs->margin > fs->refresh / 2) {
+            fs->margin = fs->refresh / 2;
+        }
+    } else if (fs->margin > fs->marginMin) {
+        fs->margin -= (fs->margin - fs->marginMin) / 64 + 1;
+    }
+    fs->vblank = returned;
+    fs->frames++;
+}
+
+/*
+ * Main thread: snapshot the sim into the free slot and hand it over.
+ * `simCounter` is the performance counter time the sim has been stepped to.
+ */
+static void publish_render_state(Game *game, Uint64 simCounter) {
+    RenderThread *rt = &game->render;
+    RenderState  *rs = &rt->slots[rt->writeSlot];
+
+    rs->state = game->state;
+    rs->simCounter = simCounter;
+    if (game->state == GAME_STATE_REPLAY) {
+        rs->player = game->killcam.viewPlayer;
+        memcpy(rs->obstacles, game->killcam.viewObstacles,
+               sizeof(rs->obstacles));
+    } else {
+        rs->player = game->sim.player;
+        memcpy(rs->obstacles, game->sim.obstacles, sizeof(rs->obstacles));
+    }
+
+    rt->writeSlot = SDL_AtomicSet(&rt->latest,
+                                  rt->writeSlot | RENDER_SLOT_FRESH) & 3;
+}
+
+/* Render thread: switch to the newest snapshot if one was published */
+static const RenderState *acquire_render_state(RenderThread *rt) {
+    if (SDL_AtomicGet(&rt->latest) & RENDER_SLOT_FRESH) {
+        rt->readSlot = SDL_AtomicSet(&rt->latest, rt->readSlot) & 3;
+    }
+    return &rt->slots[rt->readSlot];
+}
+
+/*
+ * Draw the field at its own size, letterboxed in whatever the display mode
+ * is. Whole-number scales keep its edges sharp, so they are used whenever
+ * the output fits at least one copy.
+ */
+static void set_render_scale(SDL_Renderer *renderer) {
+    int w = 0, h = 0;
+    SDL_GetRendererOutputSize(renderer, &w, &h);
+    SDL_RenderSetLogicalSize(renderer, WINDOW_WIDTH, WINDOW_HEIGHT);
+    if (w >= WINDOW_WIDTH && h >= WINDOW_HEIGHT) {
+        SDL_RenderSetIntegerScale(renderer, SDL_TRUE);
+    }
+    if (w != WINDOW_WIDTH || h != WINDOW_HEIGHT) {
+        int scale = w / WINDOW_WIDTH < h / WINDOW_HEIGHT ? w / WINDOW_WIDTH
+                                                         : h / WINDOW_HEIGHT;
+        if (scale >= 1) {
+            LOG_INFO("Output %dx%d: field scaled %dx, letterboxed", w, h, scale);
+        } else {
+            LOG_INFO("Output %dx%d is smaller than the field; scaled down", w, h);
+        }
+    }
+}
+
+static int render_thread_main(void *data) {
+    RenderThread *rt = (RenderThread *)data;
+    int profileSlot = profiler_register_thread("render");
+
+    rt->renderer = SDL_CreateRenderer(
+        rt->window,
+        -1,
+        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
+    );
+    if (!rt->renderer) {
+        LOG_ERROR("SDL_CreateRenderer failed: %s", SDL_GetError());
+        profiler_unregister_thread(profileSlot);
+        SDL_SemPost(rt->ready);
+        return 0;
+    }
+
+    SDL_SetRenderDrawBlendMode(rt->renderer, SDL_BLENDMODE_BLEND);
+    set_render_scale(rt->renderer);
+    init_quad_indices(rt->indices, RENDER_MAX_QUADS);
+    rt->latchLeft[0]  = SDL_GetScancodeFromKey(SDLK_a);
+    rt->latchLeft[1]  = SDL_GetScancodeFromKey(SDLK_LEFT);
+    rt->latchRight[0] = SDL_GetScancodeFromKey(SDLK_d);
+    rt->latchRight[1] = SDL_GetScancodeFromKey(SDLK_RIGHT);
+
+    SDL_RendererInfo info;
+    int vsync = SDL_GetRendererInfo(rt->renderer, &info) == 0 &&
+                (info.flags & SDL_RENDERER_PRESENTVSYNC);
+    rt->overlays.unsupported = !SDL_RenderTargetSupported(rt->renderer);
+
+    frame_scheduler_init(&rt->frames, rt->refreshHz);
+
+    SDL_AtomicSet(&rt->ok, 1);
+    SDL_SemPost(rt->ready);
+
+    while (!SDL_AtomicGet(&rt->quit)) {
+        int lost = SDL_AtomicSet(&rt->targetsLost, 0);
+        if (lost) {
+            handle_targets_lost(&rt->overlays, lost);
+            render_record_targets_lost(rt, lost);
+        }
+
+        if (!vsync) {
+            render_game(rt, acquire_render_state(rt));
+            SDL_RenderPresent(rt->renderer);
+            render_record_present(rt);
+            /* No vblank to wait on; pace presents ourselves */
+            SDL_Delay(FRAME_TIME_MS);
+            continue;
+        }
+
+        /* Pick up the newest snapshot only once the frame is due */
+        frame_scheduler_wait(&rt->frames);
+        Uint64 start = SDL_GetPerformanceCounter();
+        render_game(rt, acquire_render_state(rt));
+        Uint64 submitted = SDL_GetPerformanceCounter();
+        SDL_RenderPresent(rt->renderer);
+        Uint64 presented = SDL_GetPerformanceCounter();
+        render_record_present(rt);
+        frame_scheduler_presented(&rt->frames, start, submitted, presented);
+    }
+
+    if (vsync && rt->frames.frames > 0) {
+        LOG_INFO("Frames: %u presented, %u missed their vblank",
+                 rt->frames.frames, rt->frames.missed);
+    }
+
+    destroy_overlays(&rt->overlays);
+    SDL_DestroyRenderer(rt->renderer);
+    rt->renderer = NULL;
+    profiler_unregister_thread(profileSlot);
+    return 0;
+}
+
+/* Mirror thread: switch to the newest built frame; NULL until there is one */
+static const RenderFrame *acquire_mirror_frame(RenderThread *rt) {
+    MirrorOutput *m = &rt->mirror;
+    if (SDL_AtomicGet(&rt->builtLatest) & RENDER_SLOT_FRESH) {
+        m->readSlot = SDL_AtomicSet(&rt->builtLatest, m->readSlot) & 3;
+        ++m->shown;
+    }
+    return m->shown > 0 ? &rt->built[m->readSlot] : NULL;
+}
+
+static int mirror_thread_main(void *data) {
+    RenderThread *rt = (RenderThread *)data;
+    MirrorOutput *m = &rt->mirror;
+    int profileSlot = profiler_register_thread("mirror");
+
+    m->renderer = SDL_CreateRenderer(
+        m->window,
+        -1,
+        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
+    );
+    if (!m->renderer) {
+        LOG_ERROR("Mirror: SDL_CreateRenderer failed: %s", SDL_GetError());
+        profiler_unregister_thread(profileSlot);
+        SDL_SemPost(m->ready);
+        return 0;
+    }
+
+    SDL_SetRenderDrawBlendMode(m->renderer, SDL_BLENDMODE_BLEND);
+    set_render_scale(m->renderer);
+
+    SDL_RendererInfo info;
+    int vsync = SDL_GetRendererInfo(m->renderer, &info) == 0 &&
+                (info.flags & SDL_RENDERER_PRESENTVSYNC);
+    m->overlays.unsupported = !SDL_RenderTargetSupported(m->renderer);
+
+    frame_scheduler_init(&m->frames, m->refreshHz);
+
+    SDL_AtomicSet(&m->ok, 1);
+    SDL_SemPost(m->ready);
+
+    while (!SDL_AtomicGet(&m->quit)) {
+        int lost = SDL_AtomicSet(&m->targetsLost, 0);
+        if (lost) {
+            handle_targets_lost(&m->overlays, lost);
+        }
+
+        if (vsync) {
+            frame_scheduler_wait(&m->frames);
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        const RenderFrame *frame = acquire_mirror_frame(rt);
+        if (!frame) {
+            SDL_Delay(1);
+            continue;
+        }
+        submit_frame(m->renderer, &m->overlays, rt->indices, frame);
+        Uint64 submitted = SDL_GetPerformanceCounter();
+        SDL_RenderPresent(m->renderer);
+        if (vsync) {
+            frame_scheduler_presented(&m->frames, start, submitted,
+                                      SDL_GetPerformanceCounter());
+        } else {
+            SDL_Delay(FRAME_TIME_MS);
+        }
+    }
+
+    if (vsync) {
+        LOG_INFO("Mirror: %u presented (%u distinct frames), %u missed "
+                 "their vblank", m->frames.frames, m->shown, m->frames.missed);
+    } else {
+        LOG_INFO("Mirror: %u distinct frames presented", m->shown);
+    }
+
+    destroy_overlays(&m->overlays);
+    SDL_DestroyRenderer(m->renderer);
+    m->renderer = NULL;
+    profiler_unregister_thread(profileSlot);
+    return 0;
+}
+
+/* Start the mirror's thread once the render thread's indices are ready */
+static int mirror_start(RenderThread *rt) {
+    MirrorOutput *m = &rt->mirror;
+    SDL_DisplayMode mode;
+    memset(&mode, 0, sizeof(mode));
+    m->refreshHz = SDL_GetCurrentDisplayMode(
+                       SDL_GetWindowDisplayIndex(m->window), &mode) == 0
+                       ? mode.refresh_rate : 0;
+    m->readSlot = 2;
+
+    m->ready = SDL_CreateSemaphore(0);
+    if (!m->ready) {
+        LOG_ERROR("SDL_CreateSemaphore failed: %s", SDL_GetError());
+        return 0;
+    }
+    m->thread = SDL_CreateThread(mirror_thread_main, "mirror", rt);
+    if (!m->thread) {
+        LOG_ERROR("SDL_CreateThread failed: %s", SDL_GetError());
+        return 0;
+    }
+
+    SDL_SemWait(m->ready);
+    if (!SDL_AtomicGet(&m->ok)) {
+        SDL_WaitThread(m->thread, NULL);
+        m->thread = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+static void mirror_stop(MirrorOutput *m) {
+    if (m->thread) {
+        SDL_AtomicSet(&m->quit, 1);
+        SDL_WaitThread(m->thread, NULL);
+        m->thread = NULL;
+    }
+    if (m->ready) {
+        SDL_DestroySemaphore(m->ready);
+        m->ready = NULL;
+    }
+}
+
+/* Start the render thread and wait until its renderer is ready */
+static int render_thread_start(RenderThread *rt, SDL_Window *window) {
+    SDL_DisplayMode mode;
+    memset(&mode, 0, sizeof(mode));
+    rt->window    = window;
+    rt->refreshHz = SDL_GetWindowDisplayMode(window, &mode) == 0
+                        ? mode.refresh_rate : 0;
+    rt->readSlot  = 0;
+    rt->writeSlot = 1;
+    SDL_AtomicSet(&rt->latest, 2);
+    rt->buildSlot = 0;
+    SDL_AtomicSet(&rt->builtLatest, 1);
+
+    rt->ready = SDL_CreateSemaphore(0);
+    if (!rt->ready) {
+        LOG_ERROR("SDL_CreateSemaphore failed: %s", SDL_GetError());
+        return 0;
+    }
+
+    rt->thread = SDL_CreateThread(render_thread_main, "render", rt);
+    if (!rt->thread) {
+        LOG_ERROR("SDL_CreateThread failed: %s", SDL_GetError());
+        SDL_DestroySemaphore(rt->ready);
+        rt->ready = NULL;
+        return 0;
+    }
+
+    SDL_SemWait(rt->ready);
+    if (!SDL_AtomicGet(&rt->ok)) {
+        SDL_WaitThread(rt->thread, NULL);
+        rt->thread = NULL;
+        return 0;
+    }
+
+    /* The spectators can do without it; the player cannot */
+    if (rt->mirror.window && !mirror_start(rt)) {
+        LOG_WARN("Mirror unavailable; carrying on without it");
+        mirror_stop(&rt->mirror);
+        SDL_HideWindow(rt->mirror.window);
+    }
+    return 1;
+}
+
+static void render_thread_stop(RenderThread *rt) {
+    mirror_stop(&rt->mirror);
+    if (rt->thread) {
+        SDL_AtomicSet(&rt->quit, 1);
+        SDL_WaitThread(rt->thread, NULL);
+        rt->thread = NULL;
+    }
+    render_record_close(rt);
+    if (rt->ready) {
+        SDL_DestroySemaphore(rt->ready);
+        rt->ready = NULL;
+    }
+}
+
+/* ------------------------- Kernel Verification --------------------------- */
+
+/*
+ * Differential harness behind `--verify-kernels`. Random and adversarial
+ * player/obstacle configurations are fed to every kernel variant on all
+ * cores and compared against the scalar reference. Each mismatch is shrunk
+ * to a minimal configuration that still disagrees before it is reported.
+ */
+
+#define VERIFY_DEFAULT_CASES  2000000L
+#define VERIFY_BATCH          4096L
+#define VERIFY_MAX_REPORTS    8
+
+typedef enum {
+    KERNEL_INTERSECT = 0,
+    KERNEL_UPDATE,
+    KERNEL_COLLIDE,
+    KERNEL_COUNT
+} KernelKind;
+
+static const char *KERNEL_NAMES[KERNEL_COUNT] = {
+    "rects_intersect", "update_obstacles", "check_collisions"
+};
+
+typedef struct {
+    const char *name;
+    int   gridOnly;  /* exact only for coordinates on the fixed-point grid */
+    int  (*intersect)(float, float, float, float, float, float, float, float);
+    void (*update)(Sim *, float);
+    int  (*collide)(Sim *);
+} KernelVariant;
+
+/* Entry 0 is the reference; NULL means the variant has no such kernel */
+static const KernelVariant KERNEL_VARIANTS[] = {
+    { "scalar",     0, rects_intersect, update_obstacles, check_collisions },
+    { "branchless", 0, rects_intersect_branchless, NULL,
+                       check_collisions_branchless },
+#if defined(__SSE2__)
+    { "sse2",       0, NULL, update_obstacles_sse2, check_collisions_sse2 },
+#endif
+    { "fixed",      1, rects_intersect_fixed_f, NULL, check_collisions_fixed },
+};
+
+#define KERNEL_VARIANT_COUNT \
+    ((int)(sizeof(KERNEL_VARIANTS) / sizeof(KERNEL_VARIANTS[0])))
+
+/* A configuration under test; only player, obstacles and events are used */
+typedef struct {
+    Sim   sim;
+    float dt;
+} VerifyCase;
+
+typedef struct {
+    int        variant;
+    KernelKind kind;
+    long       index;
+    VerifyCase repro;
+} VerifyReport;
+
+typedef struct {
+    long          cases;
+    Uint64        seed;
+    SDL_atomic_t  mismatches[KERNEL_VARIANT_COUNT][KERNEL_COUNT];
+    SDL_SpinLock  reportLock;
+    int           reportCount;
+    VerifyReport  reports[VERIFY_MAX_REPORTS];
+} VerifyRun;
+
+/* splitmix64: cheap, and every case is reproducible from (seed, index) */
+static Uint64 verify_next(Uint64 *state) {
+    Uint64 z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static float verify_unit(Uint64 *state) {
+    return (float)(verify_next(state) >> 40) / (float)(1 << 24);
+}
+
+/* Random value in [min, max] snapped to the 1/256 px fixed-point grid */
+static float verify_grid(Uint64 *state, float min, float max) {
+    float v = min + verify_unit(state) * (max - min);
+    return roundf(v * (float)FIXED_ONE) / (float)FIXED_ONE;
+}
+
+/* Finite values around which float comparisons and sums misbehave */
+static float verify_extreme(Uint64 *state) {
+    static const float EXTREMES[] = {
+        0.0f, -0.0f, FLT_MIN, -FLT_MIN, 1e-45f, -1e-45f, FLT_EPSILON,
+        1.0f, -1.0f, 16777216.0f, -16777216.0f, 16777217.0f,
+        1e30f, -1e30f, FLT_MAX, -FLT_MAX, FLT_MAX / 2.0f, -FLT_MAX / 2.0f,
+        (float)WINDOW_WIDTH, (float)WINDOW_HEIGHT, FIXED_MAX_COORD
+    };
+    int n = (int)(sizeof(EXTREMES) / sizeof(EXTREMES[0]));
+    Uint64 r = verify_next(state);
+    if (r & 1) {
+        return EXTREMES[(r >> 1) % (Uint64)n];
+    }
+    /* Random bit pattern, rejected until finite */
+    for (;;) {
+        Uint32 bits = (Uint32)(verify_next(state) >> 32);
+        float v;
+        memcpy(&v, &bits, sizeof(v));
+        if (isfinite(v)) {
+            return v;
+        }
+    }
+}
+
+/* Place one edge of an obstacle exactly on (or one ulp off) a player edge */
+static void verify_touch(Uint64 *state, const Player *p, Obstacle *o, int ulps) {
+    switch (verify_next(state) % 4) {
+        case 0: o->x = p->x + p->w;  break;
+        case 1: o->x = p->x - o->w;  break;
+        case 2: o->y = p->y + p->h;  break;
+        default: o->y = p->y - o->h; break;
+    }
+    if (ulps) {
+        float dir = (verify_next(state) & 1) ? FLT_MAX : -FLT_MAX;
+        o->x = nextafterf(o->x, dir);
+        o->y = nextafterf(o->y, dir);
+    }
+}
+
+static void verify_generate(VerifyCase *c, Uint64 seed, long index) {
+    Uint64 state = seed ^ ((Uint64)index * 0xD1B54A32D192ED03ULL);
+    int mode = (int)(verify_next(&state) % 4);
+    Player   *p = &c->sim.player;
+
+    memset(c, 0, sizeof(*c));
+
+    if (mode == 3) {
+        p->x = verify_extreme(&state);
+        p->y = verify_extreme(&state);
+        p->w = verify_extreme(&state);
+        p->h = verify_extreme(&state);
+        c->dt = verify_extreme(&state);
+    } else {
+        p->x = verify_grid(&state, -200.0f, WINDOW_WIDTH + 200.0f);
+        p->y = verify_grid(&state, -200.0f, WINDOW_HEIGHT + 200.0f);
+        p->w = verify_grid(&state, 0.0f, 2.0f * PLAYER_WIDTH);
+        p->h = verify_grid(&state, 0.0f, 2.0f * PLAYER_HEIGHT);
+        c->dt = verify_unit(&state) * 0.1f;
+    }
+
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        Obstacle *o = &c->sim.obstacles[i];
+        o->active = (verify_next(&state) % 3) != 0;
+
+        if (mode == 3) {
+            o->x = verify_extreme(&state);
+            o->y = verify_extreme(&state);
+            o->w = verify_extreme(&state);
+            o->h = verify_extreme(&state);
+            o->speed = verify_extreme(&state);
+            continue;
+        }
+
+        o->x = verify_grid(&state, -OBSTACLE_MAX_WIDTH, WINDOW_WIDTH);
+        o->y = verify_grid(&state, -OBSTACLE_HEIGHT, WINDOW_HEIGHT + 50.0f);
+        o->w = verify_grid(&state, 0.0f, OBSTACLE_MAX_WIDTH);
+        o->h = verify_grid(&state, 0.0f, 2.0f * OBSTACLE_HEIGHT);
+        o->speed = verify_unit(&state) * 2000.0f;
+
+        if (mode > 0 && (verify_next(&state) % 4) == 0) {
+            verify_touch(&state, p, o, mode == 2);
+        }
+    }
+}
+
+static int verify_case_on_grid(const VerifyCase *c) {
+    const Player *p = &c->sim.player;
+    if (!float_on_fixed_grid(p->x) || !float_on_fixed_grid(p->y) ||
+        !float_on_fixed_grid(p->w) || !float_on_fixed_grid(p->h)) {
+        return 0;
+    }
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        const Obstacle *o = &c->sim.obstacles[i];
+        if (!float_on_fixed_grid(o->x) || !float_on_fixed_grid(o->y) ||
+            !float_on_fixed_grid(o->w) || !float_on_fixed_grid(o->h)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Nonzero if `variant` disagrees with the reference for this kernel */
+static int verify_kernel(const VerifyCase *c, int variant, KernelKind kind) {
+    const KernelVariant *ref = &KERNEL_VARIANTS[0];
+    const KernelVariant *v   = &KERNEL_VARIANTS[variant];
+
+    if (v->gridOnly && !verify_case_on_grid(c)) {
+        return 0;
+    }
+
+    switch (kind) {
+        case KERNEL_INTERSECT: {
+            if (!v->intersect) return 0;
+            const Player *p = &c->sim.player;
+            for (int i = 0; i < MAX_OBSTACLES; ++i) {
+                const Obstacle *o = &c->sim.obstacles[i];
+                int want = ref->intersect(p->x, p->y, p->w, p->h,
+                                          o->x, o->y, o->w, o->h);
+                int got = v->intersect(p->x, p->y, p->w, p->h,
+                                       o->x, o->y, o->w, o->h);
+                if (!want != !got) return 1;
+            }
+            return 0;
+        }
+        case KERNEL_UPDATE: {
+            if (!v->update) return 0;
+            Sim want = c->sim;
+            Sim got  = c->sim;
+            ref->update(&want, c->dt);
+            v->update(&got, c->dt);
+            if (want.eventCount != got.eventCount) return 1;
+            for (int i = 0; i < want.eventCount; ++i) {
+                if (want.events[i].type != got.events[i].type ||
+                    want.events[i].slot != got.events[i].slot) {
+                    return 1;
+                }
+            }
+            for (int i = 0; i < MAX_OBSTACLES; ++i) {
+                const Obstacle *a = &want.obstacles[i];
+                const Obstacle *b = &got.obstacles[i];
+                if (a->active != b->active ||
+                    memcmp(&a->y, &b->y, sizeof(a->y)) != 0) {
+                    return 1;
+                }
+            }
+            return 0;
+        }
+        case KERNEL_COLLIDE: {
+            if (!v->collide) return 0;
+            Sim want = c->sim;
+            Sim got  = c->sim;
+            return !ref->collide(&want) != !v->collide(&got);
+        }
+        default:
+            return 0;
+    }
+}
+
+/* Try one simplification of *field; keep it if the mismatch survives */
+static int verify_try(VerifyCase *c, float *field, float candidate,
+                      int variant, KernelKind kind) {
+    float saved = *field;
+    if (memcmp(&saved, &candidate, sizeof(saved)) == 0) {
+        return 0;
+    }
+    *field = candidate;
+    if (verify_kernel(c, variant, kind)) {
+        return 1;
+    }
+    *field = saved;
+    return 0;
+}
+
+static int verify_simplify(VerifyCase *c, float *field,
+                           int variant, KernelKind kind) {
+    return verify_try(c, field, 0.0f, variant, kind) ||
+           verify_try(c, field, truncf(*field), variant, kind) ||
+           verify_try(c, field, *field * 0.5f, variant, kind);
+}
+
+/* Greedy shrink: drop obstacles, then simplify values, to a fixed point */
+static void verify_minimize(VerifyCase *c, int variant, KernelKind kind) {
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+
+        for (int i = 0; i < MAX_OBSTACLES; ++i) {
+            Obstacle *o = &c->sim.obstacles[i];
+            if (!o->active) continue;
+            o->active = 0;
+            if (verify_kernel(c, variant, kind)) {
+                changed = 1;
+            } else {
+                o->active = 1;
+            }
+        }
+
+        Player *p = &c->sim.player;
+        float *fields[] = { &p->x, &p->y, &p->w, &p->h, &c->dt };
+        for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); ++f) {
+            changed |= verify_simplify(c, fields[f], variant, kind);
+        }
+
+        for (int i = 0; i < MAX_OBSTACLES; ++i) {
+            Obstacle *o = &c->sim.obstacles[i];
+            if (!o->active && kind != KERNEL_INTERSECT) continue;
+            float *ofields[] = { &o->x, &o->y, &o->w, &o->h, &o->speed };
+            for (size_t f = 0; f < sizeof(ofields) / sizeof(ofields[0]); ++f) {
+                changed |= verify_simplify(c, ofields[f], variant, kind);
+            }
+        }
+    }
+}
+
+static void verify_record(VerifyRun *run, const VerifyCase *c, long index,
+                          int variant, KernelKind kind) {
+    int first = SDL_AtomicAdd(&run->mismatches[variant][kind], 1) == 0;
+    if (!first) {
+        return;
+    }
+
+    VerifyCase repro = *c;
+    verify_minimize(&repro, variant, kind);
+
+    SDL_AtomicLock(&run->reportLock);
+    if (run->reportCount < VERIFY_MAX_REPORTS) {
+        VerifyReport *r = &run->reports[run->reportCount++];
+        r->variant = variant;
+        r->kind    = kind;
+        r->index   = index;
+        r->repro   = repro;
+    }
+    SDL_AtomicUnlock(&run->reportLock);
+}
+
+/* Job: cases [begin, end) */
+static void verify_cases(void *data, int begin, int end) {
+    VerifyRun *run = (VerifyRun *)data;
+    VerifyCase c;
+
+    for (long i = begin; i < end; ++i) {
+        verify_generate(&c, run->seed, i);
+        for (int v = 1; v < KERNEL_VARIANT_COUNT; ++v) {
+            for (int k = 0; k < KERNEL_COUNT; ++k) {
+                if (verify_kernel(&c, v, (KernelKind)k)) {
+                    verify_record(run, &c, i, v, (KernelKind)k);
+                }
+            }
+        }
+    }
+}
+
+static void verify_print_report(const VerifyRun *run, const VerifyReport *r) {
+    const Player *p = &r->repro.sim.player;
+
+    LOG_ERROR("Mismatch: %s %s vs scalar (case %ld, seed 0x%llx)",
+              KERNEL_VARIANTS[r->variant].name, KERNEL_NAMES[r->kind],
+              r->index, (unsigned long long)run->seed);
+    LOG_ERROR("  minimized repro: player x=%.9g y=%.9g w=%.9g h=%.9g dt=%.9g",
+              p->x, p->y, p->w, p->h, r->repro.dt);
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        const Obstacle *o = &r->repro.sim.obstacles[i];
+        if (!o->active && r->kind != KERNEL_INTERSECT) continue;
+        if (r->kind == KERNEL_INTERSECT &&
+            !rects_intersect(p->x, p->y, p->w, p->h, o->x, o->y, o->w, o->h) ==
+            !KERNEL_VARIANTS[r->variant].intersect(p->x, p->y, p->w, p->h,
+                                                    o->x, o->y, o->w, o->h)) {
+            continue;
+        }
+        LOG_ERROR("  obstacle[%d] x=%.9g y=%.9g w=%.9g h=%.9g speed=%.9g",
+                  i, o->x, o->y, o->w, o->h, o->speed);
+    }
+}
+
+static int run_kernel_verification(long cases, Uint64 seed) {
+    static VerifyRun run;
+
+    if (cases <= 0 || cases > 0x7FFFFFFFL) {
+        LOG_ERROR("Invalid case count: %ld", cases);
+        return EXIT_FAILURE;
+    }
+
+    memset(&run, 0, sizeof(run));
+    run.cases = cases;
+    run.seed  = seed;
+
+    LOG_INFO("Verifying %d kernel variants on %ld cases (seed 0x%llx, %d threads)",
+             KERNEL_VARIANT_COUNT - 1, cases, (unsigned long long)seed,
+             jobs_thread_count());
+
+    Uint32 startTicks = SDL_GetTicks();
+    jobs_parallel_for(0, (int)cases, (int)VERIFY_BATCH, verify_cases, &run);
+
+    long total = 0;
+    for (int v = 1; v < KERNEL_VARIANT_COUNT; ++v) {
+        for (int k = 0; k < KERNEL_COUNT; ++k) {
+            int n = SDL_AtomicGet(&run.mismatches[v][k]);
+            if (n > 0) {
+                LOG_ERROR("%s %s: %d mismatching cases",
+                          KERNEL_VARIANTS[v].name, KERNEL_NAMES[k], n);
+            }
+            total += n;
+        }
+    }
+    for (int i = 0; i < run.reportCount; ++i) {
+        verify_print_report(&run, &run.reports[i]);
+    }
+
+    LOG_INFO("Verification finished in %u ms: %ld mismatches",
+             (unsigned)(SDL_GetTicks() - startTicks), total);
+    return total == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* ----------------------------- Agent Protocol ---------------------------- */
+
+/*
+ * `--agent [socket]` serves a batch of headless sims to an agent process over
+ * stdin/stdout, or over a Unix socket when a path is given. Every message is
+ * an AgentHeader followed by `payloadBytes` of payload, in host byte order;
+ * agents check the magic in HELLO to catch a mismatch. One STEP carries an
+ * action for every instance and one reply carries all of their outputs, so a
+ * round trip is shared by the whole batch. Layouts are listed in README.MD.
+ */
+
+#define AGENT_MAGIC        0x47414445u  /* "EDAG" */
+#define AGENT_VERSION      1
+#define AGENT_MAX_ENVS     65536
+#define AGENT_MAX_PAYLOAD  (AGENT_MAX_ENVS * 4)
+#define AGENT_STEP_GRAIN   256  /* instances per step job */
+
+#define AGENT_FLAG_SHM        1  /* OBS: outputs are in shared memory */
+#define AGENT_FLAG_DONE_ONLY  2  /* RESET: restart finished instances only */
+
+typedef enum {
+    AGENT_MSG_HELLO = 1,  /* server: u32 version, u32 obs floats, u32 step us */
+    AGENT_MSG_RESET,      /* agent: count x u32 seed; sets the batch size */
+    AGENT_MSG_STEP,       /* agent: count x s8 action (-1 left, 0, 1 right) */
+    AGENT_MSG_SHM,        /* agent: shm object name, empty to detach */
+    AGENT_MSG_CLOSE,      /* agent: end of session */
+    AGENT_MSG_OBS,        /* server: count x obs, count x f32 reward, count x u8 done */
+    AGENT_MSG_ERROR       /* server: message text */
+} AgentMessage;
+
+typedef struct {
+    Uint32 magic;
+    Uint16 type;
+    Uint16 flags;
+    Uint32 count;
+    Uint32 payloadBytes;
+} AgentHeader;
+
+typedef struct AgentSession AgentSession;
+
+struct AgentSession {
+    int           in;
+    int           out;
+    SimBatch      batch;
+    void         *shm;        /* agent's output region, or NULL */
+    size_t        shmBytes;
+    unsigned long steps;
+
+    const Sint8  *actions;    /* STEP payload, for the step jobs */
+
+    Uint8         payload[AGENT_MAX_PAYLOAD];
+};
+
+static int agent_read(int fd, void *data, size_t len) {
+    Uint8 *p = (Uint8 *)data;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static int agent_write(int fd, const void *data, size_t len) {
+    const Uint8 *p = (const Uint8 *)data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static int agent_send(AgentSession *s, Uint16 type, Uint16 flags, Uint32 count,
+                      const void *payload, Uint32 bytes) {
+    AgentHeader h;
+    h.magic = AGENT_MAGIC;
+    h.type  = type;
+    h.flags = flags;
+    h.count = count;
+    h.payloadBytes = bytes;
+    return agent_write(s->out, &h, sizeof(h)) &&
+           agent_write(s->out, payload, bytes);
+}
+
+/* Report a rejected request; the session carries on */
+static int agent_error(AgentSession *s, const char *message) {
+    LOG_ERROR("Agent request rejected: %s", message);
+    return agent_send(s, AGENT_MSG_ERROR, 0, 0, message,
+                      (Uint32)strlen(message));
+}
+
+/* Send the batch's outputs, inline or as a notice that shm is up to date */
+static int agent_send_outputs(AgentSession *s) {
+    Uint32 count = (Uint32)s->batch.count;
+    if (s->shm) {
+        return agent_send(s, AGENT_MSG_OBS, AGENT_FLAG_SHM, count, NULL, 0);
+    }
+    return agent_send(s, AGENT_MSG_OBS, 0, count, s->batch.obs,
+                      (Uint32)sim_batch_output_bytes(s->batch.count));
+}
+
+/* Job: step instances [begin, end) */
+static void agent_step_range(void *data, int begin, int end) {
+    AgentSession *s = (AgentSession *)data;
+    sim_batch_step_range(&s->batch, s->actions, begin, end);
+}
+
+static void agent_detach_shm(AgentSession *s) {
+    if (!s->shm) {
+        return;
+    }
+    sim_batch_bind_output(&s->batch, NULL);
+    munmap(s->shm, s->shmBytes);
+    s->shm = NULL;
+    s->shmBytes = 0;
+}
+
+/* Bind the batch outputs to the shm region, if it is large enough */
+static int agent_bind_shm(AgentSession *s) {
+    if (!s->shm) {
+        return 1;
+    }
+    if (s->shmBytes < sim_batch_output_bytes(s->batch.count)) {
+        agent_detach_shm(s);
+        return 0;
+    }
+    sim_batch_bind_output(&s->batch, s->shm);
+    return 1;
+}
+
+static int agent_handle_shm(AgentSession *s, const AgentHeader *h) {
+    char name[256];
+
+    agent_detach_shm(s);
+    if (h->payloadBytes == 0) {
+        return agent_send_outputs(s);
+    }
+    if (h->payloadBytes >= sizeof(name)) {
+        return agent_error(s, "shm name too long");
+    }
+    memcpy(name, s->payload, h->payloadBytes);
+    name[h->payloadBytes] = '\0';
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return agent_error(s, "shm_open failed");
+    }
+    struct stat st;
+    void *region = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        region = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (region == MAP_FAILED) {
+        return agent_error(s, "shm region could not be mapped");
+    }
+
+    s->shm = region;
+    s->shmBytes = (size_t)st.st_size;
+    if (!agent_bind_shm(s)) {
+        return agent_error(s, "shm region too small for the batch");
+    }
+    return agent_send_outputs(s);
+}
+
+static int agent_handle_reset(AgentSession *s, const AgentHeader *h) {
+    const Uint32 *seeds = (const Uint32 *)(const void *)s->payload;
+
+    if (h->count == 0 || h->count > AGENT_MAX_ENVS ||
+        h->payloadBytes != h->count * sizeof(Uint32)) {
+        return agent_error(s, "RESET needs 1..65536 seeds");
+    }
+
+    if (h->flags & AGENT_FLAG_DONE_ONLY) {
+        if ((int)h->count != s->batch.count) {
+            return agent_error(s, "RESET count does not match the batch");
+        }
+        for (int i = 0; i < s->batch.count; ++i) {
+            if (s->batch.dones[i]) {
+                sim_batch_reset_range(&s->batch, seeds, i, i + 1);
+            }
+        }
+        return agent_send_outputs(s);
+    }
+
+    if ((int)h->count != s->batch.count) {
+        sim_batch_free(&s->batch);
+        if (!sim_batch_init(&s->batch, (int)h->count)) {
+            return agent_error(s, "out of memory");
+        }
+        if (!agent_bind_shm(s)) {
+            /* The batch is still reset, so a later STEP is well defined */
+            sim_batch_reset(&s->batch, seeds);
+            return agent_error(s, "shm region too small for the batch; detached");
+        }
+    }
+    sim_batch_reset(&s->batch, seeds);
+    return agent_send_outputs(s);
+}
+
+static int agent_handle_step(AgentSession *s, const AgentHeader *h) {
+    if (s->batch.count == 0) {
+        return agent_error(s, "STEP before RESET");
+    }
+    if ((int)h->count != s->batch.count || h->payloadBytes != h->count) {
+        return agent_error(s, "STEP count does not match the batch");
+    }
+
+    s->actions = (const Sint8 *)s->payload;
+    jobs_parallel_for(0, s->batch.count, AGENT_STEP_GRAIN, agent_step_range, s);
+    ++s->steps;
+
+    return agent_send_outputs(s);
+}
+
+/* Returns 0 if the stream broke or was malformed */
+static int agent_serve(AgentSession *s) {
+    const Uint32 hello[3] = { AGENT_VERSION, SIM_OBS_FLOATS, SIM_ENV_STEP_US };
+    if (!agent_send(s, AGENT_MSG_HELLO, 0, 0, hello, sizeof(hello))) {
+        return 0;
+    }
+
+    for (;;) {
+        AgentHeader h;
+        if (!agent_read(s->in, &h, sizeof(h))) {
+            return 1;  /* agent went away between messages */
+        }
+        if (h.magic != AGENT_MAGIC || h.payloadBytes > AGENT_MAX_PAYLOAD) {
+            LOG_ERROR("Malformed agent message header");
+            return 0;
+        }
+        if (!agent_read(s->in, s->payload, h.payloadBytes)) {
+            return 0;
+        }
+
+        int ok;
+        switch (h.type) {
+            case AGENT_MSG_RESET: ok = agent_handle_reset(s, &h); break;
+            case AGENT_MSG_STEP:  ok = agent_handle_step(s, &h);  break;
+            case AGENT_MSG_SHM:   ok = agent_handle_shm(s, &h);   break;
+            case AGENT_MSG_CLOSE: return 1;
+            default:              ok = agent_error(s, "unknown message type"); break;
+        }
+        if (!ok) {
+            return 0;
+        }
+    }
+}
+
+/* Accept a single agent connection on a Unix socket at `path` */
+static int agent_accept(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        LOG_ERROR("Agent socket path too long: %s", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        LOG_ERROR("socket failed: %s", strerror(errno));
+        return -1;
+    }
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(fd, 1) != 0) {
+        LOG_ERROR("Cannot listen on %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    LOG_INFO("Waiting for an agent on %s", path);
+    int client = accept(fd, NULL, NULL);
+    if (client < 0) {
+        LOG_ERROR("accept failed: %s", strerror(errno));
+    }
+    close(fd);
+    unlink(path);
+    return client;
+}
+
+static int run_agent_server(const char *socketPath) {
+    static AgentSession session;
+    AgentSession *s = &session;
+
+    memset(s, 0, sizeof(*s));
+    signal(SIGPIPE, SIG_IGN);
+
+    if (socketPath) {
+        s->in = s->out = agent_accept(socketPath);
+        if (s->in < 0) {
+            return EXIT_FAILURE;
+        }
+    } else {
+        /* stdout carries the protocol; keep log output off it */
+        s->in  = STDIN_FILENO;
+        s->out = dup(STDOUT_FILENO);
+        if (s->out < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+            LOG_ERROR("Cannot set up stdio for the agent: %s", strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+
+    Uint32 startTicks = SDL_GetTicks();
+    int ok = agent_serve(s);
+
+    LOG_INFO("Agent session ended: %lu batch steps of %d sims in %u ms",
+             s->steps, s->batch.count,
+             (unsigned)(SDL_GetTicks() - startTicks));
+
+    agent_detach_shm(s);
+    sim_batch_free(&s->batch);
+    close(s->out);
+    if (!socketPath) {
+        close(s->in);  /* with a socket, in and out are the same fd */
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* ---------------------------- Bot Tournament ----------------------------- */
+
+/*
+ * `--tournament`: every bot plays the same seeds, one run per (bot, seed) on
+ * all cores, and is ranked by mean score. Because the seeds are shared, each
+ * bot is also compared with the leader seed by seed, which gives a much
+ * tighter interval than comparing the two means.
+ *
+ * Entrants are plugins (see bot.h) or MLP policy files (see mlp.h). A policy
+ * plays its seeds in chunks of TOURNAMENT_POLICY_CHUNK runs stepped as one
+ * SimBatch: each step is one forward pass over the batch's packed
+ * observations, so the network reads them where the sims wrote them.
+ */
+
+#define TOURNAMENT_DEFAULT_SEEDS  1000
+#define TOURNAMENT_MAX_BOTS       64
+#define TOURNAMENT_MAX_RUN_US     (300ull * 1000000)  /* runs end here if alive */
+#define TOURNAMENT_Z95            1.96
+#define TOURNAMENT_POLICY_CHUNK   512
+#define TOURNAMENT_POLICY_OUTPUTS 3     /* scores for left, stay, right */
+
+typedef struct {
+    const char     *path;
+    const char     *name;
+    void           *handle;
+    const DodgeBot *bot;       /* NULL for a policy */
+    Mlp             policy;
+    int             seedCount;
+    int             jobs;      /* runs for a plugin, chunks for a policy */
+    JobCounter      played;    /* its runs still going */
+    Sint32         *scores;    /* per seed */
+    float          *survived;  /* seconds, per seed */
+    double          mean;
+    double          ci;        /* 95% half-width */
+    double          meanSurvived;
+} TournamentEntry;
+
+typedef struct {
+    int              botCount;
+    int              seedCount;
+    TournamentEntry  entries[TOURNAMENT_MAX_BOTS];
+} Tournament;
+
+static int tournament_load_policy(TournamentEntry *e, const char *path) {
+    const char *error = mlp_load(&e->policy, path);
+    if (error) {
+        LOG_ERROR("Cannot load policy %s: %s", path, error);
+        return 0;
+    }
+    const MlpLayer *first = &e->policy.layers[0];
+    const MlpLayer *last  = &e->policy.layers[e->policy.layerCount - 1];
+    if (first->inputs != SIM_OBS_FLOATS ||
+        last->outputs != TOURNAMENT_POLICY_OUTPUTS) {
+        LOG_ERROR("Policy %s maps %d inputs to %d outputs; needs %d to %d",
+                  path, first->inputs, last->outputs, SIM_OBS_FLOATS,
+                  TOURNAMENT_POLICY_OUTPUTS);
+        return 0;
+    }
+    const char *base = strrchr(path, '/');
+    e->name = base ? base + 1 : path;
+    return 1;
+}
+
+static int tournament_load(TournamentEntry *e, const char *path) {
+    e->path = path;
+    if (mlp_probe(path)) {
+        return tournament_load_policy(e, path);
+    }
+
+    e->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!e->handle) {
+        LOG_ERROR("Cannot load bot %s: %s", path, dlerror());
+        return 0;
+    }
+
+    DodgeBotEntry entry;
+    *(void **)&entry = dlsym(e->handle, DODGE_BOT_ENTRY);
+    e->bot = entry ? entry() : NULL;
+    if (!e->bot) {
+        LOG_ERROR("Bot %s does not export %s", path, DODGE_BOT_ENTRY);
+        return 0;
+    }
+    if (e->bot->abiVersion != DODGE_BOT_ABI_VERSION || !e->bot->move) {
+        LOG_ERROR("Bot %s has ABI version %u; this game needs %u",
+                  path, (unsigned)e->bot->abiVersion,
+                  (unsigned)DODGE_BOT_ABI_VERSION);
+        return 0;
+    }
+    if (!e->bot->name) {
+        LOG_ERROR("Bot %s has no name", path);
+        return 0;
+    }
+    e->name = e->bot->name;
+    return 1;
+}
+
+/* A plugin's view of a sim, with the obstacle arrays it points into */
+typedef struct {
+    DodgeBotObservation obs;
+    float x[MAX_OBSTACLES];
+    float y[MAX_OBSTACLES];
+    float w[MAX_OBSTACLES];
+    float h[MAX_OBSTACLES];
+    float speed[MAX_OBSTACLES];
+} BotView;
+
+static void bot_view_init(BotView *v) {
+    memset(&v->obs, 0, sizeof(v->obs));
+    v->obs.size          = (Uint32)sizeof(v->obs);
+    v->obs.fieldWidth    = (float)WINDOW_WIDTH;
+    v->obs.fieldHeight   = (float)WINDOW_HEIGHT;
+    v->obs.obstacleX     = v->x;
+    v->obs.obstacleY     = v->y;
+    v->obs.obstacleW     = v->w;
+    v->obs.obstacleH     = v->h;
+    v->obs.obstacleSpeed = v->speed;
+}
+
+/* Ask `bot` for its move on `sim`'s current state, as a direction */
+static float bot_view_move(BotView *v, const DodgeBot *bot, void *state,
+                           const Sim *sim) {
+    Uint32 n = 0;
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        const Obstacle *o = &sim->obstacles[i];
+        if (!o->active) continue;
+        v->x[n] = o->x;
+        v->y[n] = o->y;
+        v->w[n] = o->w;
+        v->h[n] = o->h;
+        v->speed[n] = o->speed;
+        ++n;
+    }
+    v->obs.obstacleCount = n;
+    v->obs.elapsed       = (float)((double)sim->simTimeUs / 1000000.0);
+    v->obs.playerX       = sim->player.x;
+    v->obs.playerY       = sim->player.y;
+    v->obs.playerW       = sim->player.w;
+    v->obs.playerH       = sim->player.h;
+    v->obs.playerSpeed   = sim->player.speed;
+
+    int move = bot->move(state, &v->obs);
+    return move < 0 ? -1.0f : (move > 0 ? 1.0f : 0.0f);
+}
+
+/* A policy's move from its left, stay and right scores */
+static int policy_action(const float *scores) {
+    int best = scores[1] >= scores[0] ? 1 : 0;
+    if (scores[2] > scores[best]) best = 2;
+    return best - 1;
+}
+
+/* Play one run to its end, or to TOURNAMENT_MAX_RUN_US */
+static void tournament_play(const DodgeBot *bot, Uint32 seed,
+                            Sint32 *score, float *survived) {
+    Sim sim;
+    BotView view;
+
+    memset(&sim, 0, sizeof(sim));
+    sim_reset(&sim, seed);
+    bot_view_init(&view);
+
+    void *state = bot->create ? bot->create(seed) : NULL;
+    int dead = 0;
+    while (!dead && sim.simTimeUs < TOURNAMENT_MAX_RUN_US) {
+        dead = sim_advance(&sim, SIM_ENV_STEP_US,
+                           bot_view_move(&view, bot, state, &sim));
+    }
+    if (bot->destroy) {
+        bot->destroy(state);
+    }
+
+    *score    = sim.score;
+    *survived = (float)((double)sim.simTimeUs / 1e6);
+}
+
+/*
+ * Play one run per seed with `policy`, stepped together as one SimBatch;
+ * runs still alive after `maxUs` of sim time end there. Finished runs are
+ * swapped behind the live ones, so each step evaluates the network on, and
+ * steps, only the live prefix of the batch. Returns 0 if out of memory.
+ */
+static int policy_play(const Mlp *policy, const Uint32 *seeds, int count,
+                       Uint64 maxUs, Sint32 *scores, float *survived) {
+    SimBatch batch;
+    MlpScratch scratch;
+    int *runOf = (int *)malloc((size_t)count * sizeof(int));
+    Sint8 *actions = (Sint8 *)malloc((size_t)count);
+    int ok = 0;
+
+    memset(&scratch, 0, sizeof(scratch));
+    if (!runOf || !actions || !sim_batch_init(&batch, count)) {
+        free(runOf);
+        free(actions);
+        return 0;
+    }
+    if (!mlp_scratch_init(&scratch, policy, count)) {
+        goto done;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        runOf[i] = i;
+    }
+    sim_batch_reset(&batch, seeds);
+
+    size_t stride = mlp_output_stride(policy);
+    int alive = count;
+    for (Uint64 us = 0; alive > 0 && us < maxUs; us += SIM_ENV_STEP_US) {
+        const float *out = mlp_forward(policy, &scratch, batch.obs,
+                                       SIM_OBS_FLOATS, alive);
+        for (int i = 0; i < alive; ++i) {
+            actions[i] = (Sint8)policy_action(out + (size_t)i * stride);
+        }
+        sim_batch_step_range(&batch, actions, 0, alive);
+
+        for (int i = 0; i < alive;) {
+            if (!batch.dones[i]) {
+                ++i;
+                continue;
+            }
+            scores[runOf[i]]   = batch.sims[i].score;
+            survived[runOf[i]] = (float)((double)batch.sims[i].simTimeUs / 1e6);
+            if (i != --alive) {
+                batch.sims[i]  = batch.sims[alive];
+                batch.dones[i] = 0;
+                runOf[i]       = runOf[alive];
+                memcpy(batch.obs + (size_t)i * SIM_OBS_FLOATS,
+                       batch.obs + (size_t)alive * SIM_OBS_FLOATS,
+                       SIM_OBS_FLOATS * sizeof(float));
+            }
+        }
+    }
+    for (int i = 0; i < alive; ++i) {
+        scores[runOf[i]]   = batch.sims[i].score;
+        survived[runOf[i]] = (float)((double)batch.sims[i].simTimeUs / 1e6);
+    }
+    ok = 1;
+
+done:
+    mlp_scratch_free(&scratch);
+    sim_batch_free(&batch);
+    free(runOf);
+    free(actions);
+    return ok;
+}
+
+/* A policy plays seeds [first, last) as one batch */
+static void tournament_play_policy(TournamentEntry *e, int first, int last) {
+    Uint32 seeds[TOURNAMENT_POLICY_CHUNK];
+    for (int i = first; i < last; ++i) {
+        seeds[i - first] = (Uint32)i + 1;
+    }
+    if (!policy_play(&e->policy, seeds, last - first, TOURNAMENT_MAX_RUN_US,
+                     e->scores + first, e->survived + first)) {
+        LOG_ERROR("Out of memory for a batch of %d runs", last - first);
+    }
+}
+
+/* Job: a plugin plays seeds [begin, end) */
+static void tournament_play_runs(void *data, int begin, int end) {
+    TournamentEntry *e = (TournamentEntry *)data;
+    for (int i = begin; i < end; ++i) {
+        tournament_play(e->bot, (Uint32)i + 1, &e->scores[i], &e->survived[i]);
+    }
+}
+
+/* Job: a policy plays chunks [begin, end) of TOURNAMENT_POLICY_CHUNK seeds */
+static void tournament_play_chunks(void *data, int begin, int end) {
+    TournamentEntry *e = (TournamentEntry *)data;
+    for (int c = begin; c < end; ++c) {
+        int first = c * TOURNAMENT_POLICY_CHUNK;
+        int last = first + TOURNAMENT_POLICY_CHUNK;
+        tournament_play_policy(e, first,
+                               last < e->seedCount ? last : e->seedCount);
+    }
+}
+
+/* Mean and 95% confidence half-width of `n` values */
+static void tournament_stats(const double *values, int n,
+                             double *mean, double *ci) {
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) {
+        sum += values[i];
+    }
+    *mean = sum / n;
+
+    double var = 0.0;
+    for (int i = 0; i < n; ++i) {
+        var += (values[i] - *mean) * (values[i] - *mean);
+    }
+    *ci = n > 1 ? TOURNAMENT_Z95 * sqrt(var / (n - 1) / n) : 0.0;
+}
+
+static int tournament_compare(const void *a, const void *b) {
+    double x = ((const TournamentEntry *)a)->mean;
+    double y = ((const TournamentEntry *)b)->mean;
+    return x > y ? -1 : x < y;
+}
+
+/* Job, once an entry's runs are all in: its score and survival statistics */
+static void tournament_summarize(void *data) {
+    TournamentEntry *e = (TournamentEntry *)data;
+    int n = e->seedCount;
+    double *values = n > 0 ? (double *)malloc((size_t)n * sizeof(double)) : NULL;
+    if (!values) {
+        LOG_ERROR("Out of memory for the results of %s", e->name);
+        return;
+    }
+
+    double ignored;
+    for (int i = 0; i < n; ++i) {
+        values[i] = e->survived[i];
+    }
+    tournament_stats(values, n, &e->meanSurvived, &ignored);
+    for (int i = 0; i < n; ++i) {
+        values[i] = e->scores[i];
+    }
+    tournament_stats(values, n, &e->mean, &e->ci);
+    free(values);
+}
+
+static void tournament_report(Tournament *t, Uint32 elapsedMs) {
+    int n = t->seedCount;
+    double *values = (double *)malloc((size_t)n * sizeof(double));
+    if (!values) {
+        LOG_ERROR("Out of memory for tournament results");
+        return;
+    }
+
+    double simSeconds = 0.0;
+    for (int b = 0; b < t->botCount; ++b) {
+        simSeconds += t->entries[b].meanSurvived * n;
+    }
+    qsort(t->entries, (size_t)t->botCount, sizeof(TournamentEntry),
+          tournament_compare);
+
+    LOG_INFO("%d runs in %u ms (%.0f sim seconds per second)",
+             t->botCount * n, (unsigned)elapsedMs,
+             simSeconds * 1000.0 / (elapsedMs > 0 ? elapsedMs : 1));
+    const TournamentEntry *leader = &t->entries[0];
+    for (int b = 0; b < t->botCount; ++b) {
+        const TournamentEntry *e = &t->entries[b];
+        char versus[64] = "";
+        if (b > 0) {
+            /* Paired difference to the leader over the shared seeds */
+            double diff, diffCi;
+            for (int i = 0; i < n; ++i) {
+                values[i] = (double)e->scores[i] - leader->scores[i];
+            }
+            tournament_stats(values, n, &diff, &diffCi);
+            snprintf(versus, sizeof(versus), "  vs #1: %+.1f +- %.1f%s",
+                     diff, diffCi, diff + diffCi < 0.0 ? "" : " (not separable)");
+        }
+        LOG_REPORT("#%d %-20s %10.1f +- %-8.1f survived %6.1f s%s  (%s)",
+                   b + 1, e->name, e->mean, e->ci, e->meanSurvived,
+                   versus, e->path);
+    }
+    free(values);
+}
+
+static int run_tournament(int seedCount, int botCount, char **paths) {
+    static Tournament t;
+    int status = EXIT_FAILURE;
+
+    if (seedCount <= 0 || botCount <= 0 || botCount > TOURNAMENT_MAX_BOTS ||
+        seedCount > 0x7FFFFFFF / TOURNAMENT_MAX_BOTS) {
+        LOG_ERROR("Usage: --tournament <seeds> <bot.so|policy>... (up to %d)",
+                  TOURNAMENT_MAX_BOTS);
+        return EXIT_FAILURE;
+    }
+
+    memset(&t, 0, sizeof(t));
+    t.seedCount = seedCount;
+    for (int b = 0; b < botCount; ++b) {
+        TournamentEntry *e = &t.entries[t.botCount++];
+        e->scores   = (Sint32 *)calloc((size_t)seedCount, sizeof(Sint32));
+        e->survived = (float *)calloc((size_t)seedCount, sizeof(float));
+        if (!e->scores || !e->survived) {
+            LOG_ERROR("Out of memory for %d seeds", seedCount);
+            goto done;
+        }
+        if (!tournament_load(e, paths[b])) {
+            goto done;
+        }
+        e->seedCount = seedCount;
+        e->jobs = e->bot ? seedCount
+                         : (seedCount + TOURNAMENT_POLICY_CHUNK - 1) /
+                               TOURNAMENT_POLICY_CHUNK;
+    }
+
+    LOG_INFO("Tournament: %d bots x %d seeds on %d threads",
+             botCount, seedCount, jobs_thread_count());
+
+    /* Each entry is summarized as soon as its own runs are in */
+    Uint32 startTicks = SDL_GetTicks();
+    JobCounter summarized;
+    memset(&summarized, 0, sizeof(summarized));
+    for (int b = 0; b < t.botCount; ++b) {
+        TournamentEntry *e = &t.entries[b];
+        jobs_run_range(0, e->jobs, 1,
+                       e->bot ? tournament_play_runs : tournament_play_chunks,
+                       e, &e->played);
+        jobs_run_after(&e->played, tournament_summarize, e, &summarized);
+    }
+    jobs_wait(&summarized);
+
+    tournament_report(&t, SDL_GetTicks() - startTicks);
+    status = EXIT_SUCCESS;
+
+done:
+    for (int b = 0; b < t.botCount; ++b) {
+        TournamentEntry *e = &t.entries[b];
+        free(e->scores);
+        free(e->survived);
+        if (e->handle) {
+            dlclose(e->handle);
+        }
+        mlp_free(&e->policy);
+    }
+    return status;
+}
+
+/* ------------------------------- Training -------------------------------- */
+
+/*
+ * `--train`: neuroevolution of a tournament policy. A simple genetic
+ * algorithm (truncation selection, Gaussian mutation, elitism) evolves the
+ * flat parameter vector of a SIM_OBS_FLOATS -> TRAIN_HIDDEN -> 3 MLP. Every
+ * candidate of a generation plays the same TRAIN_SEEDS seeds (common random
+ * numbers), so differences in fitness come from the weights, not the luck
+ * of the draw; the seeds change every generation to avoid overfitting, and
+ * elites are re-evaluated on them. Candidates are evaluated as jobs.
+ *
+ * Weights are evolved on observations scaled to about [0, 1]; the scaling
+ * is folded into the first layer when a candidate is turned into a network,
+ * so saved policies read raw observations like any other.
+ */
+
+#define TRAIN_HIDDEN         16
+#define TRAIN_POPULATION     64
+#define TRAIN_ELITES         8
+#define TRAIN_SEEDS          48
+#define TRAIN_MAX_RUN_US     (60ull * 1000000)
+#define TRAIN_SIGMA_INIT     0.5f
+#define TRAIN_SIGMA_MUTATE   0.05f
+#define TRAIN_SIGMA_DECAY    0.995f
+#define TRAIN_SIGMA_MIN      0.01f
+#define TRAIN_DEFAULT_GENERATIONS 200
+#define TRAIN_DEFAULT_FILE   "policy.bin"
+#define TRAIN_CHECKPOINT_MAGIC 0x52544445u  /* "EDTR" */
+#define TRAIN_PATH_MAX       1024
+
+static const int TRAIN_WIDTHS[3] = {
+    SIM_OBS_FLOATS, TRAIN_HIDDEN, TOURNAMENT_POLICY_OUTPUTS
+};
+
+typedef struct {
+    int           paramCount;
+    float        *genomes;      /* population x paramCount */
+    float        *fitness;      /* mean score per candidate */
+    Uint32        seeds[TRAIN_SEEDS];
+    float         inputScale[SIM_OBS_FLOATS];
+    SDL_atomic_t  failed;
+} Trainer;
+
+/* splitmix64, as in the kernel harness */
+static Uint64 train_next(Uint64 *state) {
+    Uint64 z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Standard normal sample (Box-Muller) */
+static float train_gauss(Uint64 *state) {
+    double u1 = ((double)(train_next(state) >> 11) + 1.0) / 9007199254740993.0;
+    double u2 = (double)(train_next(state) >> 11) / 9007199254740992.0;
+    return (float)(sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2));
+}
+
+/* Roughly unit ranges for every observation float */
+static void train_init_scale(float *scale) {
+    scale[0] = 1.0f / WINDOW_WIDTH;   /* player x */
+    scale[1] = 1.0f / 60.0f;          /* elapsed seconds */
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        float *s = scale + 2 + 4 * i;
+        s[0] = 1.0f / WINDOW_WIDTH;   /* x */
+        s[1] = 1.0f / WINDOW_HEIGHT;  /* y */
+        s[2] = 1.0f / WINDOW_WIDTH;   /* w */
+        s[3] = 1.0f / 1000.0f;        /* speed */
+    }
+}
+
+/* Flat parameters for raw observations: the input scale folded in */
+static void train_unscale(const Trainer *t, const float *genome, float *params) {
+    memcpy(params, genome, (size_t)t->paramCount * sizeof(float));
+    for (int o = 0; o < TRAIN_HIDDEN; ++o) {
+        float *row = params + (size_t)o * SIM_OBS_FLOATS;
+        for (int k = 0; k < SIM_OBS_FLOATS; ++k) {
+            row[k] *= t->inputScale[k];
+        }
+    }
+}
+
+static void train_set_network(const Trainer *t, Mlp *mlp, const float *genome,
+                              float *params) {
+    train_unscale(t, genome, params);
+    const float *p = params;
+    for (int l = 0; l < 2; ++l) {
+        size_t weights = (size_t)TRAIN_WIDTHS[l] * TRAIN_WIDTHS[l + 1];
+        mlp_set_layer(mlp, l, p, p + weights);
+        p += weights + TRAIN_WIDTHS[l + 1];
+    }
+}
+
+/* Job: evaluate candidates [begin, end) */
+static void train_evaluate_range(void *data, int begin, int end) {
+    Trainer *t = (Trainer *)data;
+    Mlp mlp;
+    Sint32 scores[TRAIN_SEEDS];
+    float survived[TRAIN_SEEDS];
+    float *params = (float *)malloc((size_t)t->paramCount * sizeof(float));
+
+    if (!params || !mlp_init(&mlp, 2, TRAIN_WIDTHS, 0)) {
+        free(params);
+        SDL_AtomicSet(&t->failed, 1);
+        return;
+    }
+
+    for (int c = begin; c < end; ++c) {
+        train_set_network(t, &mlp, t->genomes + (size_t)c * t->paramCount,
+                          params);
+        if (!policy_play(&mlp, t->seeds, TRAIN_SEEDS, TRAIN_MAX_RUN_US,
+                         scores, survived)) {
+            SDL_AtomicSet(&t->failed, 1);
+            break;
+        }
+        double sum = 0.0;
+        for (int i = 0; i < TRAIN_SEEDS; ++i) {
+            sum += scores[i];
+        }
+        t->fitness[c] = (float)(sum / TRAIN_SEEDS);
+    }
+
+    mlp_free(&mlp);
+    free(params);
+}
+
+/* Evaluate the whole population, one job per candidate */
+static int train_evaluate(Trainer *t) {
+    jobs_parallel_for(0, TRAIN_POPULATION, 1, train_evaluate_range, t);
+    return !SDL_AtomicGet(&t->failed);
+}
+
+/*
+ * Checkpoint: u32 magic, u32 generation, u32 population, u32 params,
+ * f32 sigma, u64 rng state, then the population to evaluate next. Written
+ * to a temporary file and renamed, so a crash keeps the previous one.
+ */
+static int train_save_checkpoint(const char *path, const Trainer *t,
+                                 Uint32 generation, float sigma, Uint64 rng) {
+    char tmp[TRAIN_PATH_MAX + 8];
+    Uint32 header[4] = { TRAIN_CHECKPOINT_MAGIC, generation, TRAIN_POPULATION,
+                         (Uint32)t->paramCount };
+    size_t count = (size_t)TRAIN_POPULATION * t->paramCount;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        return 0;
+    }
+    int ok = fwrite(header, sizeof(header), 1, f) == 1 &&
+             fwrite(&sigma, sizeof(sigma), 1, f) == 1 &&
+             fwrite(&rng, sizeof(rng), 1, f) == 1 &&
+             fwrite(t->genomes, sizeof(float), count, f) == count &&
+             fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = fclose(f) == 0 && ok;
+    return ok && rename(tmp, path) == 0;
+}
+
+static int train_load_checkpoint(const char *path, Trainer *t,
+                                 Uint32 *generation, float *sigma, Uint64 *rng) {
+    Uint32 header[4];
+    size_t count = (size_t)TRAIN_POPULATION * t->paramCount;
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return 0;
+    }
+    int ok = fread(header, sizeof(header), 1, f) == 1 &&
+             header[0] == TRAIN_CHECKPOINT_MAGIC &&
+             header[2] == TRAIN_POPULATION &&
+             header[3] == (Uint32)t->paramCount &&
+             fread(sigma, sizeof(*sigma), 1, f) == 1 &&
+             fread(rng, sizeof(*rng), 1, f) == 1 &&
+             fread(t->genomes, sizeof(float), count, f) == count;
+    fclose(f);
+    if (!ok) {
+        LOG_ERROR("Ignoring checkpoint %s: not from this trainer", path);
+        return 0;
+    }
+    *generation = header[1];
+    return 1;
+}
+
+static const float *train_sort_fitness;  /* for train_compare() */
+
+static int train_compare(const void *a, const void *b) {
+    float x = train_sort_fitness[*(const int *)a];
+    float y = train_sort_fitness[*(const int *)b];
+    return x > y ? -1 : x < y;
+}
+
+static int run_training(int generations, const char *policyPath) {
+    static Trainer t;
+    char checkpointPath[TRAIN_PATH_MAX];
+    int order[TRAIN_POPULATION];
+    int status = EXIT_FAILURE;
+
+    if (generations <= 0) {
+        LOG_ERROR("Usage: --train [generations] [policy file]");
+        return EXIT_FAILURE;
+    }
+    if (strlen(policyPath) + sizeof(".ckpt") > sizeof(checkpointPath)) {
+        LOG_ERROR("Policy path too long: %s", policyPath);
+        return EXIT_FAILURE;
+    }
+
+    memset(&t, 0, sizeof(t));
+    t.paramCount = (int)mlp_param_count(2, TRAIN_WIDTHS);
+    t.genomes = (float *)malloc((size_t)TRAIN_POPULATION * t.paramCount *
+                                sizeof(float));
+    t.fitness = (float *)calloc(TRAIN_POPULATION, sizeof(float));
+    float *next = (float *)malloc((size_t)TRAIN_POPULATION * t.paramCount *
+                                  sizeof(float));
+    float *params = (float *)malloc((size_t)t.paramCount * sizeof(float));
+    if (!t.genomes || !t.fitness || !next || !params) {
+        LOG_ERROR("Out of memory for the population");
+        goto done;
+    }
+    train_init_scale(t.inputScale);
+
+    snprintf(checkpointPath, sizeof(checkpointPath), "%s.ckpt", policyPath);
+    Uint32 generation = 0;
+    float sigma = TRAIN_SIGMA_MUTATE;
+    Uint64 rng = (Uint64)time(NULL);
+    if (train_load_checkpoint(checkpointPath, &t, &generation, &sigma, &rng)) {
+        LOG_INFO("Resuming from %s at generation %u", checkpointPath,
+                 (unsigned)generation);
+    } else {
+        for (size_t i = 0; i < (size_t)TRAIN_POPULATION * t.paramCount; ++i) {
+            t.genomes[i] = TRAIN_SIGMA_INIT * train_gauss(&rng) /
+                           sqrtf((float)SIM_OBS_FLOATS / TRAIN_HIDDEN);
+        }
+    }
+
+    LOG_INFO("Training %d candidates x %d seeds, %d parameters each",
+             TRAIN_POPULATION, TRAIN_SEEDS, t.paramCount);
+
+    for (; generation < (Uint32)generations; ++generation) {
+        Uint32 startTicks = SDL_GetTicks();
+
+        /* Common random numbers: one seed set per generation */
+        Uint64 seedState = 0xD0D6E5EEDULL + generation;
+        for (int i = 0; i < TRAIN_SEEDS; ++i) {
+            t.seeds[i] = (Uint32)train_next(&seedState) | 1u;
+        }
+        if (!train_evaluate(&t)) {
+            LOG_ERROR("Out of memory evaluating generation %u",
+                      (unsigned)generation);
+            goto done;
+        }
+
+        for (int i = 0; i < TRAIN_POPULATION; ++i) {
+            order[i] = i;
+        }
+        train_sort_fitness = t.fitness;
+        qsort(order, TRAIN_POPULATION, sizeof(int), train_compare);
+
+        double eliteMean = 0.0;
+        for (int i = 0; i < TRAIN_ELITES; ++i) {
+            eliteMean += t.fitness[order[i]];
+        }
+        LOG_REPORT("Generation %u: best %.1f, elite mean %.1f, sigma %.4f (%u ms)",
+                   (unsigned)generation, t.fitness[order[0]],
+                   eliteMean / TRAIN_ELITES, sigma,
+                   (unsigned)(SDL_GetTicks() - startTicks));
+
+        /* The generation's best, as a policy any tournament can load */
+        train_unscale(&t, t.genomes + (size_t)order[0] * t.paramCount, params);
+        if (!mlp_save(policyPath, 2, TRAIN_WIDTHS, 0, params)) {
+            LOG_ERROR("Failed to write %s", policyPath);
+        }
+
+        /* Elites survive unchanged; the rest are mutated copies of them */
+        for (int c = 0; c < TRAIN_POPULATION; ++c) {
+            const float *parent = t.genomes +
+                (size_t)order[c % TRAIN_ELITES] * t.paramCount;
+            float *child = next + (size_t)c * t.paramCount;
+            memcpy(child, parent, (size_t)t.paramCount * sizeof(float));
+            if (c >= TRAIN_ELITES) {
+                for (int i = 0; i < t.paramCount; ++i) {
+                    child[i] += sigma * train_gauss(&rng);
+                }
+            }
+        }
+        float *swap = t.genomes;
+        t.genomes = next;
+        next = swap;
+
+        sigma *= TRAIN_SIGMA_DECAY;
+        if (sigma < TRAIN_SIGMA_MIN) sigma = TRAIN_SIGMA_MIN;
+        if (!train_save_checkpoint(checkpointPath, &t, generation + 1, sigma, rng)) {
+            LOG_ERROR("Failed to write checkpoint %s", checkpointPath);
+        }
+    }
+
+    LOG_INFO("Training finished; best policy in %s", policyPath);
+    status = EXIT_SUCCESS;
+
+done:
+    free(t.genomes);
+    free(t.fitness);
+    free(next);
+    free(params);
+    return status;
+}
+
+/* -------------------------- Telemetry Analysis --------------------------- */
+
+/*
+ * `--analyze <prefix> <log>...`: fold any number of telemetry logs into a
+ * death heatmap and CSV summaries. Each log is mapped read-only and parsed
+ * in place as a job; every job thread adds into its own partial histograms,
+ * so the map phase shares nothing, and the partials are summed at the end.
+ * Truncated tails (a run cut off by a crash mid-write) are skipped.
+ */
+
+#define ANALYZE_X_BINS       80     /* 10 px columns of the field */
+#define ANALYZE_TIME_BIN_S   2
+#define ANALYZE_TIME_BINS    90     /* 3 minutes; later deaths share the last */
+#define ANALYZE_MAX_SECONDS  600    /* curves and death times; later ones pool */
+#define ANALYZE_CELL_W       8      /* heatmap pixels per bin */
+#define ANALYZE_CELL_H       4
+
+typedef struct {
+    Uint64 files;
+    Uint64 badFiles;
+    Uint64 truncated;    /* logs with a partial record at the end */
+    Uint64 bytes;
+    Uint64 runs;
+    Uint32 heat[ANALYZE_TIME_BINS][ANALYZE_X_BINS];
+    Uint64 deaths[ANALYZE_MAX_SECONDS + 1];      /* by whole second */
+    Uint64 obstacleSum[ANALYZE_MAX_SECONDS + 1]; /* on screen at those deaths */
+    Uint64 byObstacles[MAX_OBSTACLES + 1];
+    Uint64 curveRuns[ANALYZE_MAX_SECONDS];
+    double curveSum[ANALYZE_MAX_SECONDS];
+    double curveSumSq[ANALYZE_MAX_SECONDS];
+} AnalyzePartial;
+
+typedef struct {
+    char           **paths;
+    int              partialCount;
+    AnalyzePartial **partials;   /* one per job thread */
+} Analysis;
+
+static void analyze_record(AnalyzePartial *p, const TelemetryRecord *r,
+                           const Uint32 *curve) {
+    Uint32 second = r->durationMs / 1000;
+    Uint32 at = second < ANALYZE_MAX_SECONDS ? second : ANALYZE_MAX_SECONDS;
+    Uint32 row = second / ANALYZE_TIME_BIN_S;
+    if (row >= ANALYZE_TIME_BINS) row = ANALYZE_TIME_BINS - 1;
+
+    /* Bin by the centre of the paddle */
+    float centre = r->deathX + PLAYER_WIDTH * 0.5f;
+    int column = (int)(centre * ANALYZE_X_BINS / WINDOW_WIDTH);
+    if (!(column >= 0)) column = 0;
+    if (column >= ANALYZE_X_BINS) column = ANALYZE_X_BINS - 1;
+
+    ++p->runs;
+    ++p->heat[row][column];
+    ++p->deaths[at];
+    p->obstacleSum[at] += r->obstacles;
+    ++p->byObstacles[r->obstacles < MAX_OBSTACLES ? r->obstacles : MAX_OBSTACLES];
+
+    for (int i = 0; i < r->curveCount; ++i) {
+        int s = r->curveStart + i;
+        if (s >= ANALYZE_MAX_SECONDS) break;
+        double score = curve[i];
+        ++p->curveRuns[s];
+        p->curveSum[s]   += score;
+        p->curveSumSq[s] += score * score;
+    }
+}
+
+static void analyze_file(AnalyzePartial *p, const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < 8) {
+        LOG_WARN("Skipping %s: cannot read it or too short", path);
+        ++p->badFiles;
+        if (fd >= 0) close(fd);
+        return;
+    }
+    size_t size = (size_t)st.st_size;
+    const Uint8 *map = (const Uint8 *)mmap(NULL, size, PROT_READ, MAP_PRIVATE,
+                                           fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOG_WARN("Skipping %s: mmap failed: %s", path, strerror(errno));
+        ++p->badFiles;
+        return;
+    }
+    madvise((void *)map, size, MADV_SEQUENTIAL);
+
+    Uint32 header[2];
+    memcpy(header, map, sizeof(header));
+    if (header[0] != TELEMETRY_MAGIC || header[1] != TELEMETRY_VERSION) {
+        LOG_WARN("Skipping %s: not a version %d telemetry log", path,
+                 TELEMETRY_VERSION);
+        ++p->badFiles;
+        munmap((void *)map, size);
+        return;
+    }
+
+    /* Records are whole words, so curves stay 4-byte aligned in the map */
+    size_t pos = sizeof(header);
+    while (pos + sizeof(TelemetryRecord) <= size) {
+        TelemetryRecord r;
+        memcpy(&r, map + pos, sizeof(r));
+        if (r.bytes != sizeof(r) + (size_t)r.curveCount * sizeof(Uint32) ||
+            r.bytes > size - pos) {
+            break;
+        }
+        analyze_record(p, &r, (const Uint32 *)(map + pos + sizeof(r)));
+        pos += r.bytes;
+    }
+    if (pos != size) {
+        ++p->truncated;
+    }
+    ++p->files;
+    p->bytes += size;
+    munmap((void *)map, size);
+}
+
+/*
+ * Job: logs [begin, end). Only the pool and the thread that called
+ * jobs_init() run jobs here, so the thread index picks a partial no other
+ * thread touches.
+ */
+static void analyze_files(void *data, int begin, int end) {
+    Analysis *a = (Analysis *)data;
+    int thread = jobs_thread_index();
+    AnalyzePartial *p = a->partials[thread > 0 ? thread : 0];
+    for (int i = begin; i < end; ++i) {
+        analyze_file(p, a->paths[i]);
+    }
+}
+
+static void analyze_reduce(AnalyzePartial *total, const AnalyzePartial *p) {
+    total->files     += p->files;
+    total->badFiles  += p->badFiles;
+    total->truncated += p->truncated;
+    total->bytes     += p->bytes;
+    total->runs      += p->runs;
+    for (int row = 0; row < ANALYZE_TIME_BINS; ++row) {
+        for (int column = 0; column < ANALYZE_X_BINS; ++column) {
+            total->heat[row][column] += p->heat[row][column];
+        }
+    }
+    for (int s = 0; s <= ANALYZE_MAX_SECONDS; ++s) {
+        total->deaths[s]      += p->deaths[s];
+        total->obstacleSum[s] += p->obstacleSum[s];
+    }
+    for (int n = 0; n <= MAX_OBSTACLES; ++n) {
+        total->byObstacles[n] += p->byObstacles[n];
+    }
+    for (int s = 0; s < ANALYZE_MAX_SECONDS; ++s) {
+        total->curveRuns[s]  += p->curveRuns[s];
+        total->curveSum[s]   += p->curveSum[s];
+        total->curveSumSq[s] += p->curveSumSq[s];
+    }
+}
+
+static FILE *analyze_open(const char *prefix, const char *name, char *path,
+                          size_t size) {
+    snprintf(path, size, "%s%s", prefix, name);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        LOG_ERROR("Cannot write %s: %s", path, strerror(errno));
+    }
+    return f;
+}
+
+/* Deaths by paddle position (across) and time of death (down), log-scaled */
+static int analyze_write_heatmap(const AnalyzePartial *t, const char *path) {
+    SDL_Surface *image = SDL_CreateRGBSurfaceWithFormat(
+        0, ANALYZE_X_BINS * ANALYZE_CELL_W, ANALYZE_TIME_BINS * ANALYZE_CELL_H,
+        32, SDL_PIXELFORMAT_ARGB8888);
+    if (!image) {
+        LOG_ERROR("Cannot create the heatmap image: %s", SDL_GetError());
+        return 0;
+    }
+
+    Uint32 peak = 1;
+    for (int row = 0; row < ANALYZE_TIME_BINS; ++row) {
+        for (int column = 0; column < ANALYZE_X_BINS; ++column) {
+            if (t->heat[row][column] > peak) peak = t->heat[row][column];
+        }
+    }
+    double scale = 1.0 / log1p((double)peak);
+
+    for (int y = 0; y < image->h; ++y) {
+        Uint32 *pixel = (Uint32 *)((Uint8 *)image->pixels + (size_t)y * image->pitch);
+        const Uint32 *row = t->heat[y / ANALYZE_CELL_H];
+        for (int x = 0; x < image->w; ++x) {
+            /* Black through red and yellow to white */
+            double v = log1p((double)row[x / ANALYZE_CELL_W]) * scale * 3.0;
+            Uint32 r = (Uint32)(255.0 * (v < 1.0 ? v : 1.0));
+            Uint32 g = (Uint32)(255.0 * (v < 1.0 ? 0.0 : (v < 2.0 ? v - 1.0 : 1.0)));
+            Uint32 b = (Uint32)(255.0 * (v < 2.0 ? 0.0 : v - 2.0));
+            pixel[x] = 0xFF000000u | r << 16 | g << 8 | b;
+        }
+    }
+
+    int ok = SDL_SaveBMP(image, path) == 0;
+    if (!ok) {
+        LOG_ERROR("Cannot write %s: %s", path, SDL_GetError());
+    }
+    SDL_FreeSurface(image);
+    return ok;
+}
+
+static int analyze_write_reports(const AnalyzePartial *t, const char *prefix) {
+    char path[1024];
+    int ok = 1;
+
+    snprintf(path, sizeof(path), "%sheatmap.bmp", prefix);
+    ok &= analyze_write_heatmap(t, path);
+
+    /* Difficulty curve: the chance a run still alive dies in each second */
+    FILE *f = analyze_open(prefix, "deaths.csv", path, sizeof(path));
+    if (f) {
+        Uint64 alive = t->runs;
+        fprintf(f, "second,alive,deaths,hazard,mean_obstacles\n");
+        for (int s = 0; s <= ANALYZE_MAX_SECONDS && alive > 0; ++s) {
+            Uint64 d = t->deaths[s];
+            fprintf(f, "%d%s,%llu,%llu,%.6f,%.2f\n", s,
+                    s == ANALYZE_MAX_SECONDS ? "+" : "",
+                    (unsigned long long)alive, (unsigned long long)d,
+                    (double)d / (double)alive,
+                    d > 0 ? (double)t->obstacleSum[s] / (double)d : 0.0);
+            alive -= d;
+        }
+        ok &= fclose(f) == 0;
+    }
+
+    f = analyze_open(prefix, "death_x.csv", path, sizeof(path));
+    if (f) {
+        fprintf(f, "x_from,x_to,deaths\n");
+        for (int column = 0; column < ANALYZE_X_BINS; ++column) {
+            Uint64 d = 0;
+            for (int row = 0; row < ANALYZE_TIME_BINS; ++row) {
+                d += t->heat[row][column];
+            }
+            fprintf(f, "%d,%d,%llu\n", column * WINDOW_WIDTH / ANALYZE_X_BINS,
+                    (column + 1) * WINDOW_WIDTH / ANALYZE_X_BINS,
+                    (unsigned long long)d);
+        }
+        ok &= fclose(f) == 0;
+    }
+
+    f = analyze_open(prefix, "obstacles.csv", path, sizeof(path));
+    if (f) {
+        fprintf(f, "obstacles_on_screen,deaths\n");
+        for (int n = 0; n <= MAX_OBSTACLES; ++n) {
+            fprintf(f, "%d,%llu\n", n, (unsigned long long)t->byObstacles[n]);
+        }
+        ok &= fclose(f) == 0;
+    }
+
+    f = analyze_open(prefix, "scores.csv", path, sizeof(path));
+    if (f) {
+        fprintf(f, "second,runs,mean_score,stddev\n");
+        for (int s = 0; s < ANALYZE_MAX_SECONDS; ++s) {
+            if (t->curveRuns[s] == 0) {
+                continue;
+            }
+            double n = (double)t->curveRuns[s];
+            double mean = t->curveSum[s] / n;
+            double var = t->curveSumSq[s] / n - mean * mean;
+            fprintf(f, "%d,%llu,%.2f,%.2f\n", s,
+                    (unsigned long long)t->curveRuns[s], mean,
+                    var > 0.0 ? sqrt(var) : 0.0);
+        }
+        ok &= fclose(f) == 0;
+    }
+    return ok;
+}
+
+static int run_analysis(const char *prefix, int fileCount, char **paths) {
+    Analysis a;
+    int status = EXIT_FAILURE;
+
+    if (fileCount <= 0) {
+        LOG_ERROR("Usage: --analyze <output prefix> <telemetry log>...");
+        return EXIT_FAILURE;
+    }
+
+    memset(&a, 0, sizeof(a));
+    a.paths = paths;
+    a.partialCount = jobs_thread_count();
+    a.partials = (AnalyzePartial **)calloc((size_t)a.partialCount,
+                                           sizeof(AnalyzePartial *));
+    for (int i = 0; a.partials && i < a.partialCount; ++i) {
+        a.partials[i] = (AnalyzePartial *)calloc(1, sizeof(AnalyzePartial));
+        if (!a.partials[i]) {
+            LOG_ERROR("Out of memory for histograms");
+            goto done;
+        }
+    }
+    if (!a.partials) {
+        LOG_ERROR("Out of memory for histograms");
+        return EXIT_FAILURE;
+    }
+
+    Uint32 startTicks = SDL_GetTicks();
+    jobs_parallel_for(0, fileCount, 1, analyze_files, &a);
+    AnalyzePartial *total = a.partials[0];
+    for (int i = 1; i < a.partialCount; ++i) {
+        analyze_reduce(total, a.partials[i]);
+    }
+    Uint32 elapsedMs = SDL_GetTicks() - startTicks;
+
+    LOG_INFO("Analyzed %llu runs in %llu logs (%.1f MB) in %u ms, %.0f MB/s "
+             "on %d threads", (unsigned long long)total->runs,
+             (unsigned long long)total->files, (double)total->bytes / 1e6,
+             (unsigned)elapsedMs,
+             (double)total->bytes / 1e3 / (elapsedMs > 0 ? elapsedMs : 1),
+             a.partialCount);
+    if (total->badFiles > 0 || total->truncated > 0) {
+        LOG_WARN("%llu logs skipped, %llu cut short",
+                 (unsigned long long)total->badFiles,
+                 (unsigned long long)total->truncated);
+    }
+    if (total->runs == 0) {
+        LOG_ERROR("No runs found");
+        goto done;
+    }
+    if (analyze_write_reports(total, prefix)) {
+        LOG_INFO("Wrote %sheatmap.bmp, %sdeaths.csv, %sdeath_x.csv, "
+                 "%sobstacles.csv and %sscores.csv",
+                 prefix, prefix, prefix, prefix, prefix);
+        status = EXIT_SUCCESS;
+    }
+
+done:
+    for (int i = 0; i < a.partialCount; ++i) {
+        free(a.partials[i]);
+    }
+    free(a.partials);
+    return status;
+}
+
+/* ------------------------------- Spectate -------------------------------- */
+
+/*
+ * `--spectate`: a tournament entrant plays in the window at `speed` times
+ * real time, for checking hours of bot play by eye in minutes. Runs follow
+ * the tournament's rules: seeds count up from the first, moves are made
+ * every SIM_ENV_STEP_US of sim time, and a run still alive after
+ * TOURNAMENT_MAX_RUN_US ends there, so each run shown is the one
+ * `--tournament` scores for that seed.
+ *
+ * The main thread steps the sim as fast as the speed asks and publishes one
+ * snapshot per loop iteration; the render thread keeps drawing the newest at
+ * display rate. At 100x on a 60 Hz display each frame shows one env step in
+ * about a hundred, and every other step is never copied out of the sim.
+ */
+
+typedef struct {
+    TournamentEntry entry;
+    BotView     view;          /* plugins */
+    void       *state;
+    MlpScratch  scratch;       /* policies: one row */
+    float       obs[SIM_OBS_FLOATS];
+    Uint32      seed;          /* of the current run */
+    Uint64      owedUs;        /* sim time due but not yet stepped */
+    Uint64      lastWallUs;
+    Uint32      runs;
+    double      scoreSum;
+    Uint64      simUs;         /* sim time stepped, all runs */
+    Uint64      wallUs;        /* wall time spent unpaused */
+    Uint64      titleSimUs;    /* simUs at the last title update */
+    Uint32      titleMs;
+} Spectator;
+
+static void spectate_begin_run(Spectator *sp, Game *game) {
+    const DodgeBot *bot = sp->entry.bot;
+    sim_reset(&game->sim, sp->seed);
+    sp->state = bot && bot->create ? bot->create(sp->seed) : NULL;
+}
+
+static void spectate_end_run(Spectator *sp, Game *game) {
+    const DodgeBot *bot = sp->entry.bot;
+    if (bot && bot->destroy) {
+        bot->destroy(sp->state);
+    }
+    sp->state = NULL;
+    ++sp->runs;
+    sp->scoreSum += game->sim.score;
+    LOG_INFO("Seed %u: score %d, survived %.1f s", (unsigned)sp->seed,
+             game->sim.score, (double)game->sim.simTimeUs / 1e6);
+}
+
+static int spectate_init(Spectator *sp, Game *game, const Options *options) {
+    memset(sp, 0, sizeof(*sp));
+    if (!tournament_load(&sp->entry, options->spectatePath)) {
+        return 0;
+    }
+    if (!sp->entry.bot && !mlp_scratch_init(&sp->scratch, &sp->entry.policy, 1)) {
+        LOG_ERROR("Out of memory for policy %s", sp->entry.path);
+        return 0;
+    }
+    bot_view_init(&sp->view);
+    sp->seed = options->spectateSeed;
+    sp->titleMs = SDL_GetTicks();
+
+    game->speed = options->spectateSpeed;
+    game->sim.killcam = NULL;      /* no replays of bot runs */
+    game->render.lateLatch = 0;    /* the keyboard does not move the player */
+    set_game_state(game, GAME_STATE_PLAYING);
+    spectate_begin_run(sp, game);
+    LOG_INFO("Spectating %s at %ux from seed %u (+/- to change speed)",
+             sp->entry.name, (unsigned)game->speed, (unsigned)sp->seed);
+    return 1;
+}
+
+static void spectate_free(Spectator *sp) {
+    const DodgeBot *bot = sp->entry.bot;
+    if (bot && bot->destroy && sp->state) {
+        bot->destroy(sp->state);
+    }
+    if (sp->runs > 0 && sp->wallUs > 0) {
+        LOG_INFO("Spectated %u runs, mean score %.1f: %.1f s of play in "
+                 "%.1f s (%.1fx)", (unsigned)sp->runs,
+                 sp->scoreSum / sp->runs, (double)sp->simUs / 1e6,
+                 (double)sp->wallUs / 1e6,
+                 (double)sp->simUs / (double)sp->wallUs);
+    }
+    mlp_scratch_free(&sp->scratch);
+    mlp_free(&sp->entry.policy);
+    if (sp->entry.handle) {
+        dlclose(sp->entry.handle);
+    }
+}
+
+static float spectate_move(Spectator *sp, const Sim *sim) {
+    if (sp->entry.bot) {
+        return bot_view_move(&sp->view, sp->entry.bot, sp->state, sim);
+    }
+    sim_observe(sim, sp->obs);
+    return (float)policy_action(mlp_forward(&sp->entry.policy, &sp->scratch,
+                                            sp->obs, SIM_OBS_FLOATS, 1));
+}
+
+/*
+ * Step the sim by `speed` times the wall time since the last call, for at
+ * most SPECTATE_SLICE_US of wall time. Returns 1 if anything was stepped.
+ */
+static int spectate_update(Spectator *sp, Game *game, Uint64 nowUs) {
+    Uint64 wallUs = nowUs - sp->lastWallUs;
+    sp->lastWallUs = nowUs;
+    if (game->state != GAME_STATE_PLAYING) {
+        sp->owedUs = 0;
+        return 0;
+    }
+
+    /* Past the catch-up window the sim cannot keep up; drop the excess */
+    Uint64 maxOwedUs = (Uint64)SIM_MAX_CATCHUP_MS * 1000 * game->speed;
+    sp->wallUs += wallUs;
+    sp->owedUs += wallUs * game->speed;
+    if (sp->owedUs > maxOwedUs) {
+        sp->owedUs = maxOwedUs;
+    }
+
+    Uint64 deadline = SDL_GetPerformanceCounter() +
+                      SPECTATE_SLICE_US * SDL_GetPerformanceFrequency() / 1000000;
+    int stepped = 0;
+    while (sp->owedUs >= SIM_ENV_STEP_US &&
+           SDL_GetPerformanceCounter() < deadline) {
+        int dead = sim_advance(&game->sim, SIM_ENV_STEP_US,
+                               spectate_move(sp, &game->sim));
+        sim_clear_events(&game->sim);
+        sp->owedUs -= SIM_ENV_STEP_US;
+        sp->simUs  += SIM_ENV_STEP_US;
+        profiler_count_sim(SIM_ENV_STEP_US);
+        stepped = 1;
+
+        if (dead || game->sim.simTimeUs >= TOURNAMENT_MAX_RUN_US) {
+            spectate_end_run(sp, game);
+            ++sp->seed;
+            spectate_begin_run(sp, game);
+        }
+    }
+    return stepped;
+}
+
+/* Bot, seed, score and the speed actually reached, a few times a second */
+static void spectate_update_title(Spectator *sp, Game *game) {
+    Uint32 now = SDL_GetTicks();
+    if (!SDL_TICKS_PASSED(now, sp->titleMs + SPECTATE_TITLE_MS)) {
+        return;
+    }
+    double reached = (double)(sp->simUs - sp->titleSimUs) / 1000.0 /
+                     (double)(now - sp->titleMs);
+    sp->titleMs    = now;
+    sp->titleSimUs = sp->simUs;
+
+    char title[192];
+    snprintf(title, sizeof(title),
+             "Endless Dodge - %s  Seed %u  Score: %d  Mean: %.0f over %u  "
+             "%.0fx of %ux%s", sp->entry.name, (unsigned)sp->seed,
+             game->sim.score, sp->runs ? sp->scoreSum / sp->runs : 0.0,
+             (unsigned)sp->runs, reached, (unsigned)game->speed,
+             game->state == GAME_STATE_PAUSED ? "  [PAUSED]" : "");
+    SDL_SetWindowTitle(game->window, title);
+}
+
+/* ------------------------------ Main Loop -------------------------------- */
+
+static int run(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--verify-kernels") == 0) {
+        long cases = argc > 2 ? strtol(argv[2], NULL, 10) : VERIFY_DEFAULT_CASES;
+        Uint64 seed = argc > 3 ? (Uint64)strtoull(argv[3], NULL, 0)
+                               : (Uint64)time(NULL);
+        return run_kernel_verification(cases, seed);
+    }
+    if (argc > 1 && strcmp(argv[1], "--leaderboard-server") == 0) {
+        int port = argc > 2 ? atoi(argv[2]) : LEADERBOARD_DEFAULT_PORT;
+        return run_leaderboard_server(port);
+    }
+    if (argc > 1 && strcmp(argv[1], "--agent") == 0) {
+        return run_agent_server(argc > 2 ? argv[2] : NULL);
+    }
+    if (argc > 1 && strcmp(argv[1], "--train") == 0) {
+        int generations = argc > 2 ? atoi(argv[2]) : TRAIN_DEFAULT_GENERATIONS;
+        return run_training(generations, argc > 3 ? argv[3] : TRAIN_DEFAULT_FILE);
+    }
+    if (argc > 1 && strcmp(argv[1], "--list-modes") == 0) {
+        return run_list_modes();
+    }
+    if (argc > 2 && strcmp(argv[1], "--analyze") == 0) {
+        return run_analysis(argv[2], argc - 3, argv + 3);
+    }
+    if (argc > 2 && strcmp(argv[1], "--replay-render") == 0) {
+        return run_render_replay(argv[2], argc > 3 ? atoi(argv[3]) : 1);
+    }
+    if (argc > 1 && strcmp(argv[1], "--tournament") == 0) {
+        int seeds = argc > 2 ? atoi(argv[2]) : 0;
+        return run_tournament(seeds, argc - 3, argv + 3);
+    }
+
+    Options options;
+    memset(&options, 0, sizeof(options));
+    options.telemetryPath = TELEMETRY_FILE;
+    options.mirrorDisplay = -1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--leaderboard") == 0 && i + 1 < argc) {
+            options.leaderboardAddr = argv[++i];
+        } else if (strcmp(argv[i], "--late-latch") == 0) {
+            options.lateLatch = 1;
+        } else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) {
+            options.telemetryPath = argv[++i];
+        } else if (strcmp(argv[i], "--no-telemetry") == 0) {
+            options.telemetryPath = NULL;
+        } else if (strcmp(argv[i], "--fullscreen") == 0) {
+            options.fullscreen = 1;
+            /* Optional WxH or WxH@Hz; without one, the desktop's size */
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0])) {
+                const char *mode = argv[++i];
+                int used = 0;
+                if (sscanf(mode, "%dx%d%n@%d%n", &options.modeW, &options.modeH,
+                           &used, &options.modeHz, &used) < 2 ||
+                    mode[used] != '\0' || options.modeW <= 0 ||
+                    options.modeH <= 0 || options.modeHz < 0) {
+                    LOG_ERROR("Bad display mode %s; expected WxH or WxH@Hz",
+                              mode);
+                    return EXIT_FAILURE;
+                }
+            }
+        } else if (strcmp(argv[i], "--display") == 0 && i + 1 < argc) {
+            options.display = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mirror") == 0) {
+            options.mirror = 1;
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0])) {
+                options.mirrorDisplay = atoi(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--record-render") == 0 && i + 1 < argc) {
+            options.recordRenderPath = argv[++i];
+        } else if (strcmp(argv[i], "--spectate") == 0 && i + 1 < argc) {
+            options.spectatePath  = argv[++i];
+            options.spectateSpeed = SPECTATE_DEFAULT_SPEED;
+            options.spectateSeed  = 1;
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0])) {
+                options.spectateSpeed = (Uint32)strtoul(argv[++i], NULL, 10);
+            }
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0])) {
+                options.spectateSeed = (Uint32)strtoul(argv[++i], NULL, 10);
+            }
+            if (options.spectateSpeed < 1 ||
+                options.spectateSpeed > SPECTATE_MAX_SPEED) {
+                LOG_ERROR("Spectate speed must be 1 to %d",
+                          SPECTATE_MAX_SPEED);
+                return EXIT_FAILURE;
+            }
+        } else {
+            LOG_ERROR("Unknown option: %s", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Game game;
+    static Spectator spectator;
+    if (!init_game(&game, &options)) {
+        return EXIT_FAILURE;
+    }
+    if (options.spectatePath && !spectate_init(&spectator, &game, &options)) {
+        spectate_free(&spectator);
+        resume_close(&game.resume);
+        telemetry_stop(&game.telemetry);
+        leaderboard_shutdown(&game.leaderboard);
+        shutdown_sdl(&game);
+        return EXIT_FAILURE;
+    }
+
+    publish_render_state(&game, SDL_GetPerformanceCounter());
+    if ((options.recordRenderPath &&
+         !render_record_open(&game.render, options.recordRenderPath)) ||
+        !render_thread_start(&game.render, game.window)) {
+        render_record_close(&game.render);
+        if (options.spectatePath) {
+            spectate_free(&spectator);
+        }
+        resume_close(&game.resume);
+        telemetry_stop(&game.telemetry);
+        leaderboard_shutdown(&game.leaderboard);
+        shutdown_sdl(&game);
+        return EXIT_FAILURE;
+    }
+
+    /*
+     * Main thread: sample input every INPUT_SAMPLE_MS and step the sim in
+     * ticks of sim_tick_us(). Each tick first applies the input events
+     * timestamped before it, so reaction latency is bounded by the tick
+     * length, not the display refresh. Sim time is kept in microseconds
+     * against SDL_GetTicks() so it lines up with event timestamps.
+     */
+    const Uint64 perfFreq  = SDL_GetPerformanceFrequency();
+    const Uint64 perfStart = SDL_GetPerformanceCounter();
+    const Uint32 ticksStart = SDL_GetTicks();
+    Uint64 nextTickUs = 0;  /* wall time of the next tick, since perfStart */
+
+    while (game.running) {
+        sample_input(&game);
+
+        Uint64 elapsed = SDL_GetPerformanceCounter() - perfStart;
+        Uint64 nowUs = elapsed / perfFreq * 1000000 +
+                       elapsed % perfFreq * 1000000 / perfFreq;
+
+        /* Spectating: the bot moves, keys only pause, quit and set speed */
+        if (options.spectatePath) {
+            apply_input(&game, SDL_GetTicks());
+            if (spectate_update(&spectator, &game, nowUs)) {
+                publish_render_state(&game, SDL_GetPerformanceCounter());
+            }
+            spectate_update_title(&spectator, &game);
+            if (spectator.owedUs < SIM_ENV_STEP_US) {
+                SDL_Delay(INPUT_SAMPLE_MS);
+            }
+            continue;
+        }
+
+        if (nowUs > nextTickUs + SIM_MAX_CATCHUP_MS * 1000) {
+            nextTickUs = nowUs - SIM_MAX_CATCHUP_MS * 1000;
+        }
+
+        int stepped = 0;
+        while (nextTickUs <= nowUs) {
+            Uint32 tickUs = game_tick_us(&game);
+            apply_input(&game, ticksStart + (Uint32)(nextTickUs / 1000));
+            update_game(&game, tickUs);
+            nextTickUs += tickUs;
+            stepped = 1;
+        }
+
+        if (game.state == GAME_STATE_PLAYING &&
+            SDL_TICKS_PASSED(SDL_GetTicks(),
+                             game.resume.lastSaveMs + RESUME_INTERVAL_MS)) {
+            resume_save(&game.resume, &game.sim);
+        }
+
+        if (stepped) {
+            update_window_title(&game);
+            publish_render_state(&game, perfStart +
+                                 nextTickUs / 1000000 * perfFreq +
+                                 nextTickUs % 1000000 * perfFreq / 1000000);
+        }
+
+        SDL_Delay(INPUT_SAMPLE_MS);
+    }
+
+    render_thread_stop(&game.render);
+    if (options.spectatePath) {
+        spectate_free(&spectator);
+    }
+    /* Quitting mid-run keeps the run for next time */
+    if (game.state == GAME_STATE_PLAYING || game.state == GAME_STATE_PAUSED) {
+        resume_save(&game.resume, &game.sim);
+    }
+    resume_close(&game.resume);
+    telemetry_stop(&game.telemetry);
+    leaderboard_shutdown(&game.leaderboard);
+    shutdown_sdl(&game);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    log_init();
+
+    /* `--profile[=file]` works with every mode, so take it out first. The
+       file is only taken after `=`, so a following argument (a bot, a
+       replay) is never mistaken for the output and overwritten */
+    const char *profilePath = NULL;
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--profile") == 0) {
+            profilePath = PROFILE_DEFAULT_FILE;
+        } else if (strncmp(argv[i], "--profile=", 10) == 0 && argv[i][10]) {
+            profilePath = argv[i] + 10;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    argv[argc] = NULL;
+
+    if (profilePath) {
+        profiler_start(profilePath);
+    }
+    jobs_init(0, profiler_job_thread_started, profiler_job_thread_stopped);
+
+    int status = run(argc, argv);
+
+    profiler_stop();
+    jobs_shutdown();
+    log_shutdown();
+    return status;
+}
@@ -0,0 +1,578 @@
+/*
+ * Endless Dodge - work-stealing job system. See jobs.h.
+ */
+
+#define _GNU_SOURCE
+
+#include "jobs.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define JOBS_SPIN_ROUNDS  64           /* empty searches before sleeping */
+#define JOBS_NONE         0xFFFFFFFFu  /* end of the free list */
+#define JOBS_CACHE_LINE   64
+
+typedef struct Job {
+    JobFunc       func;       /* NULL for a range */
+    JobRangeFunc  range;
+    void         *arg;
+    int           begin;
+    int           end;
+    int           grain;
+    JobCounter   *done;
+    struct Job   *next;       /* in a counter's waiters or the shared queue */
+    uint32_t      nextFree;
+} Job;
+
+/*
+ * Chase-Lev deque with a fixed ring, after Le et al., "Correct and Efficient
+ * Work-Stealing for Weak Memory Models" (PPoPP 2013). The owner pushes and
+ * pops at `bottom`; thieves take the oldest job at `top`.
+ */
+typedef struct {
+    volatile int64_t top;
+    char             pad0[JOBS_CACHE_LINE - sizeof(int64_t)];
+    volatile int64_t bottom;
+    char             pad1[JOBS_CACHE_LINE - sizeof(int64_t)];
+    Job             *jobs[JOBS_DEQUE_SIZE];
+} JobDeque;
+
+typedef struct {
+    JobDeque   deque;
+    pthread_t  thread;
+    uint32_t   rng;           /* victim choice */
+    uint64_t   busyNs;        /* written by the owner only */
+    uint64_t   jobs;
+    uint64_t   steals;
+} JobThread;
+
+typedef struct {
+    int              threadCount;   /* 0 until jobs_init() */
+    int              started;       /* pool threads running */
+    JobThread       *threads;
+    JobThreadHook    onStart;
+    JobThreadHook    onStop;
+    uint64_t         startNs;
+
+    volatile int     quit;
+    volatile int     sleepers;
+    pthread_mutex_t  sleepLock;
+    pthread_cond_t   wake;
+
+    /* Jobs from threads without a deque, or with a full one */
+    pthread_mutex_t  sharedLock;
+    Job             *sharedHead;
+    Job             *sharedTail;
+    volatile int     sharedCount;
+
+    /* Work done on threads outside the pool */
+    volatile uint64_t foreignBusyNs;
+    volatile uint64_t foreignJobs;
+
+    /* Free job slots: a stack of indices, its head tagged against ABA */
+    volatile uint64_t freeHead;    /* tag << 32 | index */
+    Job              pool[JOBS_MAX_JOBS];
+} JobSystem;
+
+static JobSystem g_jobs;
+static __thread int t_jobIndex = -1;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* ------------------------------- Job Slots ------------------------------- */
+
+static Job *job_alloc(void) {
+    uint64_t head = __atomic_load_n(&g_jobs.freeHead, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t index = (uint32_t)head;
+        if (index == JOBS_NONE) {
+            return NULL;
+        }
+        uint32_t next = __atomic_load_n(&g_jobs.pool[index].nextFree,
+                                        __ATOMIC_RELAXED);
+        uint64_t taken = (((head >> 32) + 1) << 32) | next;
+        if (__atomic_compare_exchange_n(&g_jobs.freeHead, &head, taken, 1,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return &g_jobs.pool[index];
+        }
+    }
+}
+
+static void job_free(Job *job) {
+    uint32_t index = (uint32_t)(job - g_jobs.pool);
+    uint64_t head = __atomic_load_n(&g_jobs.freeHead, __ATOMIC_RELAXED);
+    uint64_t freed;
+    do {
+        __atomic_store_n(&job->nextFree, (uint32_t)head, __ATOMIC_RELAXED);
+        freed = (((head >> 32) + 1) << 32) | index;
+    } while (!__atomic_compare_exchange_n(&g_jobs.freeHead, &head, freed, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/* -------------------------------- Deques --------------------------------- */
+
+static int deque_push(JobDeque *q, Job *job) {
+    int64_t b = __atomic_load_n(&q->bottom, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&q->top, __ATOMIC_ACQUIRE);
+    if (b - t >= JOBS_DEQUE_SIZE) {
+        return 0;
+    }
+    __atomic_store_n(&q->jobs[b & (JOBS_DEQUE_SIZE - 1)], job, __ATOMIC_RELAXED);
+    __atomic_store_n(&q->bottom, b + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static Job *deque_pop(JobDeque *q) {
+    int64_t b = __atomic_load_n(&q->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&q->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t t = __atomic_load_n(&q->top, __ATOMIC_RELAXED);
+
+    if (t > b) {
+        __atomic_store_n(&q->bottom, b + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    Job *job = __atomic_load_n(&q->jobs[b & (JOBS_DEQUE_SIZE - 1)],
+                               __ATOMIC_RELAXED);
+    if (t == b) {
+        /* The last job: race the thieves for it */
+        if (!__atomic_compare_exchange_n(&q->top, &t, t + 1, 0,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            job = NULL;
+        }
+        __atomic_store_n(&q->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return job;
+}
+
+static Job *deque_steal(JobDeque *q) {
+    int64_t t = __atomic_load_n(&q->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&q->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) {
+        return NULL;
+    }
+    Job *job = __atomic_load_n(&q->jobs[t & (JOBS_DEQUE_SIZE - 1)],
+                               __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&q->top, &t, t + 1, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;  /* lost the race; the caller looks elsewhere */
+    }
+    return job;
+}
+
+/* ------------------------------ Scheduling ------------------------------- */
+
+static int jobs_available(void) {
+    if (__atomic_load_n(&g_jobs.sharedCount, __ATOMIC_RELAXED) > 0) {
+        return 1;
+    }
+    for (int i = 0; i < g_jobs.threadCount; ++i) {
+        const JobDeque *q = &g_jobs.threads[i].deque;
+        if (__atomic_load_n(&q->bottom, __ATOMIC_RELAXED) >
+            __atomic_load_n(&q->top, __ATOMIC_RELAXED)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Pushers publish the job, then check for sleepers; sleepers announce
+ * themselves, then check for jobs. With a full fence on both sides one of
+ * them always sees the other, so no wakeup is lost.
+ */
+static void jobs_wake(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g_jobs.sleepers, __ATOMIC_RELAXED) > 0) {
+        pthread_mutex_lock(&g_jobs.sleepLock);
+        pthread_cond_signal(&g_jobs.wake);
+        pthread_mutex_unlock(&g_jobs.sleepLock);
+    }
+}
+
+static void jobs_sleep(void) {
+    pthread_mutex_lock(&g_jobs.sleepLock);
+    __atomic_add_fetch(&g_jobs.sleepers, 1, __ATOMIC_SEQ_CST);
+    if (!jobs_available() && !__atomic_load_n(&g_jobs.quit, __ATOMIC_ACQUIRE)) {
+        pthread_cond_wait(&g_jobs.wake, &g_jobs.sleepLock);
+    }
+    __atomic_sub_fetch(&g_jobs.sleepers, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&g_jobs.sleepLock);
+}
+
+static void jobs_push(Job *job) {
+    int self = t_jobIndex;
+    if (self < 0 || !deque_push(&g_jobs.threads[self].deque, job)) {
+        job->next = NULL;
+        pthread_mutex_lock(&g_jobs.sharedLock);
+        if (g_jobs.sharedTail) {
+            g_jobs.sharedTail->next = job;
+        } else {
+            g_jobs.sharedHead = job;
+        }
+        g_jobs.sharedTail = job;
+        __atomic_add_fetch(&g_jobs.sharedCount, 1, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&g_jobs.sharedLock);
+    }
+    jobs_wake();
+}
+
+/* Own deque first, then steal from a random victim onwards, then shared */
+static Job *jobs_find(int self) {
+    JobThread *me = self >= 0 ? &g_jobs.threads[self] : NULL;
+    Job *job = me ? deque_pop(&me->deque) : NULL;
+    if (job) {
+        return job;
+    }
+
+    int n = g_jobs.threadCount;
+    uint32_t start = 0;
+    if (me) {
+        me->rng ^= me->rng << 13;
+        me->rng ^= me->rng >> 17;
+        me->rng ^= me->rng << 5;
+        start = me->rng;
+    }
+    for (int i = 0; i < n; ++i) {
+        int victim = (int)((start + (uint32_t)i) % (uint32_t)n);
+        if (victim == self) continue;
+        job = deque_steal(&g_jobs.threads[victim].deque);
+        if (job) {
+            if (me) {
+                __atomic_store_n(&me->steals, me->steals + 1, __ATOMIC_RELAXED);
+            }
+            return job;
+        }
+    }
+
+    if (__atomic_load_n(&g_jobs.sharedCount, __ATOMIC_ACQUIRE) > 0) {
+        pthread_mutex_lock(&g_jobs.sharedLock);
+        job = g_jobs.sharedHead;
+        if (job) {
+            g_jobs.sharedHead = job->next;
+            if (!g_jobs.sharedHead) {
+                g_jobs.sharedTail = NULL;
+            }
+            __atomic_sub_fetch(&g_jobs.sharedCount, 1, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_unlock(&g_jobs.sharedLock);
+    }
+    return job;
+}
+
+/* ------------------------------- Counters -------------------------------- */
+
+static void counter_lock(JobCounter *c) {
+    while (__atomic_exchange_n(&c->lock, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&c->lock, __ATOMIC_RELAXED)) {
+            sched_yield();
+        }
+    }
+}
+
+static void counter_unlock(JobCounter *c) {
+    __atomic_store_n(&c->lock, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * Under the lock, so a waiter that sees zero and then takes the lock knows
+ * nothing touches the counter any more and may free it.
+ */
+static void counter_release(JobCounter *c) {
+    Job *waiters = NULL;
+    counter_lock(c);
+    if (__atomic_sub_fetch(&c->count, 1, __ATOMIC_ACQ_REL) == 0) {
+        waiters = c->waiters;
+        c->waiters = NULL;
+    }
+    counter_unlock(c);
+
+    while (waiters) {
+        Job *next = waiters->next;
+        jobs_push(waiters);
+        waiters = next;
+    }
+}
+
+/* ------------------------------- Running --------------------------------- */
+
+static void job_execute(Job *job, int self) {
+    uint64_t start = now_ns();
+    uint64_t count = 1;
+    JobCounter *done = job->done;
+
+    if (job->func) {
+        JobFunc func = job->func;
+        void *arg = job->arg;
+        job_free(job);
+        func(arg);
+    } else {
+        JobRangeFunc range = job->range;
+        void *arg = job->arg;
+        int begin = job->begin, end = job->end, grain = job->grain;
+        job_free(job);
+
+        /* Hand off the upper half until what is left fits the grain */
+        while (end - begin > grain) {
+            Job *half = job_alloc();
+            if (!half) {
+                break;
+            }
+            int mid = begin + (end - begin) / 2;
+            memset(half, 0, sizeof(*half));
+            half->range = range;
+            half->arg   = arg;
+            half->begin = mid;
+            half->end   = end;
+            half->grain = grain;
+            half->done  = done;
+            __atomic_add_fetch(&done->count, 1, __ATOMIC_RELAXED);
+            jobs_push(half);
+            end = mid;
+        }
+        /* Step by remaining length, so `begin + grain` never passes INT_MAX */
+        while (end - begin > grain) {
+            range(arg, begin, begin + grain);
+            begin += grain;
+            ++count;
+        }
+        range(arg, begin, end);
+    }
+    counter_release(done);
+
+    uint64_t busy = now_ns() - start;
+    if (self >= 0) {
+        /* Owner-only counters; atomic stores so jobs_stats() may read them */
+        JobThread *me = &g_jobs.threads[self];
+        __atomic_store_n(&me->busyNs, me->busyNs + busy, __ATOMIC_RELAXED);
+        __atomic_store_n(&me->jobs, me->jobs + count, __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(&g_jobs.foreignBusyNs, busy, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&g_jobs.foreignJobs, count, __ATOMIC_RELAXED);
+    }
+}
+
+static void *jobs_worker(void *data) {
+    int self = (int)(intptr_t)data;
+    int idle = 0;
+
+    t_jobIndex = self;
+    if (g_jobs.onStart) {
+        g_jobs.onStart(self);
+    }
+    for (;;) {
+        Job *job = jobs_find(self);
+        if (job) {
+            job_execute(job, self);
+            idle = 0;
+            continue;
+        }
+        if (__atomic_load_n(&g_jobs.quit, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        if (++idle < JOBS_SPIN_ROUNDS) {
+            sched_yield();
+            continue;
+        }
+        jobs_sleep();
+        idle = 0;
+    }
+    if (g_jobs.onStop) {
+        g_jobs.onStop(self);
+    }
+    return NULL;
+}
+
+/* --------------------------------- API ----------------------------------- */
+
+int jobs_init(int threads, JobThreadHook onStart, JobThreadHook onStop) {
+    if (g_jobs.threadCount > 0) {
+        return g_jobs.started + 1;
+    }
+    if (threads <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? (int)cores : 1;
+    }
+    if (threads > JOBS_MAX_THREADS) {
+        threads = JOBS_MAX_THREADS;
+    }
+
+    void *memory = NULL;
+    if (posix_memalign(&memory, JOBS_CACHE_LINE,
+                       (size_t)threads * sizeof(JobThread)) != 0) {
+        return 1;  /* no pool; jobs run inline */
+    }
+    memset(memory, 0, (size_t)threads * sizeof(JobThread));
+    g_jobs.threads = (JobThread *)memory;
+    for (int i = 0; i < threads; ++i) {
+        g_jobs.threads[i].rng = 0x9E3779B9u * (uint32_t)(i + 1);
+    }
+    for (uint32_t i = 0; i < JOBS_MAX_JOBS; ++i) {
+        g_jobs.pool[i].nextFree = i + 1 < JOBS_MAX_JOBS ? i + 1 : JOBS_NONE;
+    }
+    g_jobs.freeHead = 0;
+    pthread_mutex_init(&g_jobs.sleepLock, NULL);
+    pthread_cond_init(&g_jobs.wake, NULL);
+    pthread_mutex_init(&g_jobs.sharedLock, NULL);
+    g_jobs.onStart     = onStart;
+    g_jobs.onStop      = onStop;
+    g_jobs.startNs     = now_ns();
+    g_jobs.threadCount = threads;
+    t_jobIndex = 0;
+
+    for (int i = 1; i < threads; ++i) {
+        if (pthread_create(&g_jobs.threads[i].thread, NULL, jobs_worker,
+                           (void *)(intptr_t)i) != 0) {
+            break;  /* run with the threads we got; the rest stay empty */
+        }
+        ++g_jobs.started;
+    }
+    return g_jobs.started + 1;
+}
+
+void jobs_shutdown(void) {
+    if (g_jobs.threadCount == 0) {
+        return;
+    }
+    pthread_mutex_lock(&g_jobs.sleepLock);
+    __atomic_store_n(&g_jobs.quit, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&g_jobs.wake);
+    pthread_mutex_unlock(&g_jobs.sleepLock);
+    for (int i = 1; i <= g_jobs.started; ++i) {
+        pthread_join(g_jobs.threads[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&g_jobs.wake);
+    pthread_mutex_destroy(&g_jobs.sleepLock);
+    pthread_mutex_destroy(&g_jobs.sharedLock);
+    free(g_jobs.threads);
+    memset(&g_jobs, 0, sizeof(g_jobs));
+    t_jobIndex = -1;
+}
+
+int jobs_thread_count(void) {
+    return g_jobs.threadCount > 0 ? g_jobs.started + 1 : 1;
+}
+
+int jobs_thread_index(void) {
+    return t_jobIndex;
+}
+
+void jobs_run(JobFunc func, void *arg, JobCounter *done) {
+    Job *job = g_jobs.threadCount > 0 ? job_alloc() : NULL;
+    if (!job) {
+        func(arg);  /* no pool, or every slot queued: run it here */
+        return;
+    }
+    memset(job, 0, sizeof(*job));
+    job->func = func;
+    job->arg  = arg;
+    job->done = done;
+    __atomic_add_fetch(&done->count, 1, __ATOMIC_RELAXED);
+    jobs_push(job);
+}
+
+void jobs_run_after(JobCounter *after, JobFunc func, void *arg,
+                    JobCounter *done) {
+    Job *job = g_jobs.threadCount > 0 ? job_alloc() : NULL;
+    if (!job) {
+        jobs_wait(after);
+        func(arg);
+        return;
+    }
+    memset(job, 0, sizeof(*job));
+    job->func = func;
+    job->arg  = arg;
+    job->done = done;
+    __atomic_add_fetch(&done->count, 1, __ATOMIC_RELAXED);
+
+    counter_lock(after);
+    if (__atomic_load_n(&after->count, __ATOMIC_ACQUIRE) > 0) {
+        job->next = after->waiters;
+        after->waiters = job;
+        job = NULL;
+    }
+    counter_unlock(after);
+    if (job) {
+        jobs_push(job);
+    }
+}
+
+void jobs_run_range(int begin, int end, int grain, JobRangeFunc func,
+                    void *arg, JobCounter *done) {
+    if (grain < 1) {
+        grain = 1;
+    }
+    if (begin >= end) {
+        return;
+    }
+    Job *job = g_jobs.threadCount > 0 ? job_alloc() : NULL;
+    if (!job) {
+        while (end - begin > grain) {
+            func(arg, begin, begin + grain);
+            begin += grain;
+        }
+        func(arg, begin, end);
+        return;
+    }
+    memset(job, 0, sizeof(*job));
+    job->range = func;
+    job->arg   = arg;
+    job->begin = begin;
+    job->end   = end;
+    job->grain = grain;
+    job->done  = done;
+    __atomic_add_fetch(&done->count, 1, __ATOMIC_RELAXED);
+    jobs_push(job);
+}
+
+void jobs_wait(JobCounter *counter) {
+    int self = t_jobIndex;
+    while (__atomic_load_n(&counter->count, __ATOMIC_ACQUIRE) > 0) {
+        Job *job = g_jobs.threadCount > 0 ? jobs_find(self) : NULL;
+        if (job) {
+            job_execute(job, self);
+        } else {
+            sched_yield();
+        }
+    }
+    /* The last release may still hold the lock; let it finish */
+    counter_lock(counter);
+    counter_unlock(counter);
+}
+
+void jobs_parallel_for(int begin, int end, int grain, JobRangeFunc func,
+                       void *arg) {
+    JobCounter done;
+    memset(&done, 0, sizeof(done));
+    jobs_run_range(begin, end, grain, func, arg, &done);
+    jobs_wait(&done);
+}
+
+void jobs_stats(JobStats *out) {
+    memset(out, 0, sizeof(*out));
+    out->threads = jobs_thread_count();
+    if (g_jobs.threadCount == 0) {
+        return;
+    }
+    uint64_t busy = __atomic_load_n(&g_jobs.foreignBusyNs, __ATOMIC_RELAXED);
+    out->jobs = __atomic_load_n(&g_jobs.foreignJobs, __ATOMIC_RELAXED);
+    for (int i = 0; i < g_jobs.threadCount; ++i) {
+        const JobThread *t = &g_jobs.threads[i];
+        busy        += __atomic_load_n(&t->busyNs, __ATOMIC_RELAXED);
+        out->jobs   += __atomic_load_n(&t->jobs, __ATOMIC_RELAXED);
+        out->steals += __atomic_load_n(&t->steals, __ATOMIC_RELAXED);
+    }
+    out->seconds = (double)(now_ns() - g_jobs.startNs) / 1e9;
+    out->busy    = (double)busy / 1e9;
+}
@@ -0,0 +1,87 @@
+/*
+ * Endless Dodge - work-stealing job system.
+ *
+ * One pool of worker threads for the whole program, so subsystems run in
+ * parallel without starting threads of their own. Every pool thread, and
+ * the thread that called jobs_init(), owns a Chase-Lev deque: it pushes and
+ * pops its own jobs at the bottom while idle threads steal from the top.
+ * Other threads hand jobs over through a shared queue.
+ *
+ * Completion is tracked with counters: jobs_run() adds one to a counter
+ * and the job takes it off again when it finishes. A job started with
+ * jobs_run_after() waits for another counter to reach zero first, which is
+ * how dependencies are expressed. jobs_wait() runs other jobs while it
+ * waits, so waiting never idles a core and nested waits cannot deadlock.
+ *
+ * Plain C99 with pthreads and GCC atomics, no SDL, like sim.c.
+ */
+
+#ifndef ENDLESS_DODGE_JOBS_H
+#define ENDLESS_DODGE_JOBS_H
+
+#include <stdint.h>
+
+#define JOBS_MAX_THREADS  64
+#define JOBS_MAX_JOBS     4096   /* queued or running at once; power of two */
+#define JOBS_DEQUE_SIZE   1024   /* per thread; power of two */
+
+typedef void (*JobFunc)(void *arg);
+typedef void (*JobRangeFunc)(void *arg, int begin, int end);
+
+/* Called on each pool thread as it starts and before it exits */
+typedef void (*JobThreadHook)(int index);
+
+struct Job;
+
+/* Unfinished jobs; zero-initialize, and wait for it before it goes away */
+typedef struct {
+    volatile int  count;
+    volatile int  lock;
+    struct Job   *waiters;   /* jobs_run_after() jobs waiting for zero */
+} JobCounter;
+
+typedef struct {
+    int      threads;   /* pool threads plus the one that called jobs_init() */
+    double   seconds;   /* since jobs_init() */
+    double   busy;      /* thread-seconds spent running jobs */
+    uint64_t jobs;      /* jobs run, counting each range split */
+    uint64_t steals;
+} JobStats;
+
+/*
+ * Start `threads` - 1 pool threads (0: one thread per core); the caller is
+ * thread 0. Without a pool, jobs run inline. Returns the thread count.
+ */
+int  jobs_init(int threads, JobThreadHook onStart, JobThreadHook onStop);
+void jobs_shutdown(void);
+
+/* Pool threads plus the initializing thread; 1 without a pool */
+int  jobs_thread_count(void);
+
+/* 0 for the initializing thread, 1... for pool threads, -1 for others */
+int  jobs_thread_index(void);
+
+void jobs_run(JobFunc func, void *arg, JobCounter *done);
+
+/* Run `func` once `after` reaches zero; `done` counts it from now */
+void jobs_run_after(JobCounter *after, JobFunc func, void *arg,
+                    JobCounter *done);
+
+/*
+ * Run func(arg, b, e) over subranges covering [begin, end), none longer
+ * than `grain`. Ranges split in halves as they run, so idle threads steal
+ * large pieces first.
+ */
+void jobs_run_range(int begin, int end, int grain, JobRangeFunc func,
+                    void *arg, JobCounter *done);
+
+/* Wait for `counter` to reach zero, running jobs meanwhile */
+void jobs_wait(JobCounter *counter);
+
+/* jobs_run_range() and wait for it */
+void jobs_parallel_for(int begin, int end, int grain, JobRangeFunc func,
+                       void *arg);
+
+void jobs_stats(JobStats *out);
+
+#endif /* ENDLESS_DODGE_JOBS_H */
@@ -0,0 +1,462 @@
+/*
+ * Endless Dodge - tiny MLP inference for policy bots. See mlp.h.
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L  /* fileno, fsync */
+#endif
+
+#include "mlp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define MLP_AVX2 1
+#else
+#define MLP_AVX2 0
+#endif
+
+#define MLP_FLOAT_LANES  8
+#define MLP_INT8_LANES   32
+#define MLP_INT8_MAX     127.0f
+
+static int round_up(int n, int multiple) {
+    return (n + multiple - 1) / multiple * multiple;
+}
+
+/* ------------------------------- Setup ----------------------------------- */
+
+static void free_layer(MlpLayer *l) {
+    free(l->bias);
+    free(l->weights);
+    free(l->qweights);
+    free(l->qscales);
+    memset(l, 0, sizeof(*l));
+}
+
+int mlp_init(Mlp *mlp, int layerCount, const int *widths, int int8) {
+    memset(mlp, 0, sizeof(*mlp));
+    if (layerCount < 1 || layerCount > MLP_MAX_LAYERS) {
+        return 0;
+    }
+    for (int i = 0; i <= layerCount; ++i) {
+        if (widths[i] < 1 || widths[i] > MLP_MAX_WIDTH) {
+            return 0;
+        }
+    }
+
+    mlp->layerCount = layerCount;
+    mlp->int8 = int8;
+    for (int i = 0; i < layerCount; ++i) {
+        MlpLayer *l = &mlp->layers[i];
+        l->inputs        = widths[i];
+        l->outputs       = widths[i + 1];
+        l->outputsPadded = round_up(l->outputs, MLP_FLOAT_LANES);
+        l->inputsPadded  = round_up(l->inputs, MLP_INT8_LANES);
+        l->relu          = i + 1 < layerCount;
+
+        l->bias = (float *)calloc((size_t)l->outputsPadded, sizeof(float));
+        if (int8) {
+            l->qweights = (int8_t *)calloc((size_t)l->outputs * l->inputsPadded, 1);
+            l->qscales  = (float *)calloc((size_t)l->outputs, sizeof(float));
+        } else {
+            l->weights = (float *)calloc((size_t)l->inputs * l->outputsPadded,
+                                         sizeof(float));
+        }
+        if (!l->bias || (int8 ? !l->qweights || !l->qscales : !l->weights)) {
+            mlp_free(mlp);
+            return 0;
+        }
+
+        if (l->outputsPadded > mlp->maxPadded) mlp->maxPadded = l->outputsPadded;
+        if (l->inputsPadded > mlp->maxPadded)  mlp->maxPadded = l->inputsPadded;
+    }
+    return 1;
+}
+
+void mlp_free(Mlp *mlp) {
+    for (int i = 0; i < MLP_MAX_LAYERS; ++i) {
+        free_layer(&mlp->layers[i]);
+    }
+    mlp->layerCount = 0;
+}
+
+void mlp_set_layer(Mlp *mlp, int layer, const float *weights,
+                   const float *bias) {
+    MlpLayer *l = &mlp->layers[layer];
+
+    memcpy(l->bias, bias, (size_t)l->outputs * sizeof(float));
+    for (int o = 0; o < l->outputs; ++o) {
+        const float *row = weights + (size_t)o * l->inputs;
+        if (!mlp->int8) {
+            for (int k = 0; k < l->inputs; ++k) {
+                l->weights[(size_t)k * l->outputsPadded + o] = row[k];
+            }
+            continue;
+        }
+
+        /* Symmetric, one scale per output so each row uses the full range */
+        float max = 0.0f;
+        for (int k = 0; k < l->inputs; ++k) {
+            float a = fabsf(row[k]);
+            if (a > max) max = a;
+        }
+        float scale = max > 0.0f ? max / MLP_INT8_MAX : 1.0f;
+        int8_t *q = l->qweights + (size_t)o * l->inputsPadded;
+        for (int k = 0; k < l->inputs; ++k) {
+            q[k] = (int8_t)lrintf(row[k] / scale);
+        }
+        l->qscales[o] = scale;
+    }
+}
+
+size_t mlp_param_count(int layerCount, const int *widths) {
+    size_t count = 0;
+    for (int i = 0; i < layerCount; ++i) {
+        count += (size_t)widths[i + 1] * ((size_t)widths[i] + 1);
+    }
+    return count;
+}
+
+int mlp_save(const char *path, int layerCount, const int *widths,
+             uint32_t flags, const float *params) {
+    uint32_t header[4] = { MLP_MAGIC, MLP_VERSION, (uint32_t)layerCount, flags };
+    uint32_t widths32[MLP_MAX_LAYERS + 1];
+    size_t count = mlp_param_count(layerCount, widths);
+
+    if (layerCount < 1 || layerCount > MLP_MAX_LAYERS) {
+        return 0;
+    }
+    for (int i = 0; i <= layerCount; ++i) {
+        widths32[i] = (uint32_t)widths[i];
+    }
+
+    /* Write a temporary file and rename it, so `path` is never half written */
+    size_t pathLength = strlen(path);
+    char *tmp = (char *)malloc(pathLength + 5);
+    if (!tmp) {
+        return 0;
+    }
+    memcpy(tmp, path, pathLength);
+    memcpy(tmp + pathLength, ".tmp", 5);
+
+    FILE *file = fopen(tmp, "wb");
+    if (!file) {
+        free(tmp);
+        return 0;
+    }
+    int ok = fwrite(header, sizeof(header), 1, file) == 1 &&
+             fwrite(widths32, sizeof(uint32_t), (size_t)layerCount + 1, file) ==
+                 (size_t)layerCount + 1 &&
+             fwrite(params, sizeof(float), count, file) == count &&
+             fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok) {
+        remove(tmp);
+    }
+    free(tmp);
+    return ok;
+}
+
+int mlp_probe(const char *path) {
+    FILE *file = fopen(path, "rb");
+    uint32_t magic = 0;
+    if (!file) {
+        return 0;
+    }
+    int ok = fread(&magic, sizeof(magic), 1, file) == 1 && magic == MLP_MAGIC;
+    fclose(file);
+    return ok;
+}
+
+const char *mlp_load(Mlp *mlp, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return "cannot open file";
+    }
+
+    uint32_t header[4];
+    uint32_t widths32[MLP_MAX_LAYERS + 1];
+    int widths[MLP_MAX_LAYERS + 1];
+    const char *error = NULL;
+    float *buffer = NULL;
+
+    if (fread(header, sizeof(header), 1, file) != 1 || header[0] != MLP_MAGIC) {
+        error = "not a policy file";
+    } else if (header[1] != MLP_VERSION) {
+        error = "unsupported version";
+    } else if (header[2] < 1 || header[2] > MLP_MAX_LAYERS ||
+               fread(widths32, sizeof(uint32_t), header[2] + 1, file) !=
+                   header[2] + 1) {
+        error = "bad layer count";
+    }
+
+    int layerCount = error ? 0 : (int)header[2];
+    for (int i = 0; i <= layerCount && !error; ++i) {
+        if (widths32[i] < 1 || widths32[i] > MLP_MAX_WIDTH) {
+            error = "bad layer width";
+        }
+        widths[i] = (int)widths32[i];
+    }
+    if (!error && !mlp_init(mlp, layerCount, widths,
+                            (header[3] & MLP_FLAG_INT8) != 0)) {
+        error = "out of memory";
+    }
+
+    for (int i = 0; i < layerCount && !error; ++i) {
+        size_t weights = (size_t)widths[i] * widths[i + 1];
+        size_t count = weights + (size_t)widths[i + 1];
+        free(buffer);
+        buffer = (float *)malloc(count * sizeof(float));
+        if (!buffer) {
+            error = "out of memory";
+        } else if (fread(buffer, sizeof(float), count, file) != count) {
+            error = "truncated file";
+        } else {
+            mlp_set_layer(mlp, i, buffer, buffer + weights);
+        }
+    }
+
+    free(buffer);
+    fclose(file);
+    if (error && layerCount > 0) {
+        mlp_free(mlp);
+    }
+    return error;
+}
+
+int mlp_scratch_init(MlpScratch *s, const Mlp *mlp, int rows) {
+    size_t cells = (size_t)rows * mlp->maxPadded;
+    s->rows      = rows;
+    s->a         = (float *)malloc(cells * sizeof(float));
+    s->b         = (float *)malloc(cells * sizeof(float));
+    s->q         = (int8_t *)malloc(cells);
+    s->rowScales = (float *)malloc((size_t)rows * sizeof(float));
+    if (!s->a || !s->b || !s->q || !s->rowScales) {
+        mlp_scratch_free(s);
+        return 0;
+    }
+    return 1;
+}
+
+void mlp_scratch_free(MlpScratch *s) {
+    free(s->a);
+    free(s->b);
+    free(s->q);
+    free(s->rowScales);
+    memset(s, 0, sizeof(*s));
+}
+
+size_t mlp_output_stride(const Mlp *mlp) {
+    return (size_t)mlp->layers[mlp->layerCount - 1].outputsPadded;
+}
+
+/* ------------------------------ Float path ------------------------------- */
+
+/* y[rows][outputsPadded] = x[rows][inputs] * W + bias, then ReLU */
+static void layer_float(const MlpLayer *l, const float *x, size_t xs,
+                        int rows, float *y) {
+    const int op = l->outputsPadded;
+    int r = 0;
+
+#if MLP_AVX2
+    /* 4 rows x 8 outputs per tile: each weight load feeds four FMAs */
+    const __m256 zero = _mm256_setzero_ps();
+    for (; r + 4 <= rows; r += 4) {
+        const float *x0 = x + (size_t)r * xs;
+        const float *x1 = x0 + xs;
+        const float *x2 = x1 + xs;
+        const float *x3 = x2 + xs;
+        for (int o = 0; o < op; o += MLP_FLOAT_LANES) {
+            __m256 a0 = _mm256_loadu_ps(l->bias + o);
+            __m256 a1 = a0, a2 = a0, a3 = a0;
+            const float *w = l->weights + o;
+            for (int k = 0; k < l->inputs; ++k, w += op) {
+                __m256 wk = _mm256_loadu_ps(w);
+                a0 = _mm256_fmadd_ps(_mm256_broadcast_ss(x0 + k), wk, a0);
+                a1 = _mm256_fmadd_ps(_mm256_broadcast_ss(x1 + k), wk, a1);
+                a2 = _mm256_fmadd_ps(_mm256_broadcast_ss(x2 + k), wk, a2);
+                a3 = _mm256_fmadd_ps(_mm256_broadcast_ss(x3 + k), wk, a3);
+            }
+            if (l->relu) {
+                a0 = _mm256_max_ps(a0, zero);
+                a1 = _mm256_max_ps(a1, zero);
+                a2 = _mm256_max_ps(a2, zero);
+                a3 = _mm256_max_ps(a3, zero);
+            }
+            float *yr = y + (size_t)r * op + o;
+            _mm256_storeu_ps(yr, a0);
+            _mm256_storeu_ps(yr + op, a1);
+            _mm256_storeu_ps(yr + 2 * op, a2);
+            _mm256_storeu_ps(yr + 3 * op, a3);
+        }
+    }
+#endif
+
+    for (; r < rows; ++r) {
+        const float *xr = x + (size_t)r * xs;
+        float *yr = y + (size_t)r * op;
+        memcpy(yr, l->bias, (size_t)op * sizeof(float));
+        for (int k = 0; k < l->inputs; ++k) {
+            const float *w = l->weights + (size_t)k * op;
+            float xk = xr[k];
+            for (int o = 0; o < op; ++o) {
+                yr[o] += xk * w[o];
+            }
+        }
+        if (l->relu) {
+            for (int o = 0; o < op; ++o) {
+                yr[o] = yr[o] > 0.0f ? yr[o] : 0.0f;
+            }
+        }
+    }
+}
+
+/* ------------------------------ Int8 path -------------------------------- */
+
+/* Quantize each row's first `n` values with its own symmetric scale */
+static void quantize_rows(const float *x, size_t xs, int rows, int n,
+                          int np, int8_t *q, float *scales) {
+    for (int r = 0; r < rows; ++r) {
+        const float *xr = x + (size_t)r * xs;
+        int8_t *qr = q + (size_t)r * np;
+        float max = 0.0f;
+        for (int k = 0; k < n; ++k) {
+            float a = fabsf(xr[k]);
+            if (a > max) max = a;
+        }
+        float scale = max > 0.0f ? max / MLP_INT8_MAX : 1.0f;
+        float inv = 1.0f / scale;
+        for (int k = 0; k < n; ++k) {
+            /* Round half away from zero; unlike lrintf() this vectorizes */
+            float v = xr[k] * inv;
+            qr[k] = (int8_t)(int)(v + (v < 0.0f ? -0.5f : 0.5f));
+        }
+        memset(qr + n, 0, (size_t)(np - n));
+        scales[r] = scale;
+    }
+}
+
+/* Finish row `r` from output `first` on, one dot product at a time */
+static void layer_int8_tail(const MlpLayer *l, const MlpScratch *s, int r,
+                            int first, float *yr) {
+    const int np = l->inputsPadded;
+    const int8_t *qr = s->q + (size_t)r * np;
+
+    for (int o = first; o < l->outputs; ++o) {
+        const int8_t *w = l->qweights + (size_t)o * np;
+        int32_t dot = 0;
+        for (int k = 0; k < l->inputs; ++k) {
+            dot += (int32_t)qr[k] * w[k];
+        }
+        float v = (float)dot * s->rowScales[r] * l->qscales[o] + l->bias[o];
+        yr[o] = l->relu && v < 0.0f ? 0.0f : v;
+    }
+    for (int o = l->outputs; o < l->outputsPadded; ++o) {
+        yr[o] = 0.0f;
+    }
+}
+
+#if MLP_AVX2
+/* The four horizontal sums of d[0..3], in order */
+static __m128i hsum4_epi32(const __m256i *d) {
+    __m256i s = _mm256_hadd_epi32(_mm256_hadd_epi32(d[0], d[1]),
+                                  _mm256_hadd_epi32(d[2], d[3]));
+    return _mm_add_epi32(_mm256_castsi256_si128(s),
+                         _mm256_extracti128_si256(s, 1));
+}
+
+/*
+ * maddubs multiplies unsigned by signed bytes, so feed it |a| and w with a's
+ * sign moved onto it. Both sides stay within +-127, so the pairwise int16
+ * sums cannot saturate.
+ */
+static __m256i dot_step(__m256i acc, __m256i absA, __m256i a, __m256i w,
+                        __m256i ones) {
+    __m256i pairs = _mm256_maddubs_epi16(absA, _mm256_sign_epi8(w, a));
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, ones));
+}
+#endif
+
+static void layer_int8(const MlpLayer *l, const float *x, size_t xs,
+                       int rows, float *y, MlpScratch *s) {
+    const int np = l->inputsPadded;
+    const int op = l->outputsPadded;
+    quantize_rows(x, xs, rows, l->inputs, np, s->q, s->rowScales);
+
+    int r = 0;
+#if MLP_AVX2
+    /* 2 rows x 4 outputs per tile; the four sums of a row reduce together */
+    const __m256i ones = _mm256_set1_epi16(1);
+    const int outputs4 = l->outputs & ~3;
+    for (; r + 2 <= rows; r += 2) {
+        const int8_t *q0 = s->q + (size_t)r * np;
+        const int8_t *q1 = q0 + np;
+        for (int o = 0; o < outputs4; o += 4) {
+            const int8_t *w = l->qweights + (size_t)o * np;
+            __m256i d[8];
+            for (int i = 0; i < 8; ++i) {
+                d[i] = _mm256_setzero_si256();
+            }
+            for (int k = 0; k < np; k += MLP_INT8_LANES) {
+                __m256i a0 = _mm256_loadu_si256((const __m256i *)(q0 + k));
+                __m256i a1 = _mm256_loadu_si256((const __m256i *)(q1 + k));
+                __m256i abs0 = _mm256_abs_epi8(a0);
+                __m256i abs1 = _mm256_abs_epi8(a1);
+                for (int j = 0; j < 4; ++j) {
+                    __m256i wj = _mm256_loadu_si256(
+                        (const __m256i *)(w + (size_t)j * np + k));
+                    d[j]     = dot_step(d[j], abs0, a0, wj, ones);
+                    d[4 + j] = dot_step(d[4 + j], abs1, a1, wj, ones);
+                }
+            }
+            __m128 scales = _mm_loadu_ps(l->qscales + o);
+            __m128 bias = _mm_loadu_ps(l->bias + o);
+            for (int i = 0; i < 2; ++i) {
+                __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(hsum4_epi32(d + 4 * i)),
+                                      _mm_mul_ps(scales,
+                                                 _mm_set1_ps(s->rowScales[r + i])));
+                v = _mm_add_ps(v, bias);
+                if (l->relu) {
+                    v = _mm_max_ps(v, _mm_setzero_ps());
+                }
+                _mm_storeu_ps(y + (size_t)(r + i) * op + o, v);
+            }
+        }
+        for (int i = 0; i < 2; ++i) {
+            layer_int8_tail(l, s, r + i, outputs4, y + (size_t)(r + i) * op);
+        }
+    }
+#endif
+
+    for (; r < rows; ++r) {
+        layer_int8_tail(l, s, r, 0, y + (size_t)r * op);
+    }
+}
+
+/* ------------------------------- Forward --------------------------------- */
+
+const float *mlp_forward(const Mlp *mlp, MlpScratch *s, const float *input,
+                         size_t inputStride, int rows) {
+    const float *x = input;
+    size_t xs = inputStride;
+
+    for (int i = 0; i < mlp->layerCount; ++i) {
+        const MlpLayer *l = &mlp->layers[i];
+        float *y = (i & 1) ? s->b : s->a;
+        if (mlp->int8) {
+            layer_int8(l, x, xs, rows, y, s);
+        } else {
+            layer_float(l, x, xs, rows, y);
+        }
+        x = y;
+        xs = (size_t)l->outputsPadded;
+    }
+    return x;
+}
@@ -0,0 +1,96 @@
+/*
+ * Endless Dodge - tiny MLP inference for policy bots.
+ *
+ * Dense layers with ReLU between them and a linear output layer, evaluated
+ * for a whole batch of rows at once: one matrix product per layer. There
+ * are two paths: float (FMA on AVX2 builds) and int8 (per-output weight
+ * scales, inputs quantized per row as they enter each layer). Plain C99
+ * with no SDL dependency, like sim.c.
+ *
+ * Weight file, all fields in host byte order:
+ *
+ *     u32 magic (MLP_MAGIC), u32 version, u32 layer count, u32 flags
+ *     u32 widths[layer count + 1]         inputs first, outputs last
+ *     per layer: f32 weights[out][in], then f32 bias[out]
+ *
+ * Flag MLP_FLAG_INT8 asks for int8 inference.
+ */
+
+#ifndef ENDLESS_DODGE_MLP_H
+#define ENDLESS_DODGE_MLP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MLP_MAGIC       0x4E4E4445u  /* "EDNN" */
+#define MLP_VERSION     1
+#define MLP_MAX_LAYERS  8
+#define MLP_MAX_WIDTH   4096
+#define MLP_FLAG_INT8   1u
+
+typedef struct {
+    int      inputs;
+    int      outputs;
+    int      outputsPadded;  /* multiple of 8: one AVX register */
+    int      inputsPadded;   /* multiple of 32: one AVX register of int8 */
+    int      relu;
+    float   *bias;           /* [outputsPadded], zero past outputs */
+    float   *weights;        /* float: [inputs][outputsPadded], transposed */
+    int8_t  *qweights;       /* int8: [outputs][inputsPadded] */
+    float   *qscales;        /* int8: weight scale per output */
+} MlpLayer;
+
+typedef struct {
+    int       layerCount;
+    int       int8;
+    int       maxPadded;     /* widest padded layer, for scratch sizing */
+    MlpLayer  layers[MLP_MAX_LAYERS];
+} Mlp;
+
+/* Per-thread buffers for mlp_forward() on up to `rows` rows */
+typedef struct {
+    int      rows;
+    float   *a;
+    float   *b;
+    int8_t  *q;
+    float   *rowScales;
+} MlpScratch;
+
+/*
+ * Allocate a network; `widths` has layerCount + 1 entries. Every layer but
+ * the last is followed by ReLU. Parameters start at zero.
+ */
+int    mlp_init(Mlp *mlp, int layerCount, const int *widths, int int8);
+void   mlp_free(Mlp *mlp);
+
+/* Set one layer from row-major weights[out][in] and bias[out] */
+void   mlp_set_layer(Mlp *mlp, int layer, const float *weights,
+                     const float *bias);
+
+/* Number of floats a flat parameter vector holds (all layers, file order) */
+size_t mlp_param_count(int layerCount, const int *widths);
+
+/* Load a weight file; returns NULL on success, otherwise what went wrong */
+const char *mlp_load(Mlp *mlp, const char *path);
+
+/* Write a weight file from a flat parameter vector in file order, through
+   `<path>.tmp` and a rename so readers never see a partial file */
+int    mlp_save(const char *path, int layerCount, const int *widths,
+                uint32_t flags, const float *params);
+
+/* 1 if the file starts with MLP_MAGIC */
+int    mlp_probe(const char *path);
+
+int    mlp_scratch_init(MlpScratch *s, const Mlp *mlp, int rows);
+void   mlp_scratch_free(MlpScratch *s);
+
+/*
+ * Evaluate `rows` input rows, `inputStride` floats apart. Returns the outputs,
+ * rows of mlp_output_stride() floats in the scratch; valid until its next use.
+ */
+const float *mlp_forward(const Mlp *mlp, MlpScratch *s, const float *input,
+                         size_t inputStride, int rows);
+
+size_t mlp_output_stride(const Mlp *mlp);
+
+#endif /* ENDLESS_DODGE_MLP_H */
@@ -0,0 +1,1054 @@
+/*
+ * Endless Dodge - headless simulation core. See sim.h.
+ */
+
+#include "sim.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* -------------------------- Utility Functions ---------------------------- */
+
+static float clampf(float v, float min, float max) {
+    if (v < min) return min;
+    if (v > max) return max;
+    return v;
+}
+
+/* Simple AABB collision check */
+int rects_intersect(float x1, float y1, float w1, float h1,
+                    float x2, float y2, float w2, float h2) {
+    return !(x1 > x2 + w2 ||
+             x1 + w1 < x2 ||
+             y1 > y2 + h2 ||
+             y1 + h1 < y2);
+}
+
+/* Move the player horizontally by one tick and keep it on screen */
+static float advance_player_x(float x, float dir, float speed, float w, float dt) {
+    x += dir * speed * dt;
+    return clampf(x, 0.0f, (float)WINDOW_WIDTH - w);
+}
+
+/* xorshift32: per-run, so runs are reproducible and independent */
+static uint32_t sim_rand(Sim *sim) {
+    uint32_t x = sim->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sim->rng = x;
+    return x;
+}
+
+/* Random float in [min, max] */
+static float rand_range(Sim *sim, float min, float max) {
+    float t = (float)(sim_rand(sim) >> 8) / (float)((1u << 24) - 1);
+    return min + t * (max - min);
+}
+
+/* ------------------------------ Killcam ---------------------------------- */
+
+enum {
+    KILLCAM_OP_KEYFRAME = 1,  /* f32 player x, u8 n, n x (u8 slot, f32 x y w speed) */
+    KILLCAM_OP_RUN,           /* u8 tick quanta, s8 dir, u16 tick count */
+    KILLCAM_OP_SPAWN,         /* u8 slot, f32 x, f32 w, f32 speed */
+    KILLCAM_OP_RETIRE         /* u8 slot */
+};
+
+static void killcam_put(Killcam *kc, const void *data, uint32_t len) {
+    const uint8_t *src = (const uint8_t *)data;
+    for (uint32_t i = 0; i < len; ++i) {
+        kc->ring[(kc->writePos + i) & (KILLCAM_RING_SIZE - 1)] = src[i];
+    }
+    kc->writePos += len;
+}
+
+static void killcam_get(const Killcam *kc, uint32_t *pos, void *data, uint32_t len) {
+    uint8_t *dst = (uint8_t *)data;
+    for (uint32_t i = 0; i < len; ++i) {
+        dst[i] = kc->ring[(*pos + i) & (KILLCAM_RING_SIZE - 1)];
+    }
+    *pos += len;
+}
+
+static void killcam_put_u8(Killcam *kc, uint8_t v) {
+    killcam_put(kc, &v, 1);
+}
+
+static void killcam_put_f32(Killcam *kc, float v) {
+    killcam_put(kc, &v, sizeof(v));
+}
+
+/* Close the open run so later ticks start a new record */
+static void killcam_end_run(Killcam *kc) {
+    kc->runOpen = 0;
+}
+
+void killcam_reset(Killcam *kc) {
+    kc->writePos = 0;
+    kc->keyframeCount = 0;
+    kc->lastKeyframeUs = 0;
+    killcam_end_run(kc);
+}
+
+/* A keyframe is usable while none of its bytes have been overwritten */
+static int killcam_keyframe_valid(const Killcam *kc, const KillcamKeyframe *k) {
+    return kc->writePos - k->pos <= KILLCAM_RING_SIZE;
+}
+
+static void killcam_write_keyframe(Killcam *kc, const Sim *sim) {
+    KillcamKeyframe *k =
+        &kc->keyframes[kc->keyframeCount++ & (KILLCAM_MAX_KEYFRAMES - 1)];
+    k->pos = kc->writePos;
+    k->timeUs = sim->simTimeUs;
+    kc->lastKeyframeUs = sim->simTimeUs;
+
+    uint8_t count = 0;
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        count += sim->obstacles[i].active ? 1 : 0;
+    }
+
+    killcam_put_u8(kc, KILLCAM_OP_KEYFRAME);
+    killcam_put_f32(kc, sim->player.x);
+    killcam_put_u8(kc, count);
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        const Obstacle *o = &sim->obstacles[i];
+        if (!o->active) continue;
+        killcam_put_u8(kc, (uint8_t)i);
+        killcam_put_f32(kc, o->x);
+        killcam_put_f32(kc, o->y);
+        killcam_put_f32(kc, o->w);
+        killcam_put_f32(kc, o->speed);
+    }
+    killcam_end_run(kc);
+}
+
+/*
+ * Record the start of a sim tick. In the common case this only bumps the
+ * open run's counter; a new record is written when the tick length or the
+ * player's direction changes, or after an event closed the run.
+ */
+static void killcam_tick(Killcam *kc, const Sim *sim, uint32_t tickUs, float dir) {
+    if (kc->keyframeCount == 0 ||
+        sim->simTimeUs - kc->lastKeyframeUs >= KILLCAM_KEYFRAME_US) {
+        killcam_write_keyframe(kc, sim);
+    }
+
+    uint8_t quanta = (uint8_t)(tickUs / SIM_TICK_QUANTUM_US);
+    int8_t sdir = (int8_t)dir;
+    if (kc->runOpen && kc->runQuanta == quanta && kc->runDir == sdir &&
+        kc->runCount < 0xFFFF) {
+        ++kc->runCount;
+        uint32_t pos = kc->runPos;
+        for (uint32_t i = 0; i < sizeof(kc->runCount); ++i) {
+            kc->ring[(pos + i) & (KILLCAM_RING_SIZE - 1)] =
+                ((const uint8_t *)&kc->runCount)[i];
+        }
+        return;
+    }
+
+    kc->runOpen   = 1;
+    kc->runQuanta = quanta;
+    kc->runDir    = sdir;
+    kc->runCount  = 1;
+    killcam_put_u8(kc, KILLCAM_OP_RUN);
+    killcam_put_u8(kc, quanta);
+    killcam_put(kc, &sdir, 1);
+    kc->runPos = kc->writePos;
+    killcam_put(kc, &kc->runCount, sizeof(kc->runCount));
+}
+
+static void killcam_spawn(Killcam *kc, const SimEvent *e) {
+    killcam_put_u8(kc, KILLCAM_OP_SPAWN);
+    killcam_put_u8(kc, e->slot);
+    killcam_put_f32(kc, e->x);
+    killcam_put_f32(kc, e->w);
+    killcam_put_f32(kc, e->speed);
+    killcam_end_run(kc);
+}
+
+static void killcam_retire(Killcam *kc, const SimEvent *e) {
+    killcam_put_u8(kc, KILLCAM_OP_RETIRE);
+    killcam_put_u8(kc, e->slot);
+    killcam_end_run(kc);
+}
+
+/* Subscriber: log the tick's spawns and retirements */
+static void killcam_record_events(Killcam *kc, const SimEvent *events, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (events[i].type == SIM_EVENT_SPAWNED) {
+            killcam_spawn(kc, &events[i]);
+        } else if (events[i].type == SIM_EVENT_DODGED) {
+            killcam_retire(kc, &events[i]);
+        }
+    }
+}
+
+/* Decode one record at kc->readPos into the playback view */
+static void killcam_read_record(Killcam *kc) {
+    uint8_t op = 0;
+    uint8_t slot = 0;
+
+    killcam_get(kc, &kc->readPos, &op, 1);
+    switch (op) {
+        case KILLCAM_OP_KEYFRAME: {
+            uint8_t count = 0;
+            killcam_get(kc, &kc->readPos, &kc->viewPlayer.x, sizeof(float));
+            killcam_get(kc, &kc->readPos, &count, 1);
+            for (int i = 0; i < MAX_OBSTACLES; ++i) {
+                kc->viewObstacles[i].active = 0;
+            }
+            for (int i = 0; i < count; ++i) {
+                killcam_get(kc, &kc->readPos, &slot, 1);
+                Obstacle *o = &kc->viewObstacles[slot % MAX_OBSTACLES];
+                killcam_get(kc, &kc->readPos, &o->x, sizeof(float));
+                killcam_get(kc, &kc->readPos, &o->y, sizeof(float));
+                killcam_get(kc, &kc->readPos, &o->w, sizeof(float));
+                killcam_get(kc, &kc->readPos, &o->speed, sizeof(float));
+                o->h = OBSTACLE_HEIGHT;
+                o->active = 1;
+            }
+            break;
+        }
+        case KILLCAM_OP_RUN: {
+            uint8_t quanta = 0;
+            int8_t dir = 0;
+            uint16_t count = 0;
+            killcam_get(kc, &kc->readPos, &quanta, 1);
+            killcam_get(kc, &kc->readPos, &dir, 1);
+            killcam_get(kc, &kc->readPos, &count, sizeof(count));
+            kc->pendingTicks  = count;
+            kc->pendingTickUs = (uint32_t)quanta * SIM_TICK_QUANTUM_US;
+            kc->pendingDir    = (float)dir;
+            break;
+        }
+        case KILLCAM_OP_SPAWN: {
+            killcam_get(kc, &kc->readPos, &slot, 1);
+            Obstacle *o = &kc->viewObstacles[slot % MAX_OBSTACLES];
+            killcam_get(kc, &kc->readPos, &o->x, sizeof(float));
+            killcam_get(kc, &kc->readPos, &o->w, sizeof(float));
+            killcam_get(kc, &kc->readPos, &o->speed, sizeof(float));
+            o->h = OBSTACLE_HEIGHT;
+            o->y = -o->h;
+            o->active = 1;
+            break;
+        }
+        case KILLCAM_OP_RETIRE:
+            killcam_get(kc, &kc->readPos, &slot, 1);
+            kc->viewObstacles[slot % MAX_OBSTACLES].active = 0;
+            break;
+        default:
+            /* Corrupt stream; end playback */
+            kc->readPos = kc->endPos;
+            break;
+    }
+}
+
+/* Re-run one recorded tick with the same arithmetic as the sim */
+static void killcam_replay_tick(Killcam *kc) {
+    float dt = (float)kc->pendingTickUs / 1000000.0f;
+
+    kc->viewPlayer.x = advance_player_x(kc->viewPlayer.x, kc->pendingDir,
+                                        kc->viewPlayer.speed,
+                                        kc->viewPlayer.w, dt);
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        Obstacle *o = &kc->viewObstacles[i];
+        if (o->active) {
+            o->y += o->speed * dt;
+        }
+    }
+
+    kc->playUs += kc->pendingTickUs;
+    --kc->pendingTicks;
+}
+
+int killcam_start_playback(Killcam *kc, const Sim *sim) {
+    const KillcamKeyframe *start = NULL;
+    int first = kc->keyframeCount > KILLCAM_MAX_KEYFRAMES
+                    ? kc->keyframeCount - KILLCAM_MAX_KEYFRAMES : 0;
+
+    /* Newest keyframe at least a full window back, else the oldest intact */
+    for (int i = kc->keyframeCount - 1; i >= first; --i) {
+        const KillcamKeyframe *k =
+            &kc->keyframes[i & (KILLCAM_MAX_KEYFRAMES - 1)];
+        if (!killcam_keyframe_valid(kc, k)) {
+            break;
+        }
+        start = k;
+        if (sim->simTimeUs - k->timeUs >= KILLCAM_WINDOW_US) {
+            break;
+        }
+    }
+    if (!start) {
+        return 0;
+    }
+
+    kc->viewPlayer = sim->player;
+    kc->readPos = start->pos;
+    kc->endPos  = kc->writePos;
+    kc->playUs  = 0;
+    kc->clockUs = 0;
+    kc->pendingTicks = 0;
+    killcam_read_record(kc);
+    return 1;
+}
+
+int killcam_advance(Killcam *kc, uint32_t us) {
+    kc->clockUs += us;
+    while (kc->playUs < kc->clockUs) {
+        if (kc->pendingTicks > 0) {
+            killcam_replay_tick(kc);
+        } else if (kc->readPos != kc->endPos) {
+            killcam_read_record(kc);
+        } else {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* ------------------------------- Events ---------------------------------- */
+
+SimEvent *sim_emit(Sim *sim, SimEventType type) {
+    SimEvent *e = &sim->events[sim->eventCount];
+    if (sim->eventCount < SIM_MAX_EVENTS) {
+        ++sim->eventCount;
+    }
+    memset(e, 0, sizeof(*e));
+    e->type = (uint8_t)type;
+    e->timeUs = sim->simTimeUs;
+    return e;
+}
+
+void sim_clear_events(Sim *sim) {
+    sim->eventCount = 0;
+}
+
+/* Subscriber: dodging an obstacle is worth 10 points */
+static void sim_score_events(Sim *sim, const SimEvent *events, int count) {
+    for (int i = 0; i < count; ++i) {
+        sim->score += events[i].type == SIM_EVENT_DODGED ? SIM_DODGE_POINTS : 0;
+    }
+}
+
+/* -------------------------------- Timers --------------------------------- */
+
+#define TIMER_SLOT_MASK  ((uint64_t)SIM_TIMER_SLOTS - 1)
+#define TIMER_ALL_IDS    (SIM_MAX_TIMERS < 32 ? (1u << SIM_MAX_TIMERS) - 1 \
+                                              : 0xFFFFFFFFu)
+
+static void timer_wheel_reset(SimTimerWheel *w, uint64_t now) {
+    w->now      = now;
+    w->occupied = 0;
+    w->freeMask = TIMER_ALL_IDS;
+    memset(w->heads, SIM_TIMER_NONE, sizeof(w->heads));
+}
+
+/* File a timer at the lowest level whose span from `now` reaches it */
+static void timer_link(SimTimerWheel *w, int id) {
+    SimTimer *t = &w->timers[id];
+    uint64_t key = t->due > w->now ? t->due : w->now;
+
+    int level = 0;
+    while (level < SIM_TIMER_LEVELS - 1 &&
+           key >> (SIM_TIMER_BITS * (level + 1)) !=
+           w->now >> (SIM_TIMER_BITS * (level + 1))) {
+        ++level;
+    }
+    int slot = (int)((key >> (SIM_TIMER_BITS * level)) & TIMER_SLOT_MASK);
+
+    /* Keep the slot in id order; it rarely holds more than one or two */
+    uint8_t *head = &w->heads[level][slot];
+    uint8_t prev = SIM_TIMER_NONE, next = *head;
+    while (next != SIM_TIMER_NONE && next < id) {
+        prev = next;
+        next = w->timers[next].next;
+    }
+    t->level = (uint8_t)level;
+    t->slot  = (uint8_t)slot;
+    t->prev  = prev;
+    t->next  = next;
+    if (prev != SIM_TIMER_NONE) {
+        w->timers[prev].next = (uint8_t)id;
+    } else {
+        *head = (uint8_t)id;
+    }
+    if (next != SIM_TIMER_NONE) {
+        w->timers[next].prev = (uint8_t)id;
+    }
+    if (level == 0) {
+        w->occupied |= 1ull << slot;
+    }
+}
+
+static void timer_unlink(SimTimerWheel *w, int id) {
+    SimTimer *t = &w->timers[id];
+    if (t->prev != SIM_TIMER_NONE) {
+        w->timers[t->prev].next = t->next;
+    } else {
+        w->heads[t->level][t->slot] = t->next;
+    }
+    if (t->next != SIM_TIMER_NONE) {
+        w->timers[t->next].prev = t->prev;
+    }
+    if (t->level == 0 && w->heads[0][t->slot] == SIM_TIMER_NONE) {
+        w->occupied &= ~(1ull << t->slot);
+    }
+}
+
+/*
+ * `now` just entered a new first-level slot block: re-file the slots that
+ * come round at each level crossed, top down, so a timer can drop several
+ * levels at once.
+ */
+static void timer_cascade(SimTimerWheel *w) {
+    int top = 1;
+    while (top < SIM_TIMER_LEVELS - 1 &&
+           ((w->now >> (SIM_TIMER_BITS * top)) & TIMER_SLOT_MASK) == 0) {
+        ++top;
+    }
+    for (int level = top; level >= 1; --level) {
+        int slot = (int)((w->now >> (SIM_TIMER_BITS * level)) & TIMER_SLOT_MASK);
+        uint8_t id = w->heads[level][slot];
+        w->heads[level][slot] = SIM_TIMER_NONE;
+        while (id != SIM_TIMER_NONE) {
+            uint8_t next = w->timers[id].next;
+            timer_link(w, id);
+            id = next;
+        }
+    }
+}
+
+static int timer_start_at(Sim *sim, int kind, uint64_t due) {
+    SimTimerWheel *w = &sim->timers;
+    if (!w->freeMask) {
+        return -1;
+    }
+    int id = __builtin_ctz(w->freeMask);
+    w->freeMask &= w->freeMask - 1;
+    w->timers[id].due  = due;
+    w->timers[id].kind = (uint8_t)kind;
+    timer_link(w, id);
+    return id;
+}
+
+int sim_timer_start(Sim *sim, int kind, uint64_t delayUs) {
+    uint64_t due = (sim->simTimeUs + delayUs + SIM_TICK_QUANTUM_US - 1) /
+                   SIM_TICK_QUANTUM_US;
+    return timer_start_at(sim, kind, due);
+}
+
+void sim_timer_cancel(Sim *sim, int id) {
+    SimTimerWheel *w = &sim->timers;
+    if (id < 0 || id >= SIM_MAX_TIMERS || (w->freeMask & (1u << id))) {
+        return;
+    }
+    timer_unlink(w, id);
+    w->freeMask |= 1u << id;
+}
+
+/*
+ * Schedule the next spawn at the first quantum a full interval after the
+ * last one. After a spawn that found no free slot that has passed, so it
+ * retries on the next quantum.
+ */
+static void schedule_spawn(Sim *sim) {
+    uint32_t interval = sim_difficulty(sim->simTimeUs,
+                                       sim->spawnCount).spawnIntervalUs;
+    uint64_t due = (sim->lastSpawnUs + interval + SIM_TICK_QUANTUM_US - 1) /
+                   SIM_TICK_QUANTUM_US;
+    if (due <= sim->timers.now) {
+        due = sim->timers.now + 1;
+    }
+    timer_start_at(sim, SIM_TIMER_SPAWN, due);
+}
+
+/* ---------------------------- Run Setup ---------------------------------- */
+
+static void reset_obstacles(Sim *sim) {
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        sim->obstacles[i].active = 0;
+    }
+}
+
+/* Initialize player in the center-bottom of the screen */
+static void init_player(Sim *sim) {
+    sim->player.w = PLAYER_WIDTH;
+    sim->player.h = PLAYER_HEIGHT;
+    sim->player.x = (WINDOW_WIDTH - PLAYER_WIDTH) / 2.0f;
+    sim->player.y = WINDOW_HEIGHT - PLAYER_HEIGHT - 40.0f;
+    sim->player.speed = PLAYER_SPEED;
+}
+
+void sim_reset(Sim *sim, uint32_t seed) {
+    sim->score           = 0;
+    sim->simTimeUs       = 0;
+    sim->lastSpawnUs     = 0;
+    sim->spawnCount      = 0;
+    sim->rng             = seed ? seed : 0x9E3779B9u;
+
+    init_player(sim);
+    reset_obstacles(sim);
+    sim_clear_events(sim);
+    timer_wheel_reset(&sim->timers, 0);
+    schedule_spawn(sim);
+    if (sim->killcam) {
+        killcam_reset(sim->killcam);
+    }
+}
+
+/* --------------------------- Obstacle Logic ------------------------------ */
+
+/*
+ * Spawn interval after n spawns, for every n above the floor. Each entry
+ * decays the previous one by OBSTACLE_INTERVAL_DECAY per mille, carried in
+ * nanoseconds so the steps keep their remainders, then truncated to µs.
+ * Generated from the constants below; regenerate it if they change.
+ */
+#define SIM_INTERVAL_STEPS 107
+typedef char sim_interval_table_is_current[
+    OBSTACLE_BASE_INTERVAL_US == 700000 && OBSTACLE_MIN_INTERVAL_US == 140000 &&
+    OBSTACLE_INTERVAL_DECAY == 985 ? 1 : -1];
+
+static const uint32_t g_spawnIntervalUs[SIM_INTERVAL_STEPS] = {
+    700000, 689500, 679157, 668970, 658935, 649051, 639315, 629726,
+    620280, 610975, 601811, 592784, 583892, 575133, 566506, 558009,
+    549639, 541394, 533273, 525274, 517395, 509634, 501990, 494460,
+    487043, 479737, 472541, 465453, 458471, 451594, 444820, 438148,
+    431576, 425102, 418725, 412445, 406258, 400164, 394162, 388249,
+    382425, 376689, 371039, 365473, 359991, 354591, 349272, 344033,
+    338873, 333789, 328783, 323851, 318993, 314208, 309495, 304853,
+    300280, 295776, 291339, 286969, 282664, 278424, 274248, 270134,
+    266082, 262091, 258160, 254287, 250473, 246716, 243015, 239370,
+    235779, 232243, 228759, 225328, 221948, 218618, 215339, 212109,
+    208927, 205793, 202707, 199666, 196671, 193721, 190815, 187953,
+    185134, 182357, 179621, 176927, 174273, 171659, 169084, 166548,
+    164049, 161589, 159165, 156777, 154426, 152109, 149828, 147580,
+    145367, 143186, 141038,
+};
+
+SimDifficulty sim_difficulty(uint64_t simTimeUs, uint32_t spawnCount) {
+    SimDifficulty d;
+    d.fallSpeedMpx = OBSTACLE_BASE_SPEED_MPX +
+                     simTimeUs * OBSTACLE_SPEED_GAIN_MPX / 1000000;
+
+    d.spawnIntervalUs = spawnCount < SIM_INTERVAL_STEPS
+                            ? g_spawnIntervalUs[spawnCount]
+                            : OBSTACLE_MIN_INTERVAL_US;
+    return d;
+}
+
+int sim_survival_points(uint64_t simTimeUs) {
+    return (int)(simTimeUs / SIM_SURVIVAL_POINT_US);
+}
+
+/* Fall speed of an obstacle spawned now, in px/s */
+float obstacle_spawn_speed(const Sim *sim) {
+    return (float)sim_difficulty(sim->simTimeUs, 0).fallSpeedMpx / 1000.0f;
+}
+
+void spawn_obstacle(Sim *sim, uint64_t atUs) {
+    /* Find an inactive obstacle slot */
+    int idx = -1;
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        if (!sim->obstacles[i].active) {
+            idx = i;
+            break;
+        }
+    }
+    if (idx == -1) {
+        /* No space; skip this spawn */
+        return;
+    }
+
+    Obstacle *o = &sim->obstacles[idx];
+    o->w = rand_range(sim, OBSTACLE_MIN_WIDTH, OBSTACLE_MAX_WIDTH);
+    o->h = OBSTACLE_HEIGHT;
+
+    /* Keep the obstacle fully inside the screen horizontally */
+    float maxX = (float)WINDOW_WIDTH - o->w;
+    o->x = rand_range(sim, 0.0f, maxX);
+    o->y = -o->h;  /* start above screen */
+
+    o->speed = (float)sim_difficulty(atUs, 0).fallSpeedMpx / 1000.0f;
+
+    o->active = 1;
+    sim->lastSpawnUs = atUs;
+    ++sim->spawnCount;
+
+    SimEvent *e = sim_emit(sim, SIM_EVENT_SPAWNED);
+    e->slot  = (uint8_t)idx;
+    e->x     = o->x;
+    e->w     = o->w;
+    e->speed = o->speed;
+}
+
+/* Update all active obstacles */
+void update_obstacles(Sim *sim, float dt) {
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        Obstacle *o = &sim->obstacles[i];
+        if (!o->active) {
+            continue;
+        }
+
+        o->y += o->speed * dt;
+
+        /* Deactivate if off-screen */
+        if (o->y > WINDOW_HEIGHT) {
+            o->active = 0;
+            sim_emit(sim, SIM_EVENT_DODGED)->slot = (uint8_t)i;
+        }
+    }
+}
+
+/* Check if any obstacle hits the player */
+int check_collisions(Sim *sim) {
+    const Player *p = &sim->player;
+
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        Obstacle *o = &sim->obstacles[i];
+        if (!o->active) {
+            continue;
+        }
+
+        if (rects_intersect(p->x, p->y, p->w, p->h,
+                            o->x, o->y, o->w, o->h)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* ---------------------------- Kernel Variants ---------------------------- */
+
+/*
+ * Alternative implementations of the hot kernels above. The scalar versions
+ * stay the reference: a variant is only fit for use once `--verify-kernels`
+ * shows it agrees with them on every generated configuration.
+ */
+
+#if MAX_OBSTACLES % 4 != 0
+#error "MAX_OBSTACLES must be a multiple of 4 for the 4-wide kernels"
+#endif
+
+/* Same comparisons as rects_intersect(), evaluated without short-circuits */
+int rects_intersect_branchless(float x1, float y1, float w1, float h1,
+                               float x2, float y2, float w2, float h2) {
+    return (x1 <= x2 + w2) & (x1 + w1 >= x2) &
+           (y1 <= y2 + h2) & (y1 + h1 >= y2);
+}
+
+int check_collisions_branchless(Sim *sim) {
+    const Player *p = &sim->player;
+    int hit = 0;
+
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        const Obstacle *o = &sim->obstacles[i];
+        hit |= (o->active != 0) &
+               rects_intersect_branchless(p->x, p->y, p->w, p->h,
+                                          o->x, o->y, o->w, o->h);
+    }
+
+    return hit;
+}
+
+static fixed_t to_fixed(float v) {
+    return (fixed_t)lrintf(v * (float)FIXED_ONE);
+}
+
+int float_on_fixed_grid(float v) {
+    float scaled = v * (float)FIXED_ONE;
+    return fabsf(v) <= FIXED_MAX_COORD && scaled == floorf(scaled);
+}
+
+static int rects_intersect_fixed(fixed_t x1, fixed_t y1, fixed_t w1, fixed_t h1,
+                                 fixed_t x2, fixed_t y2, fixed_t w2, fixed_t h2) {
+    return !(x1 > x2 + w2 ||
+             x1 + w1 < x2 ||
+             y1 > y2 + h2 ||
+             y1 + h1 < y2);
+}
+
+int rects_intersect_fixed_f(float x1, float y1, float w1, float h1,
+                            float x2, float y2, float w2, float h2) {
+    return rects_intersect_fixed(to_fixed(x1), to_fixed(y1),
+                                 to_fixed(w1), to_fixed(h1),
+                                 to_fixed(x2), to_fixed(y2),
+                                 to_fixed(w2), to_fixed(h2));
+}
+
+int check_collisions_fixed(Sim *sim) {
+    const Player *p = &sim->player;
+    fixed_t px = to_fixed(p->x);
+    fixed_t py = to_fixed(p->y);
+    fixed_t pw = to_fixed(p->w);
+    fixed_t ph = to_fixed(p->h);
+
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        const Obstacle *o = &sim->obstacles[i];
+        if (!o->active) {
+            continue;
+        }
+
+        if (rects_intersect_fixed(px, py, pw, ph,
+                                  to_fixed(o->x), to_fixed(o->y),
+                                  to_fixed(o->w), to_fixed(o->h))) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+#if defined(__SSE2__)
+/* Lane mask of obstacles o[0..3] that are active */
+static __m128 sse2_active_mask(const Obstacle *o) {
+    __m128i active = _mm_setr_epi32(o[0].active, o[1].active,
+                                    o[2].active, o[3].active);
+    __m128i idle = _mm_cmpeq_epi32(active, _mm_setzero_si128());
+    return _mm_castsi128_ps(_mm_xor_si128(idle, _mm_set1_epi32(-1)));
+}
+
+int check_collisions_sse2(Sim *sim) {
+    const Player *p = &sim->player;
+    const __m128 px  = _mm_set1_ps(p->x);
+    const __m128 py  = _mm_set1_ps(p->y);
+    const __m128 pxw = _mm_set1_ps(p->x + p->w);
+    const __m128 pyh = _mm_set1_ps(p->y + p->h);
+
+    for (int i = 0; i < MAX_OBSTACLES; i += 4) {
+        const Obstacle *o = &sim->obstacles[i];
+        __m128 live = sse2_active_mask(o);
+        if (!_mm_movemask_ps(live)) {
+            continue;
+        }
+
+        __m128 ox = _mm_setr_ps(o[0].x, o[1].x, o[2].x, o[3].x);
+        __m128 oy = _mm_setr_ps(o[0].y, o[1].y, o[2].y, o[3].y);
+        __m128 ow = _mm_setr_ps(o[0].w, o[1].w, o[2].w, o[3].w);
+        __m128 oh = _mm_setr_ps(o[0].h, o[1].h, o[2].h, o[3].h);
+
+        __m128 hit = _mm_and_ps(_mm_cmple_ps(px, _mm_add_ps(ox, ow)),
+                                _mm_cmpge_ps(pxw, ox));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(py, _mm_add_ps(oy, oh)));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(pyh, oy));
+
+        if (_mm_movemask_ps(_mm_and_ps(hit, live))) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+void update_obstacles_sse2(Sim *sim, float dt) {
+    const __m128 vdt    = _mm_set1_ps(dt);
+    const __m128 bottom = _mm_set1_ps((float)WINDOW_HEIGHT);
+
+    for (int i = 0; i < MAX_OBSTACLES; i += 4) {
+        Obstacle *o = &sim->obstacles[i];
+        __m128 live = sse2_active_mask(o);
+        int liveMask = _mm_movemask_ps(live);
+        if (!liveMask) {
+            continue;
+        }
+
+        __m128 y     = _mm_setr_ps(o[0].y, o[1].y, o[2].y, o[3].y);
+        __m128 speed = _mm_setr_ps(o[0].speed, o[1].speed,
+                                   o[2].speed, o[3].speed);
+        y = _mm_add_ps(y, _mm_mul_ps(speed, vdt));
+        int goneMask = _mm_movemask_ps(_mm_and_ps(_mm_cmpgt_ps(y, bottom), live));
+
+        float ys[4];
+        _mm_storeu_ps(ys, y);
+        for (int k = 0; k < 4; ++k) {
+            if (!(liveMask & (1 << k))) {
+                continue;
+            }
+            o[k].y = ys[k];
+            if (goneMask & (1 << k)) {
+                o[k].active = 0;
+                sim_emit(sim, SIM_EVENT_DODGED)->slot = (uint8_t)(i + k);
+            }
+        }
+    }
+}
+#endif /* __SSE2__ */
+
+/* ------------------------------ Sim Step --------------------------------- */
+
+/*
+ * Length of the next sim tick. It depends only on sim state, so a run with
+ * the same inputs replays with the same tick sequence. Early on obstacles are
+ * slow and ticks are long; as they speed up, ticks shrink to keep per-tick
+ * displacement within SIM_MAX_STEP_PX.
+ */
+uint32_t sim_tick_us(const Sim *sim) {
+    /* Newly spawned obstacles are normally the fastest, but check them all */
+    float maxSpeed = obstacle_spawn_speed(sim);
+    for (int i = 0; i < MAX_OBSTACLES; ++i) {
+        const Obstacle *o = &sim->obstacles[i];
+        if (o->active && o->speed > maxSpeed) {
+            maxSpeed = o->speed;
+        }
+    }
+
+    float us = SIM_MAX_STEP_PX / maxSpeed * 1000000.0f;
+    if (!(us < (float)SIM_MAX_TICK_US)) {
+        return SIM_MAX_TICK_US;
+    }
+    if (us < (float)SIM_MIN_TICK_US) {
+        return SIM_MIN_TICK_US;
+    }
+
+    uint32_t tick = (uint32_t)us;
+    return tick - tick % SIM_TICK_QUANTUM_US;
+}
+
+static void sim_fire_timer(Sim *sim, int kind) {
+    if (kind == SIM_TIMER_SPAWN) {
+        /* As of the quantum it was due, so later ticks cannot delay it */
+        spawn_obstacle(sim, sim->timers.now * SIM_TICK_QUANTUM_US);
+        schedule_spawn(sim);
+    } else {
+        sim_emit(sim, SIM_EVENT_TIMER)->slot = (uint8_t)kind;
+    }
+}
+
+/*
+ * Fire every timer due up to the end of this tick. Empty stretches of the
+ * first level are skipped with its occupancy bits, so a tick costs a few
+ * instructions however many timers are pending further out.
+ */
+static void sim_run_timers(Sim *sim) {
+    SimTimerWheel *w = &sim->timers;
+    uint64_t end = sim->simTimeUs / SIM_TICK_QUANTUM_US;
+
+    while (w->now <= end) {
+        int slot = (int)(w->now & TIMER_SLOT_MASK);
+        if (slot == 0) {
+            timer_cascade(w);
+        }
+        uint64_t pending = w->occupied >> slot;
+        if (!(pending & 1)) {
+            /* Jump to the next busy slot, the next block, or past the tick */
+            uint64_t skip = pending ? (uint64_t)__builtin_ctzll(pending)
+                                    : (uint64_t)(SIM_TIMER_SLOTS - slot);
+            w->now = w->now + skip < end + 1 ? w->now + skip : end + 1;
+            continue;
+        }
+        /* Timers started while firing may land here too; take them as well */
+        while (w->heads[0][slot] != SIM_TIMER_NONE) {
+            int id = w->heads[0][slot];
+            int kind = w->timers[id].kind;
+            timer_unlink(w, id);
+            w->freeMask |= 1u << id;
+            sim_fire_timer(sim, kind);
+        }
+        ++w->now;
+    }
+}
+
+int sim_step(Sim *sim, uint32_t tickUs, float dir) {
+    int first = sim->eventCount;
+
+    if (sim->killcam) {
+        killcam_tick(sim->killcam, sim, tickUs, dir);
+    }
+
+    float dt = (float)tickUs / 1000000.0f;
+    uint64_t before = sim->simTimeUs;
+    sim->simTimeUs += tickUs;
+
+    /* Survival points for the whole intervals this tick completed */
+    sim->score += sim_survival_points(sim->simTimeUs) -
+                  sim_survival_points(before);
+
+    sim->player.x = advance_player_x(sim->player.x, dir,
+                                     sim->player.speed, sim->player.w, dt);
+    update_obstacles(sim, dt);
+
+    sim_run_timers(sim);
+
+    int died = check_collisions(sim);
+    if (died) {
+        sim_emit(sim, SIM_EVENT_DIED)->x = sim->player.x;
+    }
+
+    /* The sim's own subscribers; the owner sees the same events afterwards */
+    sim_score_events(sim, sim->events + first, sim->eventCount - first);
+    if (sim->killcam) {
+        killcam_record_events(sim->killcam, sim->events + first,
+                              sim->eventCount - first);
+    }
+    return died;
+}
+
+int sim_advance(Sim *sim, uint32_t us, float dir) {
+    while (us > 0) {
+        uint32_t tick = sim_tick_us(sim);
+        if (tick > us) {
+            tick = us;
+        }
+        us -= tick;
+        sim_clear_events(sim);  /* headless: only the sim's own subscribers */
+        if (sim_step(sim, tick, dir)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void sim_observe(const Sim *sim, float *out) {
+    out[0] = sim->player.x;
+    out[1] = (float)((double)sim->simTimeUs / 1000000.0);
+
+    float *slot = out + 2;
+    for (int i = 0; i < MAX_OBSTACLES; ++i, slot += 4) {
+        const Obstacle *o = &sim->obstacles[i];
+        if (o->active) {
+            slot[0] = o->x;
+            slot[1] = o->y;
+            slot[2] = o->w;
+            slot[3] = o->speed;
+        } else {
+            slot[0] = slot[1] = slot[2] = slot[3] = 0.0f;
+        }
+    }
+}
+
+void sim_snapshot(const Sim *sim, SimSnapshot *out) {
+    out->player          = sim->player;
+    memcpy(out->obstacles, sim->obstacles, sizeof(out->obstacles));
+    out->score           = sim->score;
+    out->simTimeUs       = sim->simTimeUs;
+    out->lastSpawnUs     = sim->lastSpawnUs;
+    out->spawnCount      = sim->spawnCount;
+    out->rng             = sim->rng;
+
+    const SimTimerWheel *w = &sim->timers;
+    out->timerMask = ~w->freeMask & TIMER_ALL_IDS;
+    for (int id = 0; id < SIM_MAX_TIMERS; ++id) {
+        int pending = (out->timerMask >> id) & 1;
+        out->timerDue[id]  = pending ? w->timers[id].due : 0;
+        out->timerKind[id] = pending ? w->timers[id].kind : 0;
+    }
+}
+
+void sim_restore(Sim *sim, const SimSnapshot *snap) {
+    sim->player          = snap->player;
+    memcpy(sim->obstacles, snap->obstacles, sizeof(sim->obstacles));
+    sim->score           = snap->score;
+    sim->simTimeUs       = snap->simTimeUs;
+    sim->lastSpawnUs     = snap->lastSpawnUs;
+    sim->spawnCount      = snap->spawnCount;
+    sim->rng             = snap->rng ? snap->rng : 0x9E3779B9u;
+
+    /* Same ids, so timers due together still fire in the same order */
+    SimTimerWheel *w = &sim->timers;
+    timer_wheel_reset(w, sim->simTimeUs / SIM_TICK_QUANTUM_US + 1);
+    for (int id = 0; id < SIM_MAX_TIMERS; ++id) {
+        if (!(snap->timerMask & (1u << id))) continue;
+        w->freeMask &= ~(1u << id);
+        w->timers[id].due  = snap->timerDue[id];
+        w->timers[id].kind = snap->timerKind[id];
+        timer_link(w, id);
+    }
+
+    sim_clear_events(sim);
+    if (sim->killcam) {
+        killcam_reset(sim->killcam);
+    }
+}
+
+/* ------------------------------- Batches --------------------------------- */
+
+size_t sim_batch_output_bytes(int count) {
+    return (size_t)count * (SIM_OBS_FLOATS * sizeof(float) + sizeof(float) + 1);
+}
+
+/* Point obs, rewards and dones into the packed layout at `region` */
+static void sim_batch_layout(SimBatch *batch, void *region) {
+    uint8_t *bytes = (uint8_t *)region;
+    size_t count = (size_t)batch->count;
+
+    batch->obs     = (float *)bytes;
+    batch->rewards = (float *)(bytes + count * SIM_OBS_FLOATS * sizeof(float));
+    batch->dones   = bytes + count * (SIM_OBS_FLOATS + 1) * sizeof(float);
+}
+
+int sim_batch_init(SimBatch *batch, int count) {
+    memset(batch, 0, sizeof(*batch));
+    if (count <= 0) {
+        return 0;
+    }
+
+    batch->sims    = (Sim *)calloc((size_t)count, sizeof(Sim));
+    batch->storage = calloc(1, sim_batch_output_bytes(count));
+    if (!batch->sims || !batch->storage) {
+        sim_batch_free(batch);
+        return 0;
+    }
+
+    batch->count = count;
+    sim_batch_layout(batch, batch->storage);
+    return 1;
+}
+
+void sim_batch_free(SimBatch *batch) {
+    free(batch->sims);
+    free(batch->storage);
+    memset(batch, 0, sizeof(*batch));
+}
+
+void sim_batch_bind_output(SimBatch *batch, void *region) {
+    if (!region) {
+        region = batch->storage;
+    }
+    if (batch->obs && (void *)batch->obs != region) {
+        memcpy(region, batch->obs, sim_batch_output_bytes(batch->count));
+    }
+    sim_batch_layout(batch, region);
+}
+
+void sim_batch_reset_range(SimBatch *batch, const uint32_t *seeds,
+                           int first, int last) {
+    for (int i = first; i < last; ++i) {
+        sim_reset(&batch->sims[i], seeds[i]);
+        sim_observe(&batch->sims[i], batch->obs + (size_t)i * SIM_OBS_FLOATS);
+        batch->rewards[i] = 0.0f;
+        batch->dones[i] = 0;
+    }
+}
+
+void sim_batch_reset(SimBatch *batch, const uint32_t *seeds) {
+    sim_batch_reset_range(batch, seeds, 0, batch->count);
+}
+
+/* Finished instances stay done, with zero reward, until they are reset */
+void sim_batch_step_range(SimBatch *batch, const int8_t *actions,
+                          int first, int last) {
+    for (int i = first; i < last; ++i) {
+        Sim *sim = &batch->sims[i];
+        if (batch->dones[i]) {
+            batch->rewards[i] = 0.0f;
+            continue;
+        }
+
+        float dir = actions[i] < 0 ? -1.0f : (actions[i] > 0 ? 1.0f : 0.0f);
+        int before = sim->score;
+        batch->dones[i] = (uint8_t)sim_advance(sim, SIM_ENV_STEP_US, dir);
+        batch->rewards[i] = (float)(sim->score - before);
+        sim_observe(sim, batch->obs + (size_t)i * SIM_OBS_FLOATS);
+    }
+}
+
+void sim_batch_step(SimBatch *batch, const int8_t *actions) {
+    sim_batch_step_range(batch, actions, 0, batch->count);
+}
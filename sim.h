@@ -0,0 +1,380 @@
+/*
+ * Endless Dodge - headless simulation core.
+ *
+ * Everything needed to run the game's rules without a window: player and
+ * obstacle state, spawning, movement, collisions, the adaptive tick length,
+ * the killcam recorder, and batches of independent instances for agents.
+ * Plain C99 with no SDL dependency, so tools and bindings can link it alone.
+ */
+
+#ifndef ENDLESS_DODGE_SIM_H
+#define ENDLESS_DODGE_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ----------------------------- Configuration ----------------------------- */
+
+/* Playfield, in pixels (the window size of the game) */
+#define WINDOW_WIDTH   800
+#define WINDOW_HEIGHT  600
+
+/* Player configuration */
+#define PLAYER_WIDTH       80.0f
+#define PLAYER_HEIGHT      20.0f
+#define PLAYER_SPEED       500.0f  /* pixels per second */
+
+/* Obstacle configuration */
+#define MAX_OBSTACLES             64
+#define OBSTACLE_MIN_WIDTH        40.0f
+#define OBSTACLE_MAX_WIDTH        140.0f
+#define OBSTACLE_HEIGHT           20.0f
+#define OBSTACLE_BASE_SPEED       200.0f
+
+/*
+ * Difficulty and score are kept in integers so they depend only on sim time
+ * and spawn count, never on how that time was cut into ticks. See
+ * sim_difficulty().
+ */
+#define OBSTACLE_BASE_SPEED_MPX      200000   /* milli-px/s at the start */
+#define OBSTACLE_SPEED_GAIN_MPX      6000     /* milli-px/s added per second */
+#define OBSTACLE_BASE_INTERVAL_US    700000   /* between spawns at the start */
+#define OBSTACLE_MIN_INTERVAL_US     140000
+#define OBSTACLE_INTERVAL_DECAY      985      /* per mille, after each spawn */
+#define SIM_SURVIVAL_POINT_US        50000    /* 20 points per second alive */
+#define SIM_DODGE_POINTS             10
+
+/*
+ * The sim runs on its own ticks, independent of the display refresh. Tick
+ * length adapts to the fastest obstacle so nothing moves more than
+ * SIM_MAX_STEP_PX per tick.
+ */
+#define SIM_MIN_TICK_US      250
+#define SIM_MAX_TICK_US      4000
+#define SIM_TICK_QUANTUM_US  250
+#define SIM_MAX_STEP_PX      \
+    (0.25f * (OBSTACLE_HEIGHT < PLAYER_HEIGHT ? OBSTACLE_HEIGHT : PLAYER_HEIGHT))
+
+/* Killcam: replay of the end of a run, from a fixed-size delta log */
+#define KILLCAM_RING_SIZE       8192   /* bytes; power of two */
+#define KILLCAM_MAX_KEYFRAMES   16     /* power of two */
+#define KILLCAM_KEYFRAME_US     1000000
+#define KILLCAM_WINDOW_US       5000000
+
+/*
+ * Batched environments for agents. One environment step advances the sim by
+ * SIM_ENV_STEP_US using its own adaptive ticks. An observation is
+ * SIM_OBS_FLOATS floats: player x, elapsed seconds, then x, y, w, speed for
+ * every obstacle slot (all zero for inactive slots).
+ */
+#define SIM_ENV_STEP_US  16000
+#define SIM_OBS_FLOATS   (2 + 4 * MAX_OBSTACLES)
+
+/*
+ * Timer wheel: four levels of 64 slots over SIM_TICK_QUANTUM_US quanta, so
+ * the first level spans 16 ms and the last about 70 minutes. Timers further
+ * out than that wait in the last level and are re-filed as it turns.
+ */
+#define SIM_TIMER_LEVELS  4
+#define SIM_TIMER_BITS    6      /* 64 slots: one occupancy bit each in a u64 */
+#define SIM_TIMER_SLOTS   (1 << SIM_TIMER_BITS)
+#define SIM_MAX_TIMERS    16     /* pending per sim; at most 32 */
+#define SIM_TIMER_NONE    0xFF
+
+/*
+ * Per-tick event buffer. A tick emits at most one DODGED per obstacle, a
+ * SPAWNED, a DIED and a TIMER per owner timer, leaving room for events the
+ * game adds between ticks.
+ */
+#define SIM_MAX_EVENTS   (2 * MAX_OBSTACLES)
+
+/* --------------------------------- Types --------------------------------- */
+
+typedef struct {
+    float x;
+    float y;
+    float w;
+    float h;
+    float speed;
+    int   active;
+} Obstacle;
+
+typedef struct {
+    float x;
+    float y;
+    float w;
+    float h;
+    float speed;
+} Player;
+
+/*
+ * Killcam recorder. Instead of full snapshots it keeps a byte ring of compact
+ * records: run-length encoded ticks (length + player direction), obstacle
+ * spawns and retirements, plus a keyframe of the live obstacles once per
+ * second to start playback from. Obstacle and player motion is re-derived
+ * from those with the sim's own arithmetic.
+ */
+typedef struct {
+    uint32_t pos;     /* ring position of the keyframe record */
+    uint64_t timeUs;  /* sim time it was taken at */
+} KillcamKeyframe;
+
+typedef struct {
+    uint8_t         ring[KILLCAM_RING_SIZE];
+    uint32_t        writePos;        /* total bytes written; wraps the ring */
+    uint32_t        runPos;          /* position of the open run's count */
+    int             runOpen;
+    uint8_t         runQuanta;
+    int8_t          runDir;
+    uint16_t        runCount;
+    KillcamKeyframe keyframes[KILLCAM_MAX_KEYFRAMES];
+    int             keyframeCount;   /* total written; indexes wrap */
+    uint64_t        lastKeyframeUs;
+
+    /* Playback */
+    Player          viewPlayer;
+    Obstacle        viewObstacles[MAX_OBSTACLES];
+    uint32_t        readPos;
+    uint32_t        endPos;
+    uint64_t        playUs;          /* replay time reconstructed so far */
+    uint64_t        clockUs;         /* wall time elapsed in the replay */
+    uint32_t        pendingTicks;    /* ticks left in the current run */
+    uint32_t        pendingTickUs;
+    float           pendingDir;
+} Killcam;
+
+/*
+ * Side effects of a tick, in the order they happened. The sim applies its
+ * own (score, killcam) after each tick; the owner consumes the rest in a
+ * batch and clears the buffer with sim_clear_events().
+ */
+typedef enum {
+    SIM_EVENT_SPAWNED = 0,     /* slot, x, w, speed of the new obstacle */
+    SIM_EVENT_DODGED,          /* slot of an obstacle that left the screen */
+    SIM_EVENT_DIED,            /* x: player position at the collision */
+    SIM_EVENT_STATE_CHANGED,   /* from, to: emitted by the game, not the sim */
+    SIM_EVENT_TIMER            /* slot: kind of an owner timer that fired */
+} SimEventType;
+
+typedef struct {
+    uint8_t  type;    /* SimEventType */
+    uint8_t  slot;
+    uint8_t  from;
+    uint8_t  to;
+    float    x;
+    float    w;
+    float    speed;
+    uint64_t timeUs;  /* sim time of the tick it happened in */
+} SimEvent;
+
+/*
+ * Timer kinds below SIM_TIMER_OWNER are the sim's own and handled inside
+ * it; the owner starts kinds from SIM_TIMER_OWNER up and sees them fire as
+ * SIM_EVENT_TIMER events.
+ */
+typedef enum {
+    SIM_TIMER_SPAWN = 0,       /* next obstacle */
+    SIM_TIMER_OWNER = 16
+} SimTimerKind;
+
+typedef struct {
+    uint64_t due;     /* quantum it fires at */
+    uint8_t  kind;
+    uint8_t  level;   /* where it is filed */
+    uint8_t  slot;
+    uint8_t  next;    /* in its slot, by id; SIM_TIMER_NONE ends it */
+    uint8_t  prev;
+} SimTimer;
+
+/*
+ * Hierarchical timer wheel keyed on sim time quanta. A timer is filed at the
+ * lowest level whose span reaches its due quantum, and moves down a level
+ * each time that level's slot comes round, so starting, cancelling and
+ * firing are O(1). Timers due in the same tick fire in id order, and ids are
+ * handed out lowest first, so a run fires them identically on every replay
+ * and after a restore.
+ */
+typedef struct {
+    uint64_t now;                /* next quantum to process */
+    uint64_t occupied;           /* bit per non-empty first-level slot */
+    uint32_t freeMask;           /* bit per unused timer id */
+    uint8_t  heads[SIM_TIMER_LEVELS][SIM_TIMER_SLOTS];
+    SimTimer timers[SIM_MAX_TIMERS];
+} SimTimerWheel;
+
+/* One run of the game rules */
+typedef struct {
+    Player    player;
+    Obstacle  obstacles[MAX_OBSTACLES];
+
+    SimEvent  events[SIM_MAX_EVENTS + 1];  /* last entry absorbs overflow */
+    int       eventCount;
+
+    int       score;
+    uint64_t  simTimeUs;        /* sim time of the current run */
+    uint64_t  lastSpawnUs;      /* sim time of last obstacle spawn */
+    uint32_t  spawnCount;       /* obstacles spawned; sets the interval */
+    uint32_t  rng;              /* xorshift32 state; never zero */
+    SimTimerWheel timers;       /* the next spawn, and the owner's timers */
+
+    Killcam  *killcam;          /* optional recorder, NULL to disable */
+} Sim;
+
+/*
+ * Everything a run's future depends on, without events or the recorder: a
+ * sim restored from a snapshot continues exactly as the original would.
+ */
+typedef struct {
+    Player    player;
+    Obstacle  obstacles[MAX_OBSTACLES];
+    int       score;
+    uint64_t  simTimeUs;
+    uint64_t  lastSpawnUs;
+    uint32_t  spawnCount;
+    uint32_t  rng;
+    uint32_t  timerMask;                  /* ids of pending timers */
+    uint64_t  timerDue[SIM_MAX_TIMERS];   /* quantum, per id */
+    uint8_t   timerKind[SIM_MAX_TIMERS];
+} SimSnapshot;
+
+/*
+ * Many independent runs stepped in lockstep. Outputs are packed into one
+ * region, obs then rewards then dones, so they can be sent or shared as-is.
+ */
+typedef struct {
+    int      count;
+    Sim     *sims;
+    float   *obs;       /* count * SIM_OBS_FLOATS */
+    float   *rewards;   /* score gained during the last step */
+    uint8_t *dones;     /* 1 once the run has collided */
+    void    *storage;   /* the batch's own output region */
+} SimBatch;
+
+/* ------------------------------ Simulation ------------------------------- */
+
+/* Start a fresh run; the same seed and inputs always replay identically */
+void     sim_reset(Sim *sim, uint32_t seed);
+
+/* Length of the next tick, derived from sim state only */
+uint32_t sim_tick_us(const Sim *sim);
+
+/* Run one tick with the player moving in `dir` (-1, 0, 1); 1 on collision */
+int      sim_step(Sim *sim, uint32_t tickUs, float dir);
+
+/* Run ticks covering exactly `us` (a multiple of SIM_TICK_QUANTUM_US) */
+int      sim_advance(Sim *sim, uint32_t us, float dir);
+
+void     sim_observe(const Sim *sim, float *out);
+
+void     sim_snapshot(const Sim *sim, SimSnapshot *out);
+
+/* Continue a run from a snapshot; the killcam, if any, starts over */
+void     sim_restore(Sim *sim, const SimSnapshot *snap);
+
+/*
+ * Fire a timer of `kind` at the end of the tick that takes sim time
+ * `delayUs` past now (rounded up to a quantum). Returns its id, or -1 when
+ * SIM_MAX_TIMERS are already pending.
+ */
+int      sim_timer_start(Sim *sim, int kind, uint64_t delayUs);
+void     sim_timer_cancel(Sim *sim, int id);
+
+/* Append an event stamped with the current sim time; fill in the rest */
+SimEvent *sim_emit(Sim *sim, SimEventType type);
+void      sim_clear_events(Sim *sim);
+
+/*
+ * Difficulty at any point of a run, in O(1): fall speed grows linearly
+ * with sim time, and the spawn interval shrinks by OBSTACLE_INTERVAL_DECAY
+ * per spawn down to OBSTACLE_MIN_INTERVAL_US, read from a table indexed by
+ * the spawn count. Both are exact integer arithmetic, so any tick rate,
+ * platform or batch lane gets the same values.
+ */
+typedef struct {
+    uint64_t fallSpeedMpx;      /* of an obstacle spawned now, milli-px/s */
+    uint32_t spawnIntervalUs;   /* until the next spawn */
+} SimDifficulty;
+
+SimDifficulty sim_difficulty(uint64_t simTimeUs, uint32_t spawnCount);
+
+/* Survival points earned in the first `simTimeUs` of a run */
+int           sim_survival_points(uint64_t simTimeUs);
+
+float    obstacle_spawn_speed(const Sim *sim);
+/* Spawn with the fall speed and interval timing of sim time `atUs` */
+void     spawn_obstacle(Sim *sim, uint64_t atUs);
+
+/* ----------------------- Kernels and their variants ---------------------- */
+
+/*
+ * The scalar kernels are the reference. Every variant must agree with them
+ * exactly; the game's `--verify-kernels` mode checks that.
+ */
+int  rects_intersect(float x1, float y1, float w1, float h1,
+                     float x2, float y2, float w2, float h2);
+void update_obstacles(Sim *sim, float dt);
+int  check_collisions(Sim *sim);
+
+int  rects_intersect_branchless(float x1, float y1, float w1, float h1,
+                                float x2, float y2, float w2, float h2);
+int  check_collisions_branchless(Sim *sim);
+
+/*
+ * Fixed point with 8 fractional bits. Conversion is exact for coordinates on
+ * a 1/256 px grid with magnitude up to FIXED_MAX_COORD, so these kernels are
+ * only compared against the float reference on such configurations.
+ */
+typedef int32_t fixed_t;
+
+#define FIXED_SHIFT      8
+#define FIXED_ONE        (1 << FIXED_SHIFT)
+#define FIXED_MAX_COORD  32768.0f
+
+int  float_on_fixed_grid(float v);
+int  rects_intersect_fixed_f(float x1, float y1, float w1, float h1,
+                             float x2, float y2, float w2, float h2);
+int  check_collisions_fixed(Sim *sim);
+
+#if defined(__SSE2__)
+int  check_collisions_sse2(Sim *sim);
+void update_obstacles_sse2(Sim *sim, float dt);
+#endif
+
+/* -------------------------------- Killcam -------------------------------- */
+
+void killcam_reset(Killcam *kc);
+
+/* Start playback of the last KILLCAM_WINDOW_US before `sim` ended */
+int  killcam_start_playback(Killcam *kc, const Sim *sim);
+
+/* Advance playback by `us` of wall time; returns 0 once it has finished */
+int  killcam_advance(Killcam *kc, uint32_t us);
+
+/* ------------------------------- Batches --------------------------------- */
+
+int  sim_batch_init(SimBatch *batch, int count);
+void sim_batch_free(SimBatch *batch);
+
+/* Size of the packed output region for `count` instances */
+size_t sim_batch_output_bytes(int count);
+
+/*
+ * Move the outputs into `region` (at least sim_batch_output_bytes() long),
+ * e.g. shared memory, or back into the batch's own storage for NULL.
+ */
+void sim_batch_bind_output(SimBatch *batch, void *region);
+
+/* Reset every instance with its seed and refresh all observations */
+void sim_batch_reset(SimBatch *batch, const uint32_t *seeds);
+
+/* Reset the instances in [first, last) only */
+void sim_batch_reset_range(SimBatch *batch, const uint32_t *seeds,
+                           int first, int last);
+
+/* Step instances in [first, last) by one environment step each */
+void sim_batch_step_range(SimBatch *batch, const int8_t *actions,
+                          int first, int last);
+
+void sim_batch_step(SimBatch *batch, const int8_t *actions);
+
+#endif /* ENDLESS_DODGE_SIM_H */